@@ -17,12 +17,22 @@
 
 #include "accori_device.h"
 #include <math.h>
+#include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include "imu.h"
 #include "mpu6500.h"
 #include "rd0057.h"
 #include "native_gecko.h"
 #include "app_interrupt.h"
+#include "app_timer.h"
+#include "em_device.h"
+#include "em_rtcc.h"
+#include "gyro_bias.h"
+#include "motion_event.h"
+#include "spectrum.h"
+#include "activity.h"
+#include "dmp_quat.h"
 
 /***********************************************************************************************//**
  * @addtogroup app_hardware
@@ -41,13 +51,191 @@
 #define USE_SENSOR_ERROR_LED            0
 #define USE_ANGULAR_ERROR_LED           0
 
-#define SWAP_AXES_FOR_CAR_DEMO          1
+// Board mounting, as a signed permutation from the sensor axes to the board
+// axes. Each board axis takes the sensor axis in MOUNTING_DEFAULT, optionally
+// with ACCORI_MOUNTING_NEGATE. The default is the car demo mounting, X and Y
+// swapped and Z flipped. It can be changed at runtime, and is then kept in
+// MOUNTING_PS_KEY. Only rotations are allowed, a mirror image would turn the
+// fusion inside out.
+#define MOUNTING_DEFAULT                { 1, 0, 2 | ACCORI_MOUNTING_NEGATE }
+#define MOUNTING_PS_KEY                 0x4002  // Next to CALIBRATION_PS_KEY
 
 #define USE_MPU6500_INTERRUPT           1
 #define MPU6500_INTERRUPT_FREQ          200
 #define MPU6500_POLL_FREQ               1
 #define MPU6500_MAX_FREQ                1000
 
+// Collect samples in the sensor FIFO and process them in batches, instead of
+// waking up for every sample. The FIFO is drained every MPU6500_FIFO_WATERMARK
+// samples, which must be well below MPU6500_FIFO_MAX_SAMPLES.
+#define USE_MPU6500_FIFO                1
+#define MPU6500_FIFO_WATERMARK          20
+
+// Integrate the gyro over the measured time between samples, in RTCC ticks,
+// instead of the nominal period. Data ready edges are timestamped in the GPIO
+// interrupt handler. FIFO batches have no edge per sample, so a sample period
+// estimate is steered by the read times, and the batches are laid end to end.
+// Intervals beyond MEASURED_DT_MAX_PERIODS nominal periods fall back to
+// nominal, as do FIFO periods more than MEASURED_DT_FIFO_TOLERANCE percent off.
+#define USE_MEASURED_DT                 1
+#define MEASURED_DT_MAX_PERIODS         4
+#define MEASURED_DT_FIFO_TOLERANCE      10
+#define MEASURED_DT_FIFO_GAIN           8
+
+// Let the MPU6500 motion processor fuse the orientation while nothing else
+// needs the samples, and only read its quaternions from the FIFO at
+// DMP_QUAT_FREQ. The host fusion carries on from the same orientation as
+// soon as anything else is enabled. Needs the DMP image, see mpu6500.h.
+#define USE_DMP_FUSION                  (MPU6500_DMP_FIRMWARE_AVAILABLE && !IMU_FIXED_POINT)
+#define DMP_QUAT_FREQ                   10
+#define DMP_READ_BATCH                  4
+
+#if USE_DMP_FUSION && !(USE_MPU6500_INTERRUPT && USE_MPU6500_FIFO)
+#error "The DMP fusion needs the sensor FIFO"
+#endif
+
+// Count the CPU cycles spent in each orientation update with the DWT cycle
+// counter. Inspect orientationCycles in the debugger for the min, max and
+// last values. Target only, the counter doesn't exist in the test build.
+//
+// No target cycle counts have been recorded yet. What is known is the double
+// precision work taken out of the update, counted as double instructions in a
+// host -O2 build of imu.c, each of which is a soft-float library call on the
+// Cortex-M4F:
+//   imuSensorFusionGyroCorrCalc()   15 before, 0 after
+//   imuAngleNormalize()             11 before, 0 after
+// To measure, build Release with this on, once before and once after the
+// single precision change, stream orientation at the default rate with the
+// board still, and take min and max after a few seconds. Record the numbers
+// here.
+#define USE_ORIENTATION_BENCHMARK       0
+
+// Sensor fusion engine, picked at init. The quaternion engines only work with
+// the floating point IMU engine, and only calculate angles when they are read.
+#define FUSION_ENGINE_DEFAULT           fusionEngineMahony
+#define FUSION_MAHONY_KP                0.5
+#define FUSION_MAHONY_KI                0.01
+#define FUSION_MADGWICK_BETA            0.1
+
+// Multi-rate fusion. The gyro is integrated for every sample, the engine is
+// renormalized and corrected from the accelerometer every so many samples,
+// and the angles are only calculated when they are read. Below
+// FUSION_MULTIRATE_MIN_FREQ everything runs for every sample.
+#define FUSION_RENORM_DIVISOR           2
+#define FUSION_CORRECTION_DIVISOR       4
+#define FUSION_MULTIRATE_MIN_FREQ       50
+
+// Pick the lowest sample rate, and the filters to go with it, that serves
+// the sensors in use. The orientation integrates the gyro, so it always runs
+// at MPU6500_INTERRUPT_FREQ. The acceleration is averaged over its
+// notification period, so it only needs ACC_SAMPLES_PER_PERIOD samples per
+// period. The samples are collected at least once per notification period.
+#define USE_ADAPTIVE_RATE               1
+#define ACC_SAMPLES_PER_PERIOD          5
+#define ACC_PERIOD_DEFAULT_MS           200
+#define ORI_PERIOD_DEFAULT_MS           200
+
+// Keep the samples for the raw stream characteristic, taken every so many
+// samples to get the requested rate. The buffer holds the samples until they
+// are notified, and drops the oldest if the link can't keep up. Sample times
+// are RTCC ticks.
+#define USE_RAW_STREAM                  1
+#define RAW_FREQ_DEFAULT                MPU6500_INTERRUPT_FREQ
+#define RAW_BUFFER_SAMPLES              64
+#define RAW_TIMESTAMP_FREQ              32768
+
+#if USE_RAW_STREAM && !USE_MPU6500_INTERRUPT
+#error "The raw stream needs the sensor interrupt"
+#endif
+
+#if (FUSION_CORRECTION_DIVISOR % FUSION_RENORM_DIVISOR) != 0
+#error "The correction must run on a renormalization sample"
+#endif
+
+// Estimate the gyro bias whenever the board is still, and remove it in software
+// on top of the offsets in the sensor. The control point calibration still
+// works as an override, and restarts the estimate.
+#define USE_GYRO_BIAS_ESTIMATION        1
+#define GYRO_BIAS_WINDOW_SEC            1
+
+// Keep the calibration, and optionally the orientation, in a PS key so it
+// survives a power cycle. To save flash wear, saves are limited to one per
+// CALIBRATION_PS_SAVE_INTERVAL_SEC of sensor run time, and one at the end of
+// a session that ran at least CALIBRATION_PS_SESSION_SEC, plus one after every
+// calibration. The restored bias estimate is dropped if the temperature has
+// changed too much since it was saved. The saved orientation is only restored
+// into the same engine and number format, and only if it is close to a
+// rotation.
+#define USE_CALIBRATION_PS              1
+#define CALIBRATION_PS_KEY              0x4001  // Next to DEVNAME_PS_KEY
+#define CALIBRATION_PS_VERSION          2
+#define CALIBRATION_PS_FUSION_FIXED     0x80    // Fusion engine flag, Q27 rather than float
+#define CALIBRATION_PS_SAVE_FUSION      1
+#define CALIBRATION_PS_SAVE_INTERVAL_SEC 600
+#define CALIBRATION_PS_SESSION_SEC      60
+#define CALIBRATION_PS_MAX_TEMP_DIFF    1000    // 0.01 deg C
+
+// Leave the accelerometer in low-power cycled mode while the application
+// sleeps, and wake it up when the board moves. The threshold is the change in
+// acceleration between two samples, and the cycle rate trades the current draw
+// against how short a movement is noticed.
+#define USE_WAKE_ON_MOTION              1
+#define WAKE_ON_MOTION_THRESHOLD_MG     100
+#define WAKE_ON_MOTION_FREQ             mpu6500LpAccelFreq_7_81Hz
+
+// Tap, double tap, shock and free-fall detection on the accelerometer samples.
+// Taps are short, so the detection needs a wider accelerometer bandwidth and
+// the full sample rate. The events chosen to wake the board up replace the
+// wake on motion, at the cost of keeping the accelerometer running in sleep.
+#define USE_MOTION_EVENTS               1
+#define MOTION_EVENT_FREQ               MPU6500_INTERRUPT_FREQ
+#define MOTION_EVENT_ACC_FILTER         mpu6500AccelFreq_92Hz
+#define MOTION_EVENT_QUEUE              4
+#define MOTION_EVENT_SHOCK_MAX_MG       15000   // Just below full scale
+
+// While armed, the capture buffer always holds the last CAPTURE_SAMPLES raw
+// samples. A trigger freezes the samples before and after it for download.
+// An armed capture keeps the sensors running through sleep, with a bandwidth
+// that lets impacts through, and a completed capture wakes the board up.
+// The buffer is 12 bytes per sample (1.5 KB), 0.64 s around the trigger.
+#define USE_CAPTURE                     1
+#define CAPTURE_SAMPLES                 128
+#define CAPTURE_FREQ                    MPU6500_INTERRUPT_FREQ
+#define CAPTURE_ACC_FILTER              mpu6500AccelFreq_92Hz
+#define CAPTURE_TRIGGERS                (ACCORI_CAPTURE_TRIGGER_ACC | ACCORI_CAPTURE_TRIGGER_RANGE \
+                                         | ACCORI_CAPTURE_TRIGGER_MANUAL)
+
+// Vibration spectrum of one accelerometer axis, or of the magnitude, over a
+// window of samples every interval. The CMSIS-DSP library is only vendored as
+// headers, so the summary comes from the in-tree FFT in spectrum.c. The window
+// is collected into the FFT working memory, SPECTRUM_MAX_SAMPLES floats (1 KB).
+#define USE_SPECTRUM                    1
+#define SPECTRUM_SAMPLES_DEFAULT        256
+#define SPECTRUM_FREQ_DEFAULT           MPU6500_INTERRUPT_FREQ
+#define SPECTRUM_INTERVAL_MS_DEFAULT    5000
+#define SPECTRUM_ACC_FILTER             mpu6500AccelFreq_92Hz
+
+// Idle, walking, vehicle and shake classification on the accelerometer,
+// averaged down to ACTIVITY_FREQ. Only a change of activity is reported, so a
+// client doing recognition gets a few events an hour instead of streams. The
+// bandwidth has to let the vibrations of a vehicle through. The classifier
+// works on running sums, about 120 bytes of RAM with no sample window.
+#define USE_ACTIVITY                    1
+#define ACTIVITY_ACC_FILTER             mpu6500AccelFreq_10Hz
+
+// Linear motion: the acceleration in the world frame with gravity removed, and
+// its leaky integral as a short horizon velocity. The leak pulls the velocity
+// back to zero with the time constant, so the orientation and offset errors
+// can't build up in it. Accelerations within the dead band are taken as those
+// errors and not integrated at all.
+// The velocity keeps LINEAR_VELOCITY_FRAC_BITS below 1 um/s, or the leak of a
+// slow velocity would round to nothing and it would never decay.
+#define LINEAR_VELOCITY_LEAK_MS         1000
+#define LINEAR_VELOCITY_LEAK_TICKS      ((int64_t)LINEAR_VELOCITY_LEAK_MS * RAW_TIMESTAMP_FREQ / 1000)
+#define LINEAR_VELOCITY_FRAC_BITS       16
+#define LINEAR_DEADBAND_MG              20
+#define LINEAR_UM_PER_S_PER_MG          9807    // Standard gravity, in um/s^2 per mg
+
 // Using a value just below the max value for the sensor
 #define ERROR_LEVEL_GYR_ANG             2.0
 
@@ -61,6 +249,45 @@
  * Local Type Definitions
  **************************************************************************************************/
 
+// Sample rate and the low pass filters that keep aliasing out of it
+typedef struct {
+  uint16_t freq;
+  Mpu6500AccelFreq_t accFilter;
+  Mpu6500GyroFreq_t gyrFilter;
+} SensorRate_t;
+
+typedef enum {
+  fusionEngineDcm,
+  fusionEngineMahony,
+  fusionEngineMadgwick,
+} FusionEngine_t;
+
+#if USE_CALIBRATION_PS
+// At most 56 bytes, the max PS key size
+typedef struct {
+  uint8_t  version;
+  uint8_t  biasValid;
+  int16_t  temperature;
+  int16_t  gyrOffset[3];
+  int16_t  gyrBias[3];
+#if CALIBRATION_PS_SAVE_FUSION
+  uint8_t  fusionEngine;    // Plus CALIBRATION_PS_FUSION_FIXED
+  uint8_t  reserved[3];
+  // Quaternion, or the first two rows of the DCM
+  ImuFloat_t fusion[6];
+#endif
+} CalibrationPs_t;
+#endif
+
+#if USE_ORIENTATION_BENCHMARK
+typedef struct {
+  uint32_t min;
+  uint32_t max;
+  uint32_t last;
+  uint32_t count;
+} OrientationCycles_t;
+#endif
+
 /***************************************************************************************************
  * Local Variables
  **************************************************************************************************/
@@ -70,24 +297,69 @@ static bool accelerationEnabled = false;
 static bool accelerationNotification = false;
 static bool orientationEnabled = false;
 static bool orientationNotification = false;
+static bool motionNotification = false;
+static bool linearNotification = false;
 
 static int16_t  accSensor[3];
 static int16_t  gyrSensor[3];
+static int32_t  gyrRate[3];
 static int32_t  accAccumulator[3];
 static int32_t  accAccumulatorCnt;
 static int16_t  oriCalculated[3];
 static ImuFloat_t   accVec[3];
+static int32_t  linearAccumulator[3];   // mg
+static int32_t  linearAccumulatorCnt;
+static int64_t  linearVelocity[3];      // um/s << LINEAR_VELOCITY_FRAC_BITS
 static ImuFloat_t   dcmMatrix[3][3];
 static bool     calibrationInProgress = false;
 static void     (*calibrateDoneCallbackG)(void);
 static ImuSensorFusion_t sensorFusionData;
+#if USE_GYRO_BIAS_ESTIMATION
+static GyroBias_t gyroBias;
+#endif
+static FusionEngine_t fusionEngine = fusionEngineDcm;
+static uint8_t  fusionRenormCountDown;
+static uint8_t  fusionCorrectionCountDown;
+#if !IMU_FIXED_POINT
+static ImuQuatFusion_t quatFusionData;
+#endif
 
 #if USE_MPU6500_INTERRUPT
 static uint16_t sensorIntFreq = MPU6500_INTERRUPT_FREQ;
+static uint16_t sensorIntPeriodMs = ACC_PERIOD_DEFAULT_MS;
 #else
 static uint16_t sensorPollFreq = MPU6500_POLL_FREQ;
 #endif
 static uint32_t sensorFreq;
+static uint32_t sensorTime;
+static uint8_t  mounting[3] = MOUNTING_DEFAULT;
+#if USE_DMP_FUSION
+static bool     dmpLoaded = false;
+static bool     dmpActive = false;
+static ImuFloat_t dmpMatrix[3][3];      // Latest DMP orientation, board axes
+#endif
+#if USE_MEASURED_DT
+static uint32_t sensorDt;               // Since the previous sample, 0 if nominal
+static bool     sampleTimeValid;
+static uint32_t sampleTimeLast;
+#if USE_MPU6500_FIFO
+static uint32_t fifoReadTimeLast;
+static uint32_t fifoPeriodQ8;           // Sample period estimate, in 1/256 ticks
+#endif
+#endif
+static bool     sensorRunning = false;
+static uint16_t accPeriodMs = ACC_PERIOD_DEFAULT_MS;
+static uint16_t oriPeriodMs = ORI_PERIOD_DEFAULT_MS;
+
+// In increasing order. The last one is used for the orientation.
+static const SensorRate_t sensorRates[] = {
+  { 25, mpu6500AccelFreq_5Hz, mpu6500GyroFreq_10Hz },
+  { 50, mpu6500AccelFreq_5Hz, mpu6500GyroFreq_20Hz },
+  { 100, mpu6500AccelFreq_5Hz, mpu6500GyroFreq_41Hz },
+  { MPU6500_INTERRUPT_FREQ, mpu6500AccelFreq_5Hz, mpu6500GyroFreq_184Hz },
+};
+
+#define SENSOR_RATE_COUNT               (sizeof(sensorRates) / sizeof(sensorRates[0]))
 
 #if USE_SENSOR_ERROR_LED
 static uint32_t errorAccCntDown = 0;
@@ -97,6 +369,90 @@ static uint32_t errorGyrCntDown = 0;
 static uint32_t errorAngCntDown = 0;
 #endif
 
+#if USE_MPU6500_FIFO
+static Mpu6500Sample_t fifoSamples[MPU6500_FIFO_MAX_SAMPLES];
+#endif
+
+#if USE_CALIBRATION_PS
+static uint32_t calibrationPsRunMs = 0;
+static bool     calibrationPsTemperatureCheck = false;
+static int16_t  calibrationPsTemperature;
+#endif
+
+#if USE_RAW_STREAM
+static bool     rawEnabled = false;
+static uint16_t rawFreq = RAW_FREQ_DEFAULT;
+static uint8_t  rawDecimation = 1;
+static uint8_t  rawDecimationCnt = 0;
+static AccoriRawSample_t rawSamples[RAW_BUFFER_SAMPLES];
+static uint32_t rawTimes[RAW_BUFFER_SAMPLES];
+static uint16_t rawFirst = 0;
+static uint16_t rawCount = 0;
+static uint16_t rawSequence = 0;
+#endif
+
+#if USE_WAKE_ON_MOTION
+static bool     wakeOnMotionArmed = false;
+#endif
+static void     (*motionCallbackG)(void);
+
+#if USE_MOTION_EVENTS
+static MotionEventDetector_t motionEventDetector;
+static void     (*eventCallbackG)(const MotionEvent_t *event);
+static bool     eventWakeArmed = false;
+static uint8_t  eventWakeMask = 0;
+static MotionEvent_t eventQueue[MOTION_EVENT_QUEUE];
+static uint8_t  eventQueueCnt = 0;
+static MotionEvent_t eventLast;
+static bool     eventLastValid = false;
+#endif
+
+#if USE_CAPTURE
+static AccoriCaptureState_t captureState = accoriCaptureIdle;
+static uint8_t  captureTriggers;
+static uint32_t captureThresholdSq;
+static uint16_t capturePre;
+static uint16_t capturePost;
+static AccoriRawSample_t captureSamples[CAPTURE_SAMPLES];
+static uint16_t captureHead;
+static uint16_t captureFill;
+static uint16_t capturePreActual;
+static uint16_t capturePostLeft;
+static bool     captureManual = false;
+static uint8_t  captureCause;
+static uint32_t captureTriggerTime;
+static uint16_t captureIntervalUs;
+static bool     captureDone = false;
+static bool     captureWake = false;
+#endif
+
+#if USE_SPECTRUM
+static void     (*spectrumCallbackG)(const Spectrum_t *spectrum);
+static uint16_t spectrumLength = SPECTRUM_SAMPLES_DEFAULT;
+static uint16_t spectrumFreq = SPECTRUM_FREQ_DEFAULT;
+static uint8_t  spectrumAxis = ACCORI_SPECTRUM_AXIS_MAGNITUDE;
+static uint16_t spectrumIntervalMs = SPECTRUM_INTERVAL_MS_DEFAULT;
+static uint8_t  spectrumDecimation = 1;
+static uint8_t  spectrumDecimationCnt = 0;
+static uint16_t spectrumCount = 0;
+static uint32_t spectrumSkip = 0;
+static SpectrumWork_t spectrumWork;     // The window as it is collected
+#endif
+
+#if USE_ACTIVITY
+static ActivityClassifier_t activityClassifier;
+static void     (*activityCallbackG)(const AccoriActivity_t *activity);
+static uint8_t  activityDecimation = 1;
+static uint8_t  activityDecimationCnt = 0;
+static int32_t  activityAccumulator[3];
+static uint32_t activityTime;
+static bool     activityChanged = false;
+#endif
+
+#if USE_ORIENTATION_BENCHMARK
+static volatile OrientationCycles_t orientationCycles = { UINT32_MAX, 0, 0, 0 };
+#endif
+
 /***************************************************************************************************
  * Public Variables
  **************************************************************************************************/
@@ -109,18 +465,144 @@ static void resetData(void)
   for (uint8_t i = 0; i < 3; i++) {
     accSensor[i] = 0;
     gyrSensor[i] = 0;
+    gyrRate[i] = 0;
     accAccumulator[i] = 0;
     oriCalculated[i] = 0;
+    linearAccumulator[i] = 0;
+    linearVelocity[i] = 0;
   }
+  linearAccumulatorCnt = 0;
   imuVectorReset(accVec);
   imuDcmReset(dcmMatrix);
   imuSensorFusionGyroCorrClr(&sensorFusionData);
+#if !IMU_FIXED_POINT
+  imuQuatReset(&quatFusionData);
+#endif
+  fusionRenormCountDown = FUSION_RENORM_DIVISOR;
+  fusionCorrectionCountDown = FUSION_CORRECTION_DIVISOR;
+#if USE_GYRO_BIAS_ESTIMATION
+  gyroBiasReset(&gyroBias, 1);
+#endif
+}
+
+#if USE_MEASURED_DT
+static void sampleTimeRestart(void)
+{
+  uint32_t edgeTime;
+
+  // Forget edges from before, e.g. wake on motion
+  (void)appInterruptAccGyroEdgeGet(&edgeTime);
+  sampleTimeValid = false;
+#if USE_MPU6500_FIFO
+  fifoPeriodQ8 = ((uint32_t)RAW_TIMESTAMP_FREQ << 8) / sensorFreq;
+#endif
+}
+
+static void sampleTimeUpdate(uint32_t time, uint32_t freq)
+{
+  uint32_t dt = time - sampleTimeLast;
+  uint32_t nominal = RAW_TIMESTAMP_FREQ / freq;
+
+  sensorDt = 0;
+  if (sampleTimeValid && (dt > 0) && (dt <= MEASURED_DT_MAX_PERIODS * nominal)) {
+    sensorDt = dt;
+  }
+  sampleTimeLast = time;
+  sampleTimeValid = true;
+}
+#endif
+
+#if USE_DMP_FUSION
+static void dmpMatrixUpdate(const Mpu6500Quat_t *quat)
+{
+  float r[3][3];
+
+  // Rotation of the quaternion, from the sensor axes to the world axes
+  dmpQuatToMatrix(quat->q, r);
+
+  // The DMP doesn't know the mounting, so turn the sensor axes into board axes
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint8_t j = 0; j < 3; j++) {
+      ImuFloat_t value = r[i][mounting[j] & ACCORI_MOUNTING_AXIS_MASK];
+
+      dmpMatrix[i][j] = (mounting[j] & ACCORI_MOUNTING_NEGATE) ? -value : value;
+    }
+  }
+}
+
+static uint16_t dmpRead(void)
+{
+  Mpu6500Quat_t quats[DMP_READ_BATCH];
+  uint16_t count;
+  uint16_t total = 0;
+
+  // Only the newest quaternion matters
+  do {
+    if (!mpu6500_DmpQuatRead(i2cInit.port, MPU6500_ADDR, quats, DMP_READ_BATCH, &count)) {
+      break;
+    }
+    if (count > 0) {
+      dmpMatrixUpdate(&quats[count - 1]);
+    }
+    total += count;
+  } while (count == DMP_READ_BATCH);
+
+  return total;
+}
+
+// Hand the DMP orientation over to the host fusion
+static void dmpHandover(void)
+{
+  if (fusionEngine == fusionEngineDcm) {
+    memcpy(dcmMatrix, dmpMatrix, sizeof(dcmMatrix));
+    return;
+  }
+
+  dmpQuatFromMatrix((const float (*)[3])dmpMatrix, quatFusionData.q);
 }
+#endif
+
+#if USE_CAPTURE
+static bool captureRunning(void)
+{
+  return (captureState == accoriCaptureArmed) || (captureState == accoriCaptureTriggered);
+}
+#endif
 
 static void interruptEnable(bool enable)
 {
   if (enable) {
-#if USE_MPU6500_INTERRUPT
+#if USE_MPU6500_INTERRUPT && USE_MPU6500_FIFO
+    uint32_t fifoPeriodMs = 1000 * MPU6500_FIFO_WATERMARK / sensorIntFreq;
+
+    if (fifoPeriodMs > sensorIntPeriodMs) {
+      fifoPeriodMs = sensorIntPeriodMs;
+    }
+
+#if USE_DMP_FUSION
+    if (dmpActive) {
+      // A few quaternions per notification period, far below the FIFO size
+      mpu6500_ConfigureDmp(i2cInit.port, MPU6500_ADDR, true, DMP_QUAT_FREQ);
+      fifoPeriodMs = sensorIntPeriodMs;
+    } else
+#endif
+    {
+      mpu6500_ConfigureFifo(i2cInit.port, MPU6500_ADDR, true, sensorIntFreq);
+    }
+    mpu6500_InterruptAcknowledge(i2cInit.port, MPU6500_ADDR);
+
+    // The MPU6500 has no FIFO watermark interrupt, so drain it periodically.
+    // The overflow interrupt still drains it if the timer is late.
+    gecko_cmd_hardware_set_soft_timer(TIMER_MS_2_TIMERTICK(fifoPeriodMs),
+                                      ACCORI_DEVICE_FIFO_TIMER, false);
+
+    sensorFreq = sensorIntFreq;
+#if USE_DMP_FUSION
+    if (dmpActive) {
+      sensorFreq = DMP_QUAT_FREQ;
+    }
+#endif
+#elif USE_MPU6500_INTERRUPT
     mpu6500_ConfigureInterrupt(i2cInit.port, MPU6500_ADDR, true, sensorIntFreq);
     mpu6500_InterruptAcknowledge(i2cInit.port, MPU6500_ADDR);
 
@@ -132,200 +614,1317 @@ static void interruptEnable(bool enable)
     mpu6500_ConfigureInterrupt(i2cInit.port, MPU6500_ADDR, false, MPU6500_MAX_FREQ);
     sensorFreq = sensorPollFreq;
 #endif
+#if USE_GYRO_BIAS_ESTIMATION
+    gyroBiasSetWindow(&gyroBias, sensorFreq * GYRO_BIAS_WINDOW_SEC);
+#endif
+#if USE_MEASURED_DT
+    sampleTimeRestart();
+#endif
+#if USE_MOTION_EVENTS
+    motionEventSetFreq(&motionEventDetector, sensorFreq);
+#endif
+#if USE_SPECTRUM
+    spectrumCount = 0;
+    spectrumDecimationCnt = 0;
+#endif
+    sensorRunning = true;
   } else {
-#if USE_MPU6500_INTERRUPT
+    sensorRunning = false;
+#if USE_MPU6500_INTERRUPT && USE_MPU6500_FIFO
+    gecko_cmd_hardware_set_soft_timer(TIMER_STOP, ACCORI_DEVICE_FIFO_TIMER, false);
+    // Stops the DMP too
+    mpu6500_ConfigureFifo(i2cInit.port, MPU6500_ADDR, false, sensorIntFreq);
+#elif USE_MPU6500_INTERRUPT
     // Turn off interrupt generation if not used by orientation measurement
     mpu6500_ConfigureInterrupt(i2cInit.port, MPU6500_ADDR, false, sensorIntFreq);
 #endif
   }
 }
 
-static void accelerationEnable(bool enable)
+#if USE_WAKE_ON_MOTION
+static void wakeOnMotionArm(bool arm)
 {
-  if (mpu6500Detected) {
-    accelerationEnabled = enable;
-    mpu6500_ConfigureAccelEnable(i2cInit.port, MPU6500_ADDR, enable);
-    if (enable) {
-      mpu6500_ConfigureAccelRate(i2cInit.port, MPU6500_ADDR, mpu6500AccelFreq_5Hz);
-      mpu6500_ConfigureAccelScale(i2cInit.port, MPU6500_ADDR, mpu6500AccelScale_16g);
-    }
-    if (!orientationEnabled) {
-      interruptEnable(enable);
-    }
+  if (arm != wakeOnMotionArmed) {
+    wakeOnMotionArmed = arm;
+    mpu6500_ConfigureWakeOnMotion(i2cInit.port, MPU6500_ADDR, arm,
+                                  WAKE_ON_MOTION_THRESHOLD_MG, WAKE_ON_MOTION_FREQ);
   }
 }
+#endif
 
-static void orientationEnable(bool enable)
+static const SensorRate_t *sensorRateFind(uint32_t freq)
 {
-  if (mpu6500Detected) {
-    orientationEnabled = enable;
-    mpu6500_ConfigureGyroEnable(i2cInit.port, MPU6500_ADDR, enable);
-    if (enable) {
-      mpu6500_ConfigureGyroRate(i2cInit.port, MPU6500_ADDR, mpu6500GyroFreq_184Hz);
-      mpu6500_ConfigureGyroScale(i2cInit.port, MPU6500_ADDR, mpu6500GyroScale_2000);
-    }
-    if (!accelerationEnabled) {
-      interruptEnable(enable);
+  for (uint8_t i = 0; i < SENSOR_RATE_COUNT; i++) {
+    if (sensorRates[i].freq >= freq) {
+      return &sensorRates[i];
     }
   }
+  return &sensorRates[SENSOR_RATE_COUNT - 1];
 }
 
-static void vReadSensors(bool wait)
+static const SensorRate_t *sensorRateSelect(void)
 {
-  bool accRangeError;
-  bool gyrRangeError;
-
-  mpu6500_Measure(i2cInit.port, MPU6500_ADDR,
-                  &accSensor[0], &accSensor[1], &accSensor[2],
-                  &accRangeError,
-                  &gyrSensor[0], &gyrSensor[1], &gyrSensor[2],
-                  &gyrRangeError,
-                  wait);
+#if USE_ADAPTIVE_RATE
+  uint32_t freq = 0;
 
-#if SWAP_AXES_FOR_CAR_DEMO
-  int16_t tmp;
-
-  // Swap X and Y, change sign for Z.
-  // For accelerometer
-  tmp = accSensor[0];
-  accSensor[0] = accSensor[1];
-  accSensor[1] = tmp;
-  accSensor[2] = -accSensor[2];
-  // For gyro
-  tmp = gyrSensor[0];
-  gyrSensor[0] = gyrSensor[1];
-  gyrSensor[1] = tmp;
-  gyrSensor[2] = -gyrSensor[2];
-#endif
-
-  accVec[0] = mpu6500_AccelRegToG(accSensor[0]);
-  accVec[1] = mpu6500_AccelRegToG(accSensor[1]);
-  accVec[2] = mpu6500_AccelRegToG(accSensor[2]);
-  imuVectorScale(accVec, 1.0 / 1000);
-
-  accAccumulator[0] += mpu6500_AccelRegToG(accSensor[0]);
-  accAccumulator[1] += mpu6500_AccelRegToG(accSensor[1]);
-  accAccumulator[2] += mpu6500_AccelRegToG(accSensor[2]);
-  accAccumulatorCnt++;
+  if (orientationEnabled) {
+    freq = MPU6500_INTERRUPT_FREQ;
+  }
+  if (accelerationEnabled) {
+    uint32_t accFreq = 1000 * ACC_SAMPLES_PER_PERIOD / accPeriodMs;
 
-#if USE_SENSOR_ERROR_LED
-  if (accRangeError) {
-    // Turn on accelerometer error LED for 2 seconds
-    appHwLedOn(ERROR_LED_ACC);
-    errorAccCntDown = sensorFreq * 2;
+    if (accFreq > freq) {
+      freq = accFreq;
+    }
   }
-  if (gyrRangeError) {
-    // Turn on gyro error LED for 2 seconds
-    appHwLedOn(ERROR_LED_GYR);
-    errorGyrCntDown = sensorFreq * 2;
+#if USE_RAW_STREAM
+  if (rawEnabled && (rawFreq > freq)) {
+    freq = rawFreq;
+  }
+#endif
+#if USE_MOTION_EVENTS
+  if ((eventCallbackG || eventWakeArmed) && (MOTION_EVENT_FREQ > freq)) {
+    freq = MOTION_EVENT_FREQ;
   }
 #endif
+#if USE_CAPTURE
+  if (captureRunning() && (CAPTURE_FREQ > freq)) {
+    freq = CAPTURE_FREQ;
+  }
+#endif
+#if USE_ACTIVITY
+  if (activityCallbackG && (ACTIVITY_FREQ > freq)) {
+    freq = ACTIVITY_FREQ;
+  }
+#endif
+#if USE_SPECTRUM
+  if (spectrumCallbackG && (spectrumFreq > freq)) {
+    freq = spectrumFreq;
+  }
+#endif
+  return sensorRateFind(freq);
+#else
+  return &sensorRates[SENSOR_RATE_COUNT - 1];
+#endif
 }
 
-static void vCalculateOrientation(int16_t freq)
+static void sensorRateUpdate(void)
 {
-  ImuFloat_t gyr[3];
-  ImuFloat_t ori[3];
+  const SensorRate_t *rate;
+  Mpu6500AccelFreq_t accFilter;
+  bool accOn = accelerationEnabled;
+  bool gyrOn = orientationEnabled;
+#if USE_MPU6500_INTERRUPT
+  uint16_t periodMs = UINT16_MAX;
+#endif
 
-  gyr[0] = (ImuFloat_t)mpu6500_GyroRegToAngle(gyrSensor[0]);
-  gyr[1] = (ImuFloat_t)mpu6500_GyroRegToAngle(gyrSensor[1]);
-  gyr[2] = (ImuFloat_t)mpu6500_GyroRegToAngle(gyrSensor[2]);
-  imuVectorScale(gyr, IMU_DEG_TO_RAD_FACTOR / 100 / freq);
+#if USE_WAKE_ON_MOTION
+  wakeOnMotionArm(false);
+#endif
+#if USE_RAW_STREAM
+  accOn = accOn || rawEnabled;
+  gyrOn = gyrOn || rawEnabled;
+#endif
+#if USE_MOTION_EVENTS
+  accOn = accOn || eventCallbackG || eventWakeArmed;
+#endif
+#if USE_CAPTURE
+  accOn = accOn || captureRunning();
+  gyrOn = gyrOn || captureRunning();
+#endif
+#if USE_SPECTRUM
+  accOn = accOn || spectrumCallbackG;
+#endif
+#if USE_ACTIVITY
+  accOn = accOn || activityCallbackG;
+#endif
+#if USE_DMP_FUSION
+  // The DMP needs the accelerometer as well
+  bool dmpOn = dmpLoaded && orientationEnabled && !accOn;
 
-#if USE_ANGULAR_ERROR_LED
-  // Check for large angles
-  double maxAng = fmax(fmax(gyr[0], gyr[1]), gyr[2]);
-  if (maxAng >= (ERROR_LEVEL_GYR_ANG * IMU_DEG_TO_RAD_FACTOR)) {
-    // Turn on angualr error LED for 2 seconds
-    appHwLedOn(ERROR_LED_ANG);
-    errorAngCntDown = sensorFreq * 2;
+  accOn = accOn || dmpOn;
+  if (dmpOn != dmpActive) {
+    // Switch over with a restart
+    interruptEnable(false);
+    if (dmpActive) {
+      dmpHandover();
+    }
+    dmpActive = dmpOn;
   }
 #endif
+  mpu6500_ConfigureAccelEnable(i2cInit.port, MPU6500_ADDR, accOn);
+  mpu6500_ConfigureGyroEnable(i2cInit.port, MPU6500_ADDR, gyrOn);
 
-  // Adjust the gyro with values from previous calculation.
-  imuSensorFusionGyroCorrDo(&sensorFusionData, gyr);
+  if (!accOn && !gyrOn) {
+    interruptEnable(false);
+    return;
+  }
 
-  imuDcmRotate(dcmMatrix, gyr);
-  imuDcmNormalize(dcmMatrix);
+  rate = sensorRateSelect();
+  accFilter = rate->accFilter;
+#if USE_ACTIVITY
+  if (activityCallbackG) {
+    accFilter = ACTIVITY_ACC_FILTER;
+  }
+#endif
+#if USE_MOTION_EVENTS
+  if (eventCallbackG || eventWakeArmed) {
+    accFilter = MOTION_EVENT_ACC_FILTER;
+  }
+#endif
+#if USE_CAPTURE
+  if (captureRunning()) {
+    accFilter = CAPTURE_ACC_FILTER;
+  }
+#endif
+#if USE_SPECTRUM
+  if (spectrumCallbackG) {
+    accFilter = SPECTRUM_ACC_FILTER;
+  }
+#endif
+  if (accOn) {
+    mpu6500_ConfigureAccelScale(i2cInit.port, MPU6500_ADDR, mpu6500AccelScale_16g);
+    mpu6500_ConfigureAccelRate(i2cInit.port, MPU6500_ADDR, accFilter);
+  }
+  if (gyrOn) {
+    mpu6500_ConfigureGyroScale(i2cInit.port, MPU6500_ADDR, mpu6500GyroScale_2000);
+    mpu6500_ConfigureGyroRate(i2cInit.port, MPU6500_ADDR, rate->gyrFilter);
+  }
+#if USE_RAW_STREAM
+  rawDecimation = (rawFreq < rate->freq) ? (uint8_t)(rate->freq / rawFreq) : 1;
+#endif
+#if USE_SPECTRUM
+  spectrumDecimation = (spectrumFreq < rate->freq) ? (uint8_t)(rate->freq / spectrumFreq) : 1;
+#endif
+#if USE_ACTIVITY
+  activityDecimation = (ACTIVITY_FREQ < rate->freq) ? (uint8_t)(rate->freq / ACTIVITY_FREQ) : 1;
+  activityDecimationCnt = 0;
+  activityAccumulator[0] = 0;
+  activityAccumulator[1] = 0;
+  activityAccumulator[2] = 0;
+#endif
 
-  imuDcmGetAngles(dcmMatrix, ori);
-  oriCalculated[0] = (int16_t)(ori[0] * IMU_RAD_TO_DEG_FACTOR * 100);
-  oriCalculated[1] = (int16_t)(ori[1] * IMU_RAD_TO_DEG_FACTOR * 100);
-  oriCalculated[2] = (int16_t)(ori[2] * IMU_RAD_TO_DEG_FACTOR * 100);
+#if USE_MPU6500_INTERRUPT
+  if (accelerationEnabled && (accPeriodMs < periodMs)) {
+    periodMs = accPeriodMs;
+  }
+  if (orientationEnabled && (oriPeriodMs < periodMs)) {
+    periodMs = oriPeriodMs;
+  }
+  if (periodMs == UINT16_MAX) {
+    periodMs = ACC_PERIOD_DEFAULT_MS;
+  }
 
-  // Calculate new sensor fusion values.
-  imuSensorFusionGyroCorrCalc(&sensorFusionData,
-                              ori,
-                              accelerationEnabled, accVec,
-                              false, 0,
-                              freq);
+  // Only restart the sampling if something changed, as that drops the samples
+  // not yet collected
+  if (sensorRunning && (rate->freq == sensorIntFreq) && (periodMs == sensorIntPeriodMs)) {
+    return;
+  }
+  sensorIntFreq = rate->freq;
+  sensorIntPeriodMs = periodMs;
+#endif
+  interruptEnable(true);
 }
 
-/***************************************************************************************************
- * Public Function Definitions
- **************************************************************************************************/
-void accoriDeviceInit(void)
+static void accelerationEnable(bool enable)
 {
-  resetData();
-  mpu6500Detected = mpu6500_Detect(i2cInit.port, MPU6500_ADDR);
-  accoriDeviceSleep();
+  if (mpu6500Detected) {
+    accelerationEnabled = enable;
+    sensorRateUpdate();
+  }
 }
 
-void accoriDeviceDeInit(void)
+static void orientationEnable(bool enable)
 {
-  accoriDeviceSleep();
+  if (mpu6500Detected) {
+    orientationEnabled = enable;
+    sensorRateUpdate();
+  }
 }
 
-void accoriDeviceConnectionOpened(void)
+#if USE_RAW_STREAM
+static void rawEnable(bool enable)
 {
-  // Nothing to do
+  if (mpu6500Detected) {
+    rawEnabled = enable;
+    rawFirst = 0;
+    rawCount = 0;
+    rawDecimationCnt = 0;
+    sensorRateUpdate();
+  }
 }
 
-void accoriDeviceConnectionClosed(void)
+static void rawStore(void)
 {
-  accoriDeviceSleep();
-}
+  uint16_t i;
 
-uint8_t accoriDeviceTest(void)
-{
-  return mpu6500Detected ? 0 : 1;
-}
+  if (!rawEnabled) {
+    return;
+  }
+  if (++rawDecimationCnt < rawDecimation) {
+    return;
+  }
+  rawDecimationCnt = 0;
 
-void accoriDeviceSleep(void)
-{
-  accelerationNotification = false;
-  orientationNotification = false;
-  if (!calibrationInProgress) {
-    accelerationEnable(false);
-    orientationEnable(false);
+  // Drop the oldest sample when full
+  if (rawCount == RAW_BUFFER_SAMPLES) {
+    rawFirst = (rawFirst + 1) % RAW_BUFFER_SAMPLES;
+    rawCount--;
+    rawSequence++;
   }
+  i = (rawFirst + rawCount) % RAW_BUFFER_SAMPLES;
+  for (uint8_t j = 0; j < 3; j++) {
+    rawSamples[i].acc[j] = accSensor[j];
+    rawSamples[i].gyr[j] = gyrSensor[j];
+  }
+  rawTimes[i] = sensorTime;
+  rawCount++;
 }
+#endif
 
-void accoriDeviceAccelerationCharStatusChange(uint8_t connection,
-                                              uint16_t clientConfig)
+#if USE_MOTION_EVENTS
+static void motionEventDetect(const int32_t accMg[3])
 {
-  accelerationNotification = (clientConfig != 0);
-  accelerationEnable(accelerationNotification);
+  MotionEvent_t events[MOTION_EVENT_MAX];
+  uint8_t count;
+
+  if (!eventCallbackG && !eventWakeArmed) {
+    return;
+  }
+  // Queued until the samples are processed, as the callbacks may reconfigure
+  // the sensor
+  count = motionEventUpdate(&motionEventDetector, accMg, sensorTime, events);
+  for (uint8_t i = 0; (i < count) && (eventQueueCnt < MOTION_EVENT_QUEUE); i++) {
+    eventQueue[eventQueueCnt++] = events[i];
+  }
 }
 
-void accoriDeviceOrientationCharStatusChange(uint8_t connection,
-                                             uint16_t clientConfig)
+static void motionEventDeliver(void)
 {
-  orientationNotification = (clientConfig != 0);
-  orientationEnable(orientationNotification);
+  bool wake = false;
+
+  for (uint8_t i = 0; i < eventQueueCnt; i++) {
+    eventLast = eventQueue[i];
+    eventLastValid = true;
+    if (eventCallbackG) {
+      eventCallbackG(&eventQueue[i]);
+    }
+    if (eventWakeArmed && (eventQueue[i].type & eventWakeMask)) {
+      wake = true;
+    }
+  }
+  eventQueueCnt = 0;
+
+  if (wake) {
+    eventWakeArmed = false;
+    sensorRateUpdate();
+    if (motionCallbackG) {
+      motionCallbackG();
+    }
+  }
 }
+#endif
 
-void accoriDeviceAccelerationRead(int16_t *accX, int16_t *accY, int16_t *accZ)
+#if USE_CAPTURE
+static void captureStore(const int32_t accMg[3], bool rangeError)
 {
-#if USE_MPU6500_INTERRUPT
-  // nop
-#else
-  vReadSensors(true, sensorPollFreq);
-#endif
-  if (accAccumulatorCnt) {
-    *accX = (int16_t)(accAccumulator[0] / accAccumulatorCnt);
-    *accY = (int16_t)(accAccumulator[1] / accAccumulatorCnt);
-    *accZ = (int16_t)(accAccumulator[2] / accAccumulatorCnt);
+  AccoriRawSample_t *sample;
+  uint32_t magnitudeSq = 0;
+  uint8_t cause = 0;
+
+  if (!captureRunning()) {
+    return;
+  }
+
+  sample = &captureSamples[captureHead];
+  for (uint8_t j = 0; j < 3; j++) {
+    sample->acc[j] = accSensor[j];
+    sample->gyr[j] = gyrSensor[j];
+    magnitudeSq += (uint32_t)(accMg[j] * accMg[j]);
+  }
+  captureHead = (captureHead + 1) % CAPTURE_SAMPLES;
+  if (captureFill < CAPTURE_SAMPLES) {
+    captureFill++;
+  }
+
+  if (captureState == accoriCaptureArmed) {
+    if ((captureTriggers & ACCORI_CAPTURE_TRIGGER_ACC) && (magnitudeSq > captureThresholdSq)) {
+      cause |= ACCORI_CAPTURE_TRIGGER_ACC;
+    }
+    if ((captureTriggers & ACCORI_CAPTURE_TRIGGER_RANGE) && rangeError) {
+      cause |= ACCORI_CAPTURE_TRIGGER_RANGE;
+    }
+    if (captureManual) {
+      cause |= ACCORI_CAPTURE_TRIGGER_MANUAL;
+    }
+    if (cause) {
+      // Less lead-in if armed only just before
+      captureCause = cause;
+      captureManual = false;
+      captureTriggerTime = sensorTime;
+      captureIntervalUs = (uint16_t)(1000000UL / sensorFreq);
+      capturePreActual = (captureFill - 1 < capturePre) ? (captureFill - 1) : capturePre;
+      capturePostLeft = capturePost;
+      captureState = accoriCaptureTriggered;
+    }
+  } else if (capturePostLeft) {
+    capturePostLeft--;
+  }
+
+  // Stopping the sensors waits until the samples are processed
+  if ((captureState == accoriCaptureTriggered) && (capturePostLeft == 0)) {
+    captureState = accoriCaptureFrozen;
+    captureDone = true;
+  }
+}
+
+static void captureProcessed(void)
+{
+  if (captureDone) {
+    captureDone = false;
+    sensorRateUpdate();
+    if (captureWake) {
+      captureWake = false;
+      if (motionCallbackG) {
+        motionCallbackG();
+      }
+    }
+  }
+}
+#endif
+
+#if USE_SPECTRUM
+static void spectrumStore(const int32_t accMg[3])
+{
+  int32_t value;
+
+  // Full windows wait to be processed, then the rest of the interval is skipped
+  if (!spectrumCallbackG || (spectrumCount == spectrumLength)) {
+    return;
+  }
+  if (spectrumSkip) {
+    spectrumSkip--;
+    return;
+  }
+  if (++spectrumDecimationCnt < spectrumDecimation) {
+    return;
+  }
+  spectrumDecimationCnt = 0;
+
+  if (spectrumAxis < 3) {
+    value = accMg[spectrumAxis];
+  } else {
+    value = (int32_t)sqrtf((float)(accMg[0] * accMg[0] + accMg[1] * accMg[1] + accMg[2] * accMg[2]));
+  }
+  spectrumWork.x[spectrumCount++] = (float)value;
+}
+
+static void spectrumProcessed(void)
+{
+  Spectrum_t spectrum;
+  uint32_t windowSamples;
+  uint32_t intervalSamples;
+
+  if (!spectrumCallbackG || (spectrumCount < spectrumLength)) {
+    return;
+  }
+
+  spectrumCompute(&spectrumWork, spectrumLength, sensorFreq / spectrumDecimation, &spectrum);
+  spectrumCount = 0;
+
+  // In sensor samples
+  windowSamples = (uint32_t)spectrumLength * spectrumDecimation;
+  intervalSamples = (uint32_t)spectrumIntervalMs * sensorFreq / 1000;
+  spectrumSkip = (intervalSamples > windowSamples) ? (intervalSamples - windowSamples) : 0;
+
+  spectrumCallbackG(&spectrum);
+}
+#endif
+
+#if USE_ACTIVITY
+static void activityStore(const int32_t accMg[3])
+{
+  int32_t acc[3];
+
+  if (!activityCallbackG) {
+    return;
+  }
+  // Averaged rather than just decimated, to keep the vibrations from aliasing
+  for (uint8_t i = 0; i < 3; i++) {
+    activityAccumulator[i] += accMg[i];
+  }
+  if (++activityDecimationCnt < activityDecimation) {
+    return;
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    acc[i] = activityAccumulator[i] / activityDecimation;
+    activityAccumulator[i] = 0;
+  }
+  activityDecimationCnt = 0;
+
+  if (activityUpdate(&activityClassifier, acc)) {
+    activityTime = sensorTime;
+    activityChanged = true;
+  }
+}
+
+static void activityProcessed(void)
+{
+  AccoriActivity_t activity;
+
+  if (!activityChanged) {
+    return;
+  }
+  activityChanged = false;
+  if (activityCallbackG && accoriDeviceActivityRead(&activity)) {
+    activityCallbackG(&activity);
+  }
+}
+#endif
+
+static bool mountingValid(const uint8_t rotation[3])
+{
+  uint8_t axis[3];
+  uint8_t axes = 0;
+  uint8_t negated = 0;
+  bool oddPermutation;
+
+  for (uint8_t i = 0; i < 3; i++) {
+    axis[i] = rotation[i] & ACCORI_MOUNTING_AXIS_MASK;
+
+    if ((rotation[i] & ~(ACCORI_MOUNTING_AXIS_MASK | ACCORI_MOUNTING_NEGATE)) || (axis[i] > 2)) {
+      return false;
+    }
+    axes |= 1 << axis[i];
+    if (rotation[i] & ACCORI_MOUNTING_NEGATE) {
+      negated++;
+    }
+  }
+  if (axes != 0x07) {
+    return false;
+  }
+
+  // The even permutations are the cyclic shifts. A rotation has an odd
+  // permutation with an odd number of negated axes, or even with even.
+  oddPermutation = ((axis[1] + 3 - axis[0]) % 3) != 1;
+  return oddPermutation == ((negated & 1) != 0);
+}
+
+// From the sensor axes to the board axes, in sensor units
+static void mountingRotate(int16_t v[3])
+{
+  int16_t sensor[3] = { v[0], v[1], v[2] };
+
+  for (uint8_t i = 0; i < 3; i++) {
+    int16_t value = sensor[mounting[i] & ACCORI_MOUNTING_AXIS_MASK];
+
+    if (mounting[i] & ACCORI_MOUNTING_NEGATE) {
+      value = (value == INT16_MIN) ? INT16_MAX : -value;
+    }
+    v[i] = value;
+  }
+}
+
+static void mountingPsRestore(void)
+{
+  struct gecko_msg_flash_ps_load_rsp_t *psResp;
+
+  psResp = gecko_cmd_flash_ps_load(MOUNTING_PS_KEY);
+  if (psResp->result || (psResp->value.len != sizeof(mounting))
+      || !mountingValid(psResp->value.data)) {
+    return;
+  }
+  memcpy(mounting, psResp->value.data, sizeof(mounting));
+}
+
+static void vProcessSample(bool accRangeError, bool gyrRangeError)
+{
+  int32_t accMg[3];
+
+  // Everything from here on, the raw stream too, is in board axes
+  mountingRotate(accSensor);
+  mountingRotate(gyrSensor);
+
+#if USE_RAW_STREAM
+  rawStore();
+#endif
+
+  for (uint8_t i = 0; i < 3; i++) {
+    accMg[i] = mpu6500_AccelRegToG(accSensor[i]);
+    accVec[i] = imuFromRatio(accMg[i], 1000);
+    accAccumulator[i] += accMg[i];
+    gyrRate[i] = mpu6500_GyroRegToAngle(gyrSensor[i]);
+  }
+  accAccumulatorCnt++;
+#if USE_CAPTURE
+  captureStore(accMg, accRangeError || gyrRangeError);
+#endif
+#if USE_MOTION_EVENTS
+  motionEventDetect(accMg);
+#endif
+#if USE_SPECTRUM
+  spectrumStore(accMg);
+#endif
+#if USE_ACTIVITY
+  activityStore(accMg);
+#endif
+
+#if USE_GYRO_BIAS_ESTIMATION
+  // The calibration changes the sensor offsets, so leave it alone until done
+  if (!calibrationInProgress) {
+    gyroBiasUpdate(&gyroBias, gyrRate, accelerationEnabled ? accMg : NULL);
+  }
+  gyrRate[0] -= gyroBiasGet(&gyroBias, 0);
+  gyrRate[1] -= gyroBiasGet(&gyroBias, 1);
+  gyrRate[2] -= gyroBiasGet(&gyroBias, 2);
+#endif
+
+#if USE_SENSOR_ERROR_LED
+  if (accRangeError) {
+    // Turn on accelerometer error LED for 2 seconds
+    appHwLedOn(ERROR_LED_ACC);
+    errorAccCntDown = sensorFreq * 2;
+  }
+  if (gyrRangeError) {
+    // Turn on gyro error LED for 2 seconds
+    appHwLedOn(ERROR_LED_GYR);
+    errorGyrCntDown = sensorFreq * 2;
+  }
+#endif
+}
+
+#if !USE_MPU6500_FIFO || !USE_MPU6500_INTERRUPT
+static void vReadSensors(bool wait)
+{
+  bool accRangeError;
+  bool gyrRangeError;
+
+  mpu6500_Measure(i2cInit.port, MPU6500_ADDR,
+                  &accSensor[0], &accSensor[1], &accSensor[2],
+                  &accRangeError,
+                  &gyrSensor[0], &gyrSensor[1], &gyrSensor[2],
+                  &gyrRangeError,
+                  wait);
+  sensorTime = RTCC_CounterGet();
+#if USE_MEASURED_DT
+#if USE_MPU6500_INTERRUPT
+  uint32_t edgeTime;
+
+  // The data ready edge is when the sample was taken
+  if (appInterruptAccGyroEdgeGet(&edgeTime) > 0) {
+    sensorTime = edgeTime;
+  }
+#endif
+  sampleTimeUpdate(sensorTime, sensorFreq);
+#endif
+
+  vProcessSample(accRangeError, gyrRangeError);
+}
+#endif
+
+#if USE_ORIENTATION_BENCHMARK
+static void benchmarkInit(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static void benchmarkRecord(uint32_t start)
+{
+  uint32_t cycles = DWT->CYCCNT - start;
+
+  orientationCycles.last = cycles;
+  orientationCycles.count++;
+  if (cycles < orientationCycles.min) {
+    orientationCycles.min = cycles;
+  }
+  if (cycles > orientationCycles.max) {
+    orientationCycles.max = cycles;
+  }
+}
+#endif
+
+static void vCalculateAngles(void)
+{
+  ImuFloat_t ori[3];
+
+#if USE_DMP_FUSION
+  if (dmpActive) {
+    imuDcmGetAngles(dmpMatrix, ori);
+  } else
+#endif
+#if !IMU_FIXED_POINT
+  if (fusionEngine != fusionEngineDcm) {
+    imuQuatGetAngles(&quatFusionData, ori);
+  } else
+#endif
+  {
+    imuDcmGetAngles(dcmMatrix, ori);
+  }
+
+  // From radians to 0.01 deg, via fractions of PI to stay within range
+  oriCalculated[0] = (int16_t)imuToInt(imuMul(ori[0], IMU_CONST(1 / IMU_PI)), 18000);
+  oriCalculated[1] = (int16_t)imuToInt(imuMul(ori[1], IMU_CONST(1 / IMU_PI)), 18000);
+  oriCalculated[2] = (int16_t)imuToInt(imuMul(ori[2], IMU_CONST(1 / IMU_PI)), 18000);
+}
+
+static void vCalculateOrientationDcm(ImuFloat_t gyr[3], int16_t freq,
+                                     bool renormalize, bool correct)
+{
+  ImuFloat_t ori[3];
+
+  // Adjust the gyro with values from previous calculation. The correction is
+  // held between calculations, so the gain per second doesn't depend on the
+  // correction divisor.
+  imuSensorFusionGyroCorrDo(&sensorFusionData, gyr);
+
+  imuDcmRotate(dcmMatrix, gyr);
+  if (renormalize) {
+    imuDcmNormalize(dcmMatrix);
+  }
+
+  if (correct) {
+    // Calculate new sensor fusion values.
+    imuDcmGetAngles(dcmMatrix, ori);
+    imuSensorFusionGyroCorrCalc(&sensorFusionData,
+                                ori,
+                                accelerationEnabled, accVec,
+                                false, 0,
+                                freq);
+  }
+}
+
+#if !IMU_FIXED_POINT
+static void vCalculateOrientationQuat(ImuFloat_t gyr[3], int16_t freq,
+                                      bool renormalize, bool correct)
+{
+  // The correction is applied once per calculation, so it runs at the
+  // correction rate to keep the gain per second the same
+  int16_t correctionFreq = freq;
+
+  if (freq >= FUSION_MULTIRATE_MIN_FREQ) {
+    correctionFreq /= FUSION_CORRECTION_DIVISOR;
+  }
+
+  imuQuatRotate(&quatFusionData, gyr, freq);
+
+  if (correct) {
+    if (fusionEngine == fusionEngineMadgwick) {
+      imuQuatMadgwickCorrect(&quatFusionData,
+                             accelerationEnabled, accVec,
+                             IMU_CONST(FUSION_MADGWICK_BETA),
+                             correctionFreq);
+    } else {
+      imuQuatMahonyCorrect(&quatFusionData,
+                           accelerationEnabled, accVec,
+                           IMU_CONST(FUSION_MAHONY_KP), IMU_CONST(FUSION_MAHONY_KI),
+                           correctionFreq);
+    }
+  }
+
+  if (renormalize) {
+    imuQuatNormalize(&quatFusionData);
+  }
+}
+#endif
+
+static void vCalculateLinear(int16_t freq)
+{
+  ImuFloat_t (*dcm)[3] = dcmMatrix;
+  int32_t accMg[3];
+  int32_t linMg;
+  int64_t dt = RAW_TIMESTAMP_FREQ / freq;
+#if !IMU_FIXED_POINT
+  ImuFloat_t quatDcm[3][3];
+
+  if (fusionEngine != fusionEngineDcm) {
+    imuQuatGetDcm(&quatFusionData, quatDcm);
+    dcm = quatDcm;
+  }
+#endif
+#if USE_MEASURED_DT
+  if (sensorDt > 0) {
+    dt = sensorDt;
+  }
+#endif
+
+  for (uint8_t i = 0; i < 3; i++) {
+    accMg[i] = mpu6500_AccelRegToG(accSensor[i]);
+  }
+
+  for (uint8_t i = 0; i < 3; i++) {
+    // Into the world frame, where gravity is straight down the Z axis
+    linMg = imuToInt(dcm[i][0], accMg[0])
+            + imuToInt(dcm[i][1], accMg[1])
+            + imuToInt(dcm[i][2], accMg[2]);
+    if (i == 2) {
+      linMg -= 1000;
+    }
+    linearAccumulator[i] += linMg;
+
+    if ((linMg > -LINEAR_DEADBAND_MG) && (linMg < LINEAR_DEADBAND_MG)) {
+      linMg = 0;
+    }
+    linearVelocity[i] += (linMg * LINEAR_UM_PER_S_PER_MG * dt * (1 << LINEAR_VELOCITY_FRAC_BITS))
+                         / RAW_TIMESTAMP_FREQ;
+    linearVelocity[i] -= linearVelocity[i] * dt / LINEAR_VELOCITY_LEAK_TICKS;
+  }
+  linearAccumulatorCnt++;
+}
+
+static void vCalculateOrientation(int16_t freq)
+{
+  ImuFloat_t gyr[3];
+  bool renormalize;
+  bool correct;
+#if USE_ORIENTATION_BENCHMARK
+  uint32_t start = DWT->CYCCNT;
+#endif
+
+  // Angle turned since the previous sample, from 0.01 deg/s to radians
+  gyr[0] = imuFromRatio(gyrRate[0], 100 * freq);
+  gyr[1] = imuFromRatio(gyrRate[1], 100 * freq);
+  gyr[2] = imuFromRatio(gyrRate[2], 100 * freq);
+#if USE_MEASURED_DT
+  if (sensorDt > 0) {
+    // From the nominal to the measured period
+    imuVectorScale(gyr, imuFromRatio((int32_t)sensorDt * freq, RAW_TIMESTAMP_FREQ));
+  }
+#endif
+  imuVectorScale(gyr, IMU_CONST(IMU_DEG_TO_RAD_FACTOR));
+
+#if USE_ANGULAR_ERROR_LED
+  // Check for large angles
+  ImuFloat_t maxAng = gyr[0];
+  if (gyr[1] > maxAng) {
+    maxAng = gyr[1];
+  }
+  if (gyr[2] > maxAng) {
+    maxAng = gyr[2];
+  }
+  if (maxAng >= IMU_CONST(ERROR_LEVEL_GYR_ANG * IMU_DEG_TO_RAD_FACTOR)) {
+    // Turn on angualr error LED for 2 seconds
+    appHwLedOn(ERROR_LED_ANG);
+    errorAngCntDown = sensorFreq * 2;
+  }
+#endif
+
+  // Schedule the slower steps
+  if (freq >= FUSION_MULTIRATE_MIN_FREQ) {
+    renormalize = (--fusionRenormCountDown == 0);
+    correct = (--fusionCorrectionCountDown == 0);
+    if (renormalize) {
+      fusionRenormCountDown = FUSION_RENORM_DIVISOR;
+    }
+    if (correct) {
+      fusionCorrectionCountDown = FUSION_CORRECTION_DIVISOR;
+    }
+  } else {
+    renormalize = true;
+    correct = true;
+  }
+
+#if !IMU_FIXED_POINT
+  if (fusionEngine != fusionEngineDcm) {
+    vCalculateOrientationQuat(gyr, freq, renormalize, correct);
+  } else
+#endif
+  {
+    vCalculateOrientationDcm(gyr, freq, renormalize, correct);
+  }
+
+#if USE_ORIENTATION_BENCHMARK
+  benchmarkRecord(start);
+#endif
+
+  if (linearNotification) {
+    vCalculateLinear(freq);
+  }
+}
+
+#if USE_MPU6500_FIFO
+#if USE_MEASURED_DT
+// Time from the last sample of the previous batch to the newest sample. The
+// newest sample was taken on average half a period before the read, and the
+// reads only steer the period estimate, so the jitter of the reads doesn't
+// end up in the sample times.
+static uint32_t fifoBatchSpan(uint32_t readTime, uint16_t count)
+{
+  uint32_t nominal = ((uint32_t)RAW_TIMESTAMP_FREQ << 8) / sensorFreq;
+  uint32_t tolerance = nominal * MEASURED_DT_FIFO_TOLERANCE / 100;
+  uint32_t measured = ((readTime - fifoReadTimeLast) << 8) / count;
+  uint32_t newest;
+
+  fifoReadTimeLast = readTime;
+
+  if (sampleTimeValid
+      && (measured >= nominal - tolerance) && (measured <= nominal + tolerance)) {
+    fifoPeriodQ8 += ((int32_t)(measured - fifoPeriodQ8)) / MEASURED_DT_FIFO_GAIN;
+    newest = sampleTimeLast + ((count * fifoPeriodQ8) >> 8);
+    newest += ((int32_t)(readTime - (fifoPeriodQ8 >> 9) - newest)) / MEASURED_DT_FIFO_GAIN;
+  } else {
+    // Start over from this read, keeping the period estimate
+    sampleTimeLast = readTime - (fifoPeriodQ8 >> 9) - ((count * fifoPeriodQ8) >> 8);
+    sampleTimeValid = true;
+    newest = readTime - (fifoPeriodQ8 >> 9);
+  }
+
+  return newest - sampleTimeLast;
+}
+#endif
+
+static uint16_t vReadSensorsFifo(int16_t freq)
+{
+  uint16_t count;
+  uint32_t readTime;
+
+  // Nothing to process if the transfer failed
+  if (!mpu6500_FifoRead(i2cInit.port, MPU6500_ADDR,
+                        fifoSamples, MPU6500_FIFO_MAX_SAMPLES, &count)) {
+    return 0;
+  }
+  readTime = RTCC_CounterGet();
+#if USE_MEASURED_DT
+  uint32_t firstTime = 0;
+  uint32_t span = 0;
+
+  if (count > 0) {
+    span = fifoBatchSpan(readTime, count);
+    firstTime = sampleTimeLast;
+    sampleTimeLast += span;
+  }
+#endif
+
+  for (uint16_t i = 0; i < count; i++) {
+    for (uint8_t j = 0; j < 3; j++) {
+      accSensor[j] = fifoSamples[i].acc[j];
+      gyrSensor[j] = fifoSamples[i].gyr[j];
+    }
+#if USE_MEASURED_DT
+    // Spread evenly over the batch, the intervals add up to the span
+    uint32_t time = firstTime + (uint32_t)((uint64_t)span * (i + 1) / count);
+
+    sensorDt = time - (firstTime + (uint32_t)((uint64_t)span * i / count));
+    sensorTime = time;
+#else
+    // The last sample in the FIFO is the newest
+    sensorTime = readTime - (uint32_t)(count - 1 - i) * RAW_TIMESTAMP_FREQ / freq;
+#endif
+    vProcessSample(mpu6500_RangeError(fifoSamples[i].acc),
+                   mpu6500_RangeError(fifoSamples[i].gyr));
+    vCalculateOrientation(freq);
+  }
+
+  return count;
+}
+#endif
+
+#if USE_CALIBRATION_PS
+#if CALIBRATION_PS_SAVE_FUSION
+static uint8_t calibrationPsFusionEngine(void)
+{
+  return (uint8_t)fusionEngine | (IMU_FIXED_POINT ? CALIBRATION_PS_FUSION_FIXED : 0);
+}
+
+static ImuFloat_t calibrationPsDot(const ImuFloat_t *a, const ImuFloat_t *b, uint8_t n)
+{
+  ImuFloat_t dot = IMU_CONST(0);
+
+  for (uint8_t i = 0; i < n; i++) {
+    dot += imuMul(a[i], b[i]);
+  }
+  return dot;
+}
+
+// Close enough to unit length for the renormalization, which also rejects NaN
+static bool calibrationPsUnit(const ImuFloat_t *v, uint8_t n)
+{
+  ImuFloat_t norm = calibrationPsDot(v, v, n);
+
+  return (norm > IMU_CONST(0.9)) && (norm < IMU_CONST(1.1));
+}
+#endif
+
+static void calibrationPsSave(uint32_t minSeconds)
+{
+  CalibrationPs_t ps;
+  int32_t bias;
+
+  // Sensor run time since the last save
+  if (calibrationPsRunMs < (1000 * minSeconds)) {
+    return;
+  }
+  calibrationPsRunMs = 0;
+
+  memset(&ps, 0, sizeof(ps));
+  ps.version = CALIBRATION_PS_VERSION;
+  if (!mpu6500_GyroOffsetGet(i2cInit.port, MPU6500_ADDR, ps.gyrOffset)
+      || !mpu6500_TemperatureRead(i2cInit.port, MPU6500_ADDR, &ps.temperature)) {
+    return;
+  }
+#if USE_GYRO_BIAS_ESTIMATION
+  ps.biasValid = gyroBias.biasValid;
+  for (uint8_t i = 0; i < 3; i++) {
+    bias = gyroBiasGet(&gyroBias, i);
+    ps.gyrBias[i] = (int16_t)bias;
+  }
+#else
+  (void)bias;
+#endif
+#if CALIBRATION_PS_SAVE_FUSION
+  ps.fusionEngine = calibrationPsFusionEngine();
+  if (fusionEngine == fusionEngineDcm) {
+    memcpy(ps.fusion, dcmMatrix, 6 * sizeof(ImuFloat_t));
+  }
+#if !IMU_FIXED_POINT
+  else {
+    memcpy(ps.fusion, quatFusionData.q, 4 * sizeof(ImuFloat_t));
+  }
+#endif
+#endif
+
+  gecko_cmd_flash_ps_save(CALIBRATION_PS_KEY, sizeof(ps), (uint8_t *)&ps);
+}
+
+static void calibrationPsRestore(void)
+{
+  struct gecko_msg_flash_ps_load_rsp_t *psResp;
+  CalibrationPs_t ps;
+
+  psResp = gecko_cmd_flash_ps_load(CALIBRATION_PS_KEY);
+  if (psResp->result || (psResp->value.len != sizeof(ps))) {
+    return;
+  }
+  memcpy(&ps, psResp->value.data, sizeof(ps));
+  if (ps.version != CALIBRATION_PS_VERSION) {
+    return;
+  }
+
+  mpu6500_GyroOffsetSet(i2cInit.port, MPU6500_ADDR, ps.gyrOffset);
+#if USE_GYRO_BIAS_ESTIMATION
+  if (ps.biasValid) {
+    int32_t bias[3] = { ps.gyrBias[0], ps.gyrBias[1], ps.gyrBias[2] };
+
+    gyroBiasSet(&gyroBias, bias);
+    // The sensor is asleep, so check the temperature once it runs
+    calibrationPsTemperature = ps.temperature;
+    calibrationPsTemperatureCheck = true;
+  }
+#endif
+#if CALIBRATION_PS_SAVE_FUSION
+  if (ps.fusionEngine == calibrationPsFusionEngine()) {
+    if (fusionEngine == fusionEngineDcm) {
+      ImuFloat_t dot = calibrationPsDot(&ps.fusion[0], &ps.fusion[3], 3);
+
+      if (calibrationPsUnit(&ps.fusion[0], 3) && calibrationPsUnit(&ps.fusion[3], 3)
+          && (dot > IMU_CONST(-0.1)) && (dot < IMU_CONST(0.1))) {
+        memcpy(dcmMatrix, ps.fusion, 6 * sizeof(ImuFloat_t));
+        imuVectorCrossProduct(dcmMatrix[2], dcmMatrix[0], dcmMatrix[1]);
+        imuDcmNormalize(dcmMatrix);
+      }
+    }
+#if !IMU_FIXED_POINT
+    else if (calibrationPsUnit(ps.fusion, 4)) {
+      memcpy(quatFusionData.q, ps.fusion, 4 * sizeof(ImuFloat_t));
+      imuQuatNormalize(&quatFusionData);
+    }
+#endif
+  }
+#endif
+}
+
+static void calibrationPsProcessed(uint16_t samples)
+{
+  int16_t temperature;
+
+#if USE_GYRO_BIAS_ESTIMATION
+  if (calibrationPsTemperatureCheck
+      && mpu6500_TemperatureRead(i2cInit.port, MPU6500_ADDR, &temperature)) {
+    calibrationPsTemperatureCheck = false;
+    if (abs(temperature - calibrationPsTemperature) > CALIBRATION_PS_MAX_TEMP_DIFF) {
+      gyroBiasReset(&gyroBias, sensorFreq * GYRO_BIAS_WINDOW_SEC);
+    }
+  }
+#else
+  (void)temperature;
+#endif
+
+  // Counted in time, as the sample rate changes with the sensors in use
+  calibrationPsRunMs += (uint32_t)samples * 1000 / sensorFreq;
+  calibrationPsSave(CALIBRATION_PS_SAVE_INTERVAL_SEC);
+}
+#endif
+
+static void vSensorsProcessed(uint16_t samples)
+{
+  // Turn LED off when calibration ends
+  if (calibrationInProgress && !mpu6500_GyroCalibrateInProgress()) {
+    calibrationInProgress = false;
+    boardLedOff(CALIBRATION_LED);
+    calibrateDoneCallbackG();
+#if USE_CALIBRATION_PS
+    calibrationPsSave(0);
+#endif
+
+    // Turn off sensors if not used by notifications
+    if (!accelerationNotification && !motionNotification && !linearNotification) {
+      accelerationEnable(false);
+    }
+    if (!orientationNotification && !motionNotification && !linearNotification) {
+      orientationEnable(false);
+    }
+  }
+
+#if USE_SENSOR_ERROR_LED
+  // Turn off accelerometer error LED some time after error
+  if (errorAccCntDown) {
+    errorAccCntDown = (errorAccCntDown > samples) ? (errorAccCntDown - samples) : 0;
+    if (errorAccCntDown == 0) {
+      appHwLedOff(ERROR_LED_ACC);
+    }
+  }
+  // Turn off gyro error LED some time after error
+  if (errorGyrCntDown) {
+    errorGyrCntDown = (errorGyrCntDown > samples) ? (errorGyrCntDown - samples) : 0;
+    if (errorGyrCntDown == 0) {
+      appHwLedOff(ERROR_LED_GYR);
+    }
+  }
+#endif
+#if USE_ANGULAR_ERROR_LED
+  // Turn off angular error LED some time after error
+  if (errorAngCntDown) {
+    errorAngCntDown = (errorAngCntDown > samples) ? (errorAngCntDown - samples) : 0;
+    if (errorAngCntDown == 0) {
+      appHwLedOff(ERROR_LED_ANG);
+    }
+  }
+#endif
+
+#if USE_CALIBRATION_PS
+  calibrationPsProcessed(samples);
+#endif
+#if USE_MOTION_EVENTS
+  motionEventDeliver();
+#endif
+#if USE_CAPTURE
+  captureProcessed();
+#endif
+#if USE_SPECTRUM
+  spectrumProcessed();
+#endif
+#if USE_ACTIVITY
+  activityProcessed();
+#endif
+}
+
+/***************************************************************************************************
+ * Public Function Definitions
+ **************************************************************************************************/
+void accoriDeviceInit(void)
+{
+#if IMU_FIXED_POINT
+  fusionEngine = fusionEngineDcm;
+#else
+  fusionEngine = FUSION_ENGINE_DEFAULT;
+#endif
+  resetData();
+#if USE_MOTION_EVENTS
+  motionEventReset(&motionEventDetector, MOTION_EVENT_FREQ);
+#endif
+#if USE_ACTIVITY
+  activityReset(&activityClassifier);
+#endif
+  mpu6500Detected = mpu6500_Detect(i2cInit.port, MPU6500_ADDR);
+  mountingPsRestore();
+#if USE_DMP_FUSION
+  if (mpu6500Detected) {
+    dmpLoaded = mpu6500_DmpLoad(i2cInit.port, MPU6500_ADDR);
+  }
+#endif
+#if USE_ORIENTATION_BENCHMARK
+  benchmarkInit();
+#endif
+#if USE_CALIBRATION_PS
+  if (mpu6500Detected) {
+    calibrationPsRestore();
+  }
+#endif
+  accoriDeviceSleep();
+}
+
+void accoriDeviceDeInit(void)
+{
+  accoriDeviceSleep();
+}
+
+void accoriDeviceConnectionOpened(void)
+{
+  // Nothing to do
+}
+
+void accoriDeviceConnectionClosed(void)
+{
+  accoriDeviceSleep();
+}
+
+uint8_t accoriDeviceTest(void)
+{
+  return mpu6500Detected ? 0 : 1;
+}
+
+void accoriDeviceSleep(void)
+{
+  accelerationNotification = false;
+  orientationNotification = false;
+  motionNotification = false;
+  linearNotification = false;
+#if USE_RAW_STREAM
+  rawEnabled = false;
+#endif
+#if USE_MOTION_EVENTS
+  eventCallbackG = NULL;
+  eventWakeArmed = false;
+  eventQueueCnt = 0;
+#endif
+#if USE_CAPTURE
+  // An armed capture carries on
+  captureWake = false;
+#endif
+#if USE_SPECTRUM
+  spectrumCallbackG = NULL;
+#endif
+#if USE_ACTIVITY
+  activityCallbackG = NULL;
+#endif
+#if USE_CALIBRATION_PS
+  // Last chance to save the state of this session, while the sensor runs
+  if (mpu6500Detected && (accelerationEnabled || orientationEnabled)) {
+    calibrationPsSave(CALIBRATION_PS_SESSION_SEC);
+  }
+#endif
+  if (!calibrationInProgress) {
+    accelerationEnable(false);
+    orientationEnable(false);
+  }
+}
+
+void accoriDeviceAccelerationCharStatusChange(uint8_t connection,
+                                              uint16_t clientConfig)
+{
+  accelerationNotification = (clientConfig != 0);
+  accelerationEnable(accelerationNotification || motionNotification || linearNotification);
+}
+
+void accoriDeviceOrientationCharStatusChange(uint8_t connection,
+                                             uint16_t clientConfig)
+{
+  orientationNotification = (clientConfig != 0);
+  orientationEnable(orientationNotification || motionNotification || linearNotification);
+}
+
+void accoriDeviceMotionCharStatusChange(uint8_t connection, uint16_t clientConfig)
+{
+  motionNotification = (clientConfig != 0);
+  accelerationEnable(accelerationNotification || motionNotification || linearNotification);
+  orientationEnable(orientationNotification || motionNotification || linearNotification);
+}
+
+void accoriDeviceLinearCharStatusChange(uint8_t connection, uint16_t clientConfig)
+{
+  linearNotification = (clientConfig != 0);
+  linearAccumulatorCnt = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    linearAccumulator[i] = 0;
+    linearVelocity[i] = 0;
+  }
+  accelerationEnable(accelerationNotification || motionNotification || linearNotification);
+  orientationEnable(orientationNotification || motionNotification || linearNotification);
+}
+
+void accoriDeviceRawCharStatusChange(uint8_t connection, uint16_t clientConfig)
+{
+#if USE_RAW_STREAM
+  rawEnable(clientConfig != 0);
+#endif
+}
+
+bool accoriDeviceRawRateSet(uint16_t freq)
+{
+#if USE_RAW_STREAM
+  if ((freq == 0) || (freq > sensorRates[SENSOR_RATE_COUNT - 1].freq)) {
+    return false;
+  }
+  // Only rates the sensor runs at, so the samples are evenly spaced
+  rawFreq = sensorRateFind(freq)->freq;
+  rawDecimationCnt = 0;
+  if (rawEnabled) {
+    sensorRateUpdate();
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint16_t accoriDeviceRawRead(AccoriRawSample_t *samples, uint16_t max,
+                             uint16_t *sequence, uint32_t *timestamp, uint16_t *intervalUs)
+{
+  uint16_t count = 0;
+#if USE_RAW_STREAM
+  uint16_t i;
+
+  count = (rawCount < max) ? rawCount : max;
+  for (i = 0; i < count; i++) {
+    samples[i] = rawSamples[(rawFirst + i) % RAW_BUFFER_SAMPLES];
+  }
+  *sequence = rawSequence;
+  *timestamp = rawTimes[rawFirst];
+  *intervalUs = (uint16_t)(1000000UL * rawDecimation / sensorFreq);
+#endif
+  return count;
+}
+
+void accoriDeviceRawRelease(uint16_t count)
+{
+#if USE_RAW_STREAM
+  if (count > rawCount) {
+    count = rawCount;
+  }
+  rawFirst = (rawFirst + count) % RAW_BUFFER_SAMPLES;
+  rawCount -= count;
+  rawSequence += count;
+#endif
+}
+
+void accoriDeviceAccelerationPeriodSet(uint16_t periodMs)
+{
+  accPeriodMs = periodMs ? periodMs : ACC_PERIOD_DEFAULT_MS;
+  if (accelerationEnabled) {
+    sensorRateUpdate();
+  }
+}
+
+void accoriDeviceOrientationPeriodSet(uint16_t periodMs)
+{
+  oriPeriodMs = periodMs ? periodMs : ORI_PERIOD_DEFAULT_MS;
+  if (orientationEnabled) {
+    sensorRateUpdate();
+  }
+}
+
+void accoriDeviceAccelerationRead(int16_t *accX, int16_t *accY, int16_t *accZ)
+{
+#if USE_MPU6500_INTERRUPT
+  // nop
+#else
+  vReadSensors(true);
+#endif
+  if (accAccumulatorCnt) {
+    *accX = (int16_t)(accAccumulator[0] / accAccumulatorCnt);
+    *accY = (int16_t)(accAccumulator[1] / accAccumulatorCnt);
+    *accZ = (int16_t)(accAccumulator[2] / accAccumulatorCnt);
     accAccumulator[0] = 0;
     accAccumulator[1] = 0;
     accAccumulator[2] = 0;
@@ -337,14 +1936,43 @@ void accoriDeviceAccelerationRead(int16_t *accX, int16_t *accY, int16_t *accZ)
   }
 }
 
+void accoriDeviceLinearRead(int16_t acc[3], int16_t vel[3])
+{
+#if USE_MPU6500_INTERRUPT
+  // nop
+#else
+  vReadSensors(true);
+  vCalculateOrientation(sensorPollFreq);
+#endif
+  for (uint8_t i = 0; i < 3; i++) {
+    int64_t mmPerS = linearVelocity[i] / (1000L << LINEAR_VELOCITY_FRAC_BITS);
+
+    acc[i] = linearAccumulatorCnt ? (int16_t)(linearAccumulator[i] / linearAccumulatorCnt) : 0;
+    linearAccumulator[i] = 0;
+    if (mmPerS > INT16_MAX) {
+      mmPerS = INT16_MAX;
+    } else if (mmPerS < -INT16_MAX) {
+      mmPerS = -INT16_MAX;
+    }
+    vel[i] = (int16_t)mmPerS;
+  }
+  linearAccumulatorCnt = 0;
+}
+
+uint32_t accoriDeviceSampleTimeGet(void)
+{
+  return sensorTime;
+}
+
 void accoriDeviceOrientationRead(int16_t *oriX, int16_t *oriY, int16_t *oriZ)
 {
 #if USE_MPU6500_INTERRUPT
   // nop
 #else
-  vReadSensors(true, sensorPollFreq);
+  vReadSensors(true);
   vCalculateOrientation(sensorPollFreq);
 #endif
+  vCalculateAngles();
   *oriX = oriCalculated[0];
   *oriY = oriCalculated[1];
   *oriZ = oriCalculated[2];
@@ -352,51 +1980,57 @@ void accoriDeviceOrientationRead(int16_t *oriX, int16_t *oriY, int16_t *oriZ)
 
 void accoriDeviceInterruptEvtHandler(void)
 {
-#if USE_MPU6500_INTERRUPT
+  uint16_t samples = 1;
+
+#if USE_WAKE_ON_MOTION
+  // Only the motion interrupt is enabled while armed
+  if (wakeOnMotionArmed) {
+    mpu6500_InterruptAcknowledge(i2cInit.port, MPU6500_ADDR);
+    wakeOnMotionArm(false);
+    if (motionCallbackG) {
+      motionCallbackG();
+    }
+    return;
+  }
+#endif
+
+#if USE_MPU6500_INTERRUPT && USE_MPU6500_FIFO
+  // FIFO overflow, drain it right away. Samples were lost, so the batch
+  // doesn't follow on from the previous one.
+#if USE_MEASURED_DT
+  sampleTimeValid = false;
+#endif
+#if USE_DMP_FUSION
+  if (dmpActive) {
+    samples = dmpRead();
+  } else
+#endif
+  {
+    samples = vReadSensorsFifo(sensorIntFreq);
+  }
+#elif USE_MPU6500_INTERRUPT
   vReadSensors(false);
   vCalculateOrientation(sensorIntFreq);
 #endif
   mpu6500_InterruptAcknowledge(i2cInit.port, MPU6500_ADDR);
 
-  // Turn LED off when calibration ends
-  if (calibrationInProgress && !mpu6500_GyroCalibrateInProgress()) {
-    calibrationInProgress = false;
-    boardLedOff(CALIBRATION_LED);
-    calibrateDoneCallbackG();
+  vSensorsProcessed(samples);
+}
 
-    // Turn off sensors if not used by notifications
-    if (!accelerationNotification) {
-      accelerationEnable(false);
-    }
-    if (!orientationNotification) {
-      orientationEnable(false);
-    }
-  }
+void accoriDeviceFifoTimerEvtHandler(void)
+{
+#if USE_MPU6500_INTERRUPT && USE_MPU6500_FIFO
+  uint16_t samples;
 
-#if USE_SENSOR_ERROR_LED
-  // Turn off accelerometer error LED some time after error
-  if (errorAccCntDown) {
-    errorAccCntDown--;
-    if (errorAccCntDown == 0) {
-      appHwLedOff(ERROR_LED_ACC);
-    }
-  }
-  // Turn off gyro error LED some time after error
-  if (errorGyrCntDown) {
-    errorGyrCntDown--;
-    if (errorGyrCntDown == 0) {
-      appHwLedOff(ERROR_LED_GYR);
-    }
-  }
+#if USE_DMP_FUSION
+  if (dmpActive) {
+    samples = dmpRead();
+  } else
 #endif
-#if USE_ANGULAR_ERROR_LED
-  // Turn off angular error LED some time after error
-  if (errorAngCntDown) {
-    errorAngCntDown--;
-    if (errorAngCntDown == 0) {
-      appHwLedOff(ERROR_LED_ANG);
-    }
+  {
+    samples = vReadSensorsFifo(sensorIntFreq);
   }
+  vSensorsProcessed(samples);
 #endif
 }
 
@@ -407,17 +2041,263 @@ void accoriDeviceCalibrate(void (*calibrateDoneCallback)(void))
   accelerationEnable(true);
   orientationEnable(true);
   calibrationInProgress = true;
+#if USE_GYRO_BIAS_ESTIMATION
+  gyroBiasReset(&gyroBias, sensorFreq * GYRO_BIAS_WINDOW_SEC);
+#endif
   mpu6500_GyroCalibrateBegin(sensorFreq * CALIBRATION_DURATION_IN_SEC);
 }
 
+void accoriDeviceWakeOnMotion(void (*motionCallback)(void))
+{
+#if USE_CAPTURE
+  // A running capture keeps the sensors busy, and wakes up once complete
+  if (mpu6500Detected && captureRunning()) {
+    motionCallbackG = motionCallback;
+    captureWake = true;
+    return;
+  }
+#endif
+#if USE_MOTION_EVENTS
+  // The events chosen to wake up on take over from any motion
+  if (mpu6500Detected && !calibrationInProgress && eventWakeMask) {
+    motionCallbackG = motionCallback;
+    eventWakeArmed = true;
+    sensorRateUpdate();
+    return;
+  }
+#endif
+#if USE_WAKE_ON_MOTION
+  // A running calibration keeps the sensors busy until it is done
+  if (mpu6500Detected && !calibrationInProgress) {
+    motionCallbackG = motionCallback;
+    wakeOnMotionArm(true);
+  }
+#endif
+}
+
+void accoriDeviceEventEnable(void (*eventCallback)(const MotionEvent_t *event))
+{
+#if USE_MOTION_EVENTS
+  if (mpu6500Detected) {
+    eventCallbackG = eventCallback;
+    eventQueueCnt = 0;
+    sensorRateUpdate();
+  }
+#endif
+}
+
+bool accoriDeviceEventConfigure(uint8_t wakeMask, uint16_t tapThresholdMg, uint16_t shockThresholdMg)
+{
+#if USE_MOTION_EVENTS
+  if ((wakeMask & ~(MOTION_EVENT_TAP | MOTION_EVENT_DOUBLE_TAP | MOTION_EVENT_SHOCK | MOTION_EVENT_FREEFALL))
+      || (tapThresholdMg == 0) || (shockThresholdMg == 0)
+      || (shockThresholdMg > MOTION_EVENT_SHOCK_MAX_MG)) {
+    return false;
+  }
+  eventWakeMask = wakeMask;
+  motionEventSetThresholds(&motionEventDetector, tapThresholdMg, shockThresholdMg);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool accoriDeviceEventLastRead(MotionEvent_t *event)
+{
+#if USE_MOTION_EVENTS
+  if (eventLastValid) {
+    *event = eventLast;
+    return true;
+  }
+#endif
+  return false;
+}
+
+bool accoriDeviceCaptureArm(uint8_t triggers, uint16_t accThresholdMg,
+                            uint16_t preSamples, uint16_t postSamples)
+{
+#if USE_CAPTURE
+  if (!mpu6500Detected
+      || (triggers & ~CAPTURE_TRIGGERS)
+      || ((uint32_t)preSamples + 1 + postSamples > CAPTURE_SAMPLES)
+      || ((triggers & ACCORI_CAPTURE_TRIGGER_ACC) && (accThresholdMg == 0))) {
+    return false;
+  }
+  captureTriggers = triggers;
+  captureThresholdSq = (uint32_t)accThresholdMg * accThresholdMg;
+  capturePre = preSamples;
+  capturePost = postSamples;
+  captureHead = 0;
+  captureFill = 0;
+  captureManual = false;
+  captureDone = false;
+  captureState = triggers ? accoriCaptureArmed : accoriCaptureIdle;
+  sensorRateUpdate();
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool accoriDeviceCaptureTrigger(void)
+{
+#if USE_CAPTURE
+  if (captureState == accoriCaptureArmed) {
+    captureManual = true;
+    return true;
+  }
+#endif
+  return false;
+}
+
+void accoriDeviceCaptureStatus(AccoriCaptureStatus_t *status)
+{
+  memset(status, 0, sizeof(*status));
+#if USE_CAPTURE
+  status->state = captureState;
+  if (captureState == accoriCaptureFrozen) {
+    status->cause = captureCause;
+    status->count = capturePreActual + 1 + capturePost;
+    status->pre = capturePreActual;
+    status->triggerTime = captureTriggerTime;
+    status->intervalUs = captureIntervalUs;
+  }
+#endif
+}
+
+uint16_t accoriDeviceCaptureRead(uint16_t offset, AccoriRawSample_t *samples, uint16_t max)
+{
+  uint16_t count = 0;
+#if USE_CAPTURE
+  uint16_t total;
+  uint16_t first;
+
+  if (captureState != accoriCaptureFrozen) {
+    return 0;
+  }
+  total = capturePreActual + 1 + capturePost;
+  if (offset >= total) {
+    return 0;
+  }
+  count = ((total - offset) < max) ? (total - offset) : max;
+  first = (captureHead + CAPTURE_SAMPLES - total + offset) % CAPTURE_SAMPLES;
+  for (uint16_t i = 0; i < count; i++) {
+    samples[i] = captureSamples[(first + i) % CAPTURE_SAMPLES];
+  }
+#endif
+  return count;
+}
+
+void accoriDeviceSpectrumEnable(void (*spectrumCallback)(const Spectrum_t *spectrum))
+{
+#if USE_SPECTRUM
+  if (mpu6500Detected) {
+    spectrumCallbackG = spectrumCallback;
+    spectrumCount = 0;
+    spectrumSkip = 0;
+    spectrumDecimationCnt = 0;
+    sensorRateUpdate();
+  }
+#endif
+}
+
+bool accoriDeviceSpectrumConfigure(uint16_t samples, uint16_t freq, uint8_t axis, uint16_t intervalMs)
+{
+#if USE_SPECTRUM
+  if (!spectrumValidLength(samples) || (freq == 0)
+      || (freq > sensorRates[SENSOR_RATE_COUNT - 1].freq)
+      || (axis > ACCORI_SPECTRUM_AXIS_MAGNITUDE)) {
+    return false;
+  }
+  spectrumLength = samples;
+  // Only rates the sensor runs at, so the samples are evenly spaced
+  spectrumFreq = sensorRateFind(freq)->freq;
+  spectrumAxis = axis;
+  spectrumIntervalMs = intervalMs;
+  spectrumCount = 0;
+  spectrumSkip = 0;
+  spectrumDecimationCnt = 0;
+  if (spectrumCallbackG) {
+    sensorRateUpdate();
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void accoriDeviceActivityEnable(void (*activityCallback)(const AccoriActivity_t *activity))
+{
+#if USE_ACTIVITY
+  if (mpu6500Detected) {
+    // Starts over, the windows before may be from long ago
+    if (activityCallback && !activityCallbackG) {
+      activityReset(&activityClassifier);
+    }
+    activityCallbackG = activityCallback;
+    activityChanged = false;
+    sensorRateUpdate();
+  }
+#endif
+}
+
+bool accoriDeviceActivityRead(AccoriActivity_t *activity)
+{
+#if USE_ACTIVITY
+  if (activityClassifier.activity != ACTIVITY_UNKNOWN) {
+    activity->activity = activityClassifier.activity;
+    activity->time = activityTime;
+    activity->features = activityClassifier.features;
+    return true;
+  }
+#endif
+  return false;
+}
+
 void accoriDeviceOrientationReset(void)
 {
-  imuDcmResetZ(dcmMatrix);
+  if (fusionEngine == fusionEngineDcm) {
+    imuDcmResetZ(dcmMatrix);
+  }
+#if !IMU_FIXED_POINT
+  else {
+    imuQuatResetZ(&quatFusionData);
+  }
+#endif
 }
 
 void accoriDeviceCalibrateReset(void)
 {
   mpu6500_GyroCalibrateReset(i2cInit.port, MPU6500_ADDR);
+#if USE_GYRO_BIAS_ESTIMATION
+  gyroBiasReset(&gyroBias, sensorFreq * GYRO_BIAS_WINDOW_SEC);
+#endif
+}
+
+bool accoriDeviceMountingSet(const uint8_t rotation[3])
+{
+  if (!mountingValid(rotation)) {
+    return false;
+  }
+  if (memcmp(rotation, mounting, sizeof(mounting)) == 0) {
+    return true;
+  }
+
+  memcpy(mounting, rotation, sizeof(mounting));
+  gecko_cmd_flash_ps_save(MOUNTING_PS_KEY, sizeof(mounting), mounting);
+
+  // The orientation and the bias estimate are in the old board axes
+  resetData();
+#if USE_GYRO_BIAS_ESTIMATION
+  gyroBiasReset(&gyroBias, sensorFreq * GYRO_BIAS_WINDOW_SEC);
+#endif
+#if USE_CALIBRATION_PS
+  if (mpu6500Detected) {
+    calibrationPsSave(0);
+  }
+#endif
+
+  return true;
 }
 
 /** @} (end addtogroup accgyro-sensor) */
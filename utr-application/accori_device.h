@@ -19,6 +19,10 @@
 #define ACCGYRO_SENSOR_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "motion_event.h"
+#include "spectrum.h"
+#include "activity.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,6 +42,12 @@ extern "C" {
  * @{
  *************************************************************************************************/
 
+/** Raw accelerometer and gyrometer sample in sensor units, +-16 g and +-2000 deg/s full scale */
+typedef struct {
+  int16_t acc[3];
+  int16_t gyr[3];
+} AccoriRawSample_t;
+
 /**********************************************************************************************//**
  * @addtogroup accgyro-sensor
  * @{
@@ -47,10 +57,47 @@ extern "C" {
  * Public Macros and Definitions
  *************************************************************************************************/
 
+/** Capture triggers, also reported as the cause of a capture */
+#define ACCORI_CAPTURE_TRIGGER_ACC      0x01  /**< Acceleration magnitude above threshold */
+#define ACCORI_CAPTURE_TRIGGER_RANGE    0x02  /**< Accelerometer or gyrometer out of range */
+#define ACCORI_CAPTURE_TRIGGER_MANUAL   0x04  /**< accoriDeviceCaptureTrigger() */
+
+/** Spectrum axis, 0 to 2 for X to Z, or the magnitude */
+#define ACCORI_SPECTRUM_AXIS_MAGNITUDE  3
+
+/** Mounting, per board axis the sensor axis it takes, optionally negated */
+#define ACCORI_MOUNTING_AXIS_MASK       0x03
+#define ACCORI_MOUNTING_NEGATE          0x80
+
 /**************************************************************************************************
  * Public Type declarations
  *************************************************************************************************/
 
+/** Capture buffer states */
+typedef enum {
+  accoriCaptureIdle,
+  accoriCaptureArmed,
+  accoriCaptureTriggered,
+  accoriCaptureFrozen,
+} AccoriCaptureState_t;
+
+/** Frozen capture, all zero but the state until frozen */
+typedef struct {
+  uint8_t  state;
+  uint8_t  cause;
+  uint16_t count;        /**< Number of samples */
+  uint16_t pre;          /**< Number of samples before the trigger */
+  uint32_t triggerTime;  /**< Timestamp of the trigger in RTCC ticks */
+  uint16_t intervalUs;   /**< Sample interval in us */
+} AccoriCaptureStatus_t;
+
+/** Activity change */
+typedef struct {
+  uint8_t activity;             /**< ACTIVITY_ value */
+  uint32_t time;                /**< Timestamp of the change in RTCC ticks */
+  ActivityFeatures_t features;  /**< Of the window the activity was confirmed on */
+} AccoriActivity_t;
+
 /**************************************************************************************************
  * Function Declarations
  *************************************************************************************************/
@@ -102,6 +149,19 @@ void accoriDeviceAccelerationRead(int16_t *accX, int16_t *accY, int16_t *accZ);
  *************************************************************************************************/
 void accoriDeviceOrientationRead(int16_t *oriX, int16_t *oriY, int16_t *oriZ);
 
+/**********************************************************************************************//**
+ * \brief  Read the linear motion, in the world frame with Z up and gravity removed.
+ * @param[out] acc  Linear acceleration in mg, averaged since the previous read.
+ * @param[out] vel  Short horizon velocity in mm/s, leaking back to zero.
+ *************************************************************************************************/
+void accoriDeviceLinearRead(int16_t acc[3], int16_t vel[3]);
+
+/**********************************************************************************************//**
+ * \brief  Get the timestamp of the latest sample.
+ * @return  Timestamp in RTCC ticks.
+ *************************************************************************************************/
+uint32_t accoriDeviceSampleTimeGet(void);
+
 /**********************************************************************************************//**
  * \brief  Enable or disable accelerometers depending on the characteristics.
  * \param[in]  connection  Connection ID.
@@ -116,6 +176,65 @@ void accoriDeviceAccelerationCharStatusChange(uint8_t connection, uint16_t clien
  *************************************************************************************************/
 void accoriDeviceOrientationCharStatusChange(uint8_t connection, uint16_t clientConfig);
 
+/**********************************************************************************************//**
+ * \brief  Enable or disable accelerometers and gyrometers depending on the characteristics.
+ * \param[in]  connection  Connection ID.
+ * \param[in] clientConfig  Combined motion characteristic.
+ *************************************************************************************************/
+void accoriDeviceMotionCharStatusChange(uint8_t connection, uint16_t clientConfig);
+
+/**********************************************************************************************//**
+ * \brief  Enable or disable accelerometers and gyrometers depending on the characteristics.
+ * \param[in]  connection  Connection ID.
+ * \param[in] clientConfig  Linear motion characteristic.
+ *************************************************************************************************/
+void accoriDeviceLinearCharStatusChange(uint8_t connection, uint16_t clientConfig);
+
+/**********************************************************************************************//**
+ * \brief  Enable or disable the raw sample buffer depending on the characteristics.
+ * \param[in]  connection  Connection ID.
+ * \param[in] clientConfig  Raw stream characteristic.
+ *************************************************************************************************/
+void accoriDeviceRawCharStatusChange(uint8_t connection, uint16_t clientConfig);
+
+/**********************************************************************************************//**
+ * \brief  Set the raw stream sample rate. It is rounded up to a rate the sensor supports.
+ * \param[in] freq  Sample rate in Hz.
+ * \return  True if the rate is supported.
+ *************************************************************************************************/
+bool accoriDeviceRawRateSet(uint16_t freq);
+
+/**********************************************************************************************//**
+ * \brief  Get the oldest raw samples, without removing them from the buffer.
+ * \param[out] samples  Samples, oldest first.
+ * \param[in] max  Max number of samples to get.
+ * \param[out] sequence  Sequence number of the first sample.
+ * \param[out] timestamp  Time of the first sample in RTCC ticks.
+ * \param[out] intervalUs  Time between samples in us.
+ * \return  Number of samples.
+ *************************************************************************************************/
+uint16_t accoriDeviceRawRead(AccoriRawSample_t *samples, uint16_t max,
+                             uint16_t *sequence, uint32_t *timestamp, uint16_t *intervalUs);
+
+/**********************************************************************************************//**
+ * \brief  Remove the oldest raw samples from the buffer, once they have been sent.
+ * \param[in] count  Number of samples to remove.
+ *************************************************************************************************/
+void accoriDeviceRawRelease(uint16_t count);
+
+/**********************************************************************************************//**
+ * \brief  Set the acceleration notification period, so the sample rate can be kept as low as the
+ *         averaged acceleration allows.
+ * \param[in] periodMs  Period between accoriDeviceAccelerationRead() calls in ms.
+ *************************************************************************************************/
+void accoriDeviceAccelerationPeriodSet(uint16_t periodMs);
+
+/**********************************************************************************************//**
+ * \brief  Set the orientation notification period, so the samples are collected in time.
+ * \param[in] periodMs  Period between accoriDeviceOrientationRead() calls in ms.
+ *************************************************************************************************/
+void accoriDeviceOrientationPeriodSet(uint16_t periodMs);
+
 /**********************************************************************************************//**
  * \brief  Start a gyrometer calibration.
  * \param[in] calibrateDoneCallback  Function that will be called when the calibration is completed.
@@ -127,6 +246,107 @@ void accoriDeviceCalibrate(void (*calibrateDoneCallback)(void));
  *************************************************************************************************/
 void accoriDeviceCalibrateReset(void);
 
+/**********************************************************************************************//**
+ * \brief  Set the board mounting, and keep it in flash. Restarts the orientation and the gyro bias
+ *         estimate if it changes.
+ * \param[in] rotation  Per board axis X to Z, the sensor axis 0 to 2, or'ed with
+ *                      ACCORI_MOUNTING_NEGATE to flip it.
+ * @return  True if the mounting is a rotation.
+ *************************************************************************************************/
+bool accoriDeviceMountingSet(const uint8_t rotation[3]);
+
+/**********************************************************************************************//**
+ * \brief  Put the sensor in low-power wake-on-motion mode until it detects motion or is enabled
+ *         again. Call after accoriDeviceSleep().
+ * \param[in] motionCallback  Function that will be called when motion is detected.
+ *************************************************************************************************/
+void accoriDeviceWakeOnMotion(void (*motionCallback)(void));
+
+/**********************************************************************************************//**
+ * \brief  Enable or disable the tap, shock and free-fall detection.
+ * \param[in] eventCallback  Function that will be called for every event, NULL to disable.
+ *************************************************************************************************/
+void accoriDeviceEventEnable(void (*eventCallback)(const MotionEvent_t *event));
+
+/**********************************************************************************************//**
+ * \brief  Configure the tap, shock and free-fall detection.
+ * \param[in] wakeMask  Events that wake up from sleep instead of any motion, 0 for any motion.
+ * \param[in] tapThresholdMg  Tap threshold in mg, gravity removed.
+ * \param[in] shockThresholdMg  Shock threshold in mg.
+ * @return  True if the config is valid.
+ *************************************************************************************************/
+bool accoriDeviceEventConfigure(uint8_t wakeMask, uint16_t tapThresholdMg, uint16_t shockThresholdMg);
+
+/**********************************************************************************************//**
+ * \brief  Read the last event, including the one that woke up from sleep.
+ * \param[out] event  Last event.
+ * @return  False if there has been no event.
+ *************************************************************************************************/
+bool accoriDeviceEventLastRead(MotionEvent_t *event);
+
+/**********************************************************************************************//**
+ * \brief  Arm or disarm the capture buffer. A new arm drops any frozen capture.
+ * \param[in] triggers  ACCORI_CAPTURE_TRIGGER_ flags, 0 to disarm.
+ * \param[in] accThresholdMg  Acceleration magnitude threshold in mg.
+ * \param[in] preSamples  Number of samples to keep before the trigger.
+ * \param[in] postSamples  Number of samples to keep after the trigger.
+ * @return  True if the config is valid, and the window including the trigger
+ *          sample fits the buffer of 128 samples.
+ *************************************************************************************************/
+bool accoriDeviceCaptureArm(uint8_t triggers, uint16_t accThresholdMg,
+                            uint16_t preSamples, uint16_t postSamples);
+
+/**********************************************************************************************//**
+ * \brief  Trigger an armed capture.
+ * @return  False if not armed.
+ *************************************************************************************************/
+bool accoriDeviceCaptureTrigger(void);
+
+/**********************************************************************************************//**
+ * \brief  Read the capture buffer state.
+ * \param[out] status  Capture buffer state.
+ *************************************************************************************************/
+void accoriDeviceCaptureStatus(AccoriCaptureStatus_t *status);
+
+/**********************************************************************************************//**
+ * \brief  Read samples of a frozen capture.
+ * \param[in] offset  Index of the first sample.
+ * \param[out] samples  Samples, oldest first.
+ * \param[in] max  Max number of samples.
+ * @return  Number of samples read, 0 if not frozen or past the end.
+ *************************************************************************************************/
+uint16_t accoriDeviceCaptureRead(uint16_t offset, AccoriRawSample_t *samples, uint16_t max);
+
+/**********************************************************************************************//**
+ * \brief  Enable or disable the vibration spectrum.
+ * \param[in] spectrumCallback  Function that will be called for every spectrum, NULL to disable.
+ *************************************************************************************************/
+void accoriDeviceSpectrumEnable(void (*spectrumCallback)(const Spectrum_t *spectrum));
+
+/**********************************************************************************************//**
+ * \brief  Configure the vibration spectrum.
+ * \param[in] samples  Window length, a power of two.
+ * \param[in] freq  Sample rate in Hz, rounded up to a rate the sensor supports.
+ * \param[in] axis  Accelerometer axis, or ACCORI_SPECTRUM_AXIS_MAGNITUDE.
+ * \param[in] intervalMs  Time from one window to the next, at least the window length.
+ * @return  True if the config is valid.
+ *************************************************************************************************/
+bool accoriDeviceSpectrumConfigure(uint16_t samples, uint16_t freq, uint8_t axis, uint16_t intervalMs);
+
+/**********************************************************************************************//**
+ * \brief  Enable or disable the activity classification.
+ * \param[in] activityCallback  Function that will be called when the activity changes, NULL to
+ *                              disable.
+ *************************************************************************************************/
+void accoriDeviceActivityEnable(void (*activityCallback)(const AccoriActivity_t *activity));
+
+/**********************************************************************************************//**
+ * \brief  Read the current activity.
+ * \param[out] activity  Current activity.
+ * @return  False if the activity is not known yet.
+ *************************************************************************************************/
+bool accoriDeviceActivityRead(AccoriActivity_t *activity);
+
 /**********************************************************************************************//**
  * \brief  Reset the z-axis for the orientation.
  *************************************************************************************************/
@@ -137,6 +357,11 @@ void accoriDeviceOrientationReset(void);
  *************************************************************************************************/
 void accoriDeviceInterruptEvtHandler(void);
 
+/**********************************************************************************************//**
+ * \brief  Event handler that is triggered from the timer to drain the sensor FIFO
+ *************************************************************************************************/
+void accoriDeviceFifoTimerEvtHandler(void);
+
 /** @} (end addtogroup accgyro-sensor) */
 /** @} (end addtogroup app_hardware) */
 
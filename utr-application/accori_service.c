@@ -31,6 +31,8 @@
 /* application specific headers */
 #include "app_timer.h"
 #include "accori_device.h"
+#include "imu_codec.h"
+#include "notify_filter.h"
 
 /***********************************************************************************************//**
  * @addtogroup Features
@@ -49,6 +51,13 @@
 // Measurement periodes in ms.
 #define ACCELERATION_MEASUREMENT_PERIOD             200
 #define ORIENTATION_MEASUREMENT_PERIOD              200
+#define MOTION_MEASUREMENT_PERIOD                   200
+#define LINEAR_MEASUREMENT_PERIOD                   200
+
+// Raw stream notification period in ms. Only full notifications are sent,
+// unless samples have been held back for RAW_HOLD_PERIODS periods.
+#define RAW_NOTIFICATION_PERIOD                     50
+#define RAW_HOLD_PERIODS                            4
 
 // Number of axis for acceleration and orientation
 #define ACC_AXIS                               3
@@ -62,14 +71,92 @@
 #define ACCELERATION_PAYLOAD_LENGTH  (ACC_AXIS * ACC_AXIS_PAYLOAD_LENGTH)
 #define ORIENTATION_PAYLOAD_LENGTH   (ORI_AXIS * ORI_AXIS_PAYLOAD_LENGTH)
 
+// Combined motion payload: the timestamp of the latest sample in RTCC ticks,
+// followed by the acceleration and the orientation. While it is enabled, it
+// replaces the separate acceleration and orientation notifications, which
+// would otherwise share the averaged acceleration.
+#define MOTION_PAYLOAD_LENGTH        (4 + ACCELERATION_PAYLOAD_LENGTH + ORIENTATION_PAYLOAD_LENGTH)
+
+// Linear motion payload: the timestamp of the latest sample in RTCC ticks,
+// followed by the world frame linear acceleration in mg and the velocity in
+// mm/s, X and Y horizontal and Z up
+#define LINEAR_PAYLOAD_LENGTH        (4 + ACCELERATION_PAYLOAD_LENGTH + (3 * 2))
+
+// Raw stream payload: a header with the sequence number of the first sample,
+// its timestamp in RTCC ticks and the sample interval in us, followed by as
+// many accelerometer and gyrometer samples as the ATT MTU allows
+#define RAW_HEADER_LENGTH            8
+#define RAW_SAMPLE_LENGTH            ((ACC_AXIS + ORI_AXIS) * 2)
+#define RAW_PAYLOAD_MAX_LENGTH       244
+#define RAW_SAMPLES_MAX              ((RAW_PAYLOAD_MAX_LENGTH - RAW_HEADER_LENGTH) / RAW_SAMPLE_LENGTH)
+
+// Optionally compress the raw stream samples with the IMU codec, which holds
+// roughly twice the samples per notification. Every RAW_CODEC_KEYFRAME_INTERVAL
+// notification carries a full sample for clients to resync on.
+#define USE_RAW_CODEC                1
+#define RAW_CODEC_KEYFRAME_INTERVAL  8
+#define RAW_CODEC_SAMPLES_MAX        64
+#define RAW_CODEC_PAYLOAD_MIN_LENGTH (RAW_HEADER_LENGTH + IMU_CODEC_HEADER_LENGTH + IMU_CODEC_KEYFRAME_LENGTH)
+
+// Capture download period in ms. Each notification holds the index of its
+// first sample, followed by as many samples as the ATT MTU allows. Reading the
+// characteristic gives the capture state.
+#define CAPTURE_NOTIFICATION_PERIOD  20
+#define CAPTURE_HEADER_LENGTH        2
+#define CAPTURE_STATUS_LENGTH        12
+
+// Vibration spectrum payload: the summary type, the accelerometer axis and the
+// RMS in mg, followed by the RMS per band in mg, or by the frequency in 0.1 Hz
+// and the amplitude in mg of each peak
+#define SPECTRUM_PAYLOAD_LENGTH      20
+#define SPECTRUM_MODE_BANDS          0x01
+#define SPECTRUM_MODE_PEAKS          0x02
+
+// Motion event payload: the event type, its peak magnitude in mg and its
+// timestamp in RTCC ticks
+#define EVENT_PAYLOAD_LENGTH         7
+
+// Activity payload: the activity, the timestamp of the change in RTCC ticks
+// and the features it was classified on, i.e. the mean, deviation and energy
+// in mg and the crossing rate in 0.1 Hz
+#define ACTIVITY_PAYLOAD_LENGTH      13
+
 // Indicates currently there is no active connection using this service.
 // #define NO_CONNECTION                0xFF
 
 #define CP_OPCODE_CALIBRATE             0x01
 #define CP_OPCODE_ORIRESET              0x02
+#define CP_OPCODE_RAWRATE               0x03
+#define CP_OPCODE_RAWCODEC              0x04
+#define CP_OPCODE_NOTIFYFILTER          0x05
+#define CP_OPCODE_EVENTCONFIG           0x06
+#define CP_OPCODE_CAPTUREARM            0x07
+#define CP_OPCODE_CAPTURETRIGGER        0x08
+#define CP_OPCODE_CAPTUREREAD           0x09
+#define CP_OPCODE_SPECTRUM              0x0A
+#define CP_OPCODE_MOUNTING              0x0B
 #define CP_OPCODE_RESPONSE              0x10
 #define CP_OPCODE_CALRESET              0x64
 
+// Notification filter config: characteristic handle, flags, absolute and
+// relative deadband, min interval in ms and max rate per second
+#define CP_NOTIFYFILTER_LENGTH          11
+
+// Motion event config: wake mask, tap and shock thresholds in mg
+#define CP_EVENTCONFIG_LENGTH           6
+
+// Capture arm: triggers, acceleration threshold in mg, samples before and
+// after the trigger. Capture read: index of the first sample.
+#define CP_CAPTUREARM_LENGTH            8
+#define CP_CAPTUREREAD_LENGTH           3
+
+// Spectrum config: summary type, axis, window length, sample rate in Hz and
+// interval in ms
+#define CP_SPECTRUM_LENGTH              9
+
+// Mounting: per board axis, the sensor axis and ACCORI_MOUNTING_NEGATE
+#define CP_MOUNTING_LENGTH              4
+
 #define CP_RESP_SUCCESS                 0x01
 #define CP_RESP_ERROR                   0x02
 
@@ -88,6 +175,21 @@
 static bool cpIndication = false;
 static bool accelerationNotification = false;
 static bool orientationNotification  = false;
+static bool motionNotification = false;
+static bool linearNotification = false;
+static bool rawNotification = false;
+static bool eventNotification = false;
+static bool captureNotification = false;
+static bool captureDownload = false;
+static uint16_t captureOffset = 0;
+static bool spectrumNotification = false;
+static bool activityNotification = false;
+static uint8_t spectrumMode = SPECTRUM_MODE_BANDS;
+static uint8_t spectrumAxis = ACCORI_SPECTRUM_AXIS_MAGNITUDE;
+static uint8_t rawHoldCnt = 0;
+static AccoriRawSample_t rawSamples[RAW_CODEC_SAMPLES_MAX];
+static bool rawCodecEnabled = false;
+static ImuCodec_t rawCodec;
 
 /***************************************************************************************************
  * Public Variable Definitions
@@ -112,6 +214,102 @@ static void calibrateDone(void)
   }
 }
 
+static uint8_t *rawSamplePack(uint8_t *p, const AccoriRawSample_t *sample)
+{
+  for (uint8_t j = 0; j < 3; j++) {
+    UINT16_TO_BITSTREAM(p, (uint16_t)sample->acc[j]);
+  }
+  for (uint8_t j = 0; j < 3; j++) {
+    UINT16_TO_BITSTREAM(p, (uint16_t)sample->gyr[j]);
+  }
+  return p;
+}
+
+static void captureDownloadStop(void)
+{
+  captureDownload = false;
+  gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_CAPTURE_TIMER, false);
+}
+
+static void spectrumDone(const Spectrum_t *spectrum)
+{
+  uint8_t buffer[SPECTRUM_PAYLOAD_LENGTH];
+  uint8_t *p = buffer;
+
+  if (!spectrumNotification) {
+    return;
+  }
+
+  UINT8_TO_BITSTREAM(p, spectrumMode);
+  UINT8_TO_BITSTREAM(p, spectrumAxis);
+  UINT16_TO_BITSTREAM(p, spectrum->rms);
+  if (spectrumMode == SPECTRUM_MODE_PEAKS) {
+    for (uint8_t i = 0; i < SPECTRUM_PEAKS; i++) {
+      UINT16_TO_BITSTREAM(p, spectrum->peakFreq[i]);
+      UINT16_TO_BITSTREAM(p, spectrum->peakAmplitude[i]);
+    }
+  } else {
+    for (uint8_t i = 0; i < SPECTRUM_BANDS; i++) {
+      UINT16_TO_BITSTREAM(p, spectrum->band[i]);
+    }
+  }
+  gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                         gattdb_accor_spectrum,
+                                                         SPECTRUM_PAYLOAD_LENGTH,
+                                                         buffer);
+}
+
+static void eventPayload(const MotionEvent_t *event, uint8_t *buffer)
+{
+  uint8_t *p = buffer;
+
+  UINT8_TO_BITSTREAM(p, event->type);
+  UINT16_TO_BITSTREAM(p, event->magnitude);
+  UINT32_TO_BITSTREAM(p, event->time);
+}
+
+static void eventDetected(const MotionEvent_t *event)
+{
+  uint8_t buffer[EVENT_PAYLOAD_LENGTH];
+
+  if (!eventNotification) {
+    return;
+  }
+
+  eventPayload(event, buffer);
+  notifyFilterSend(conGetConnectionId(),
+                   gattdb_accor_event,
+                   EVENT_PAYLOAD_LENGTH,
+                   buffer);
+}
+
+static void activityPayload(const AccoriActivity_t *activity, uint8_t *buffer)
+{
+  uint8_t *p = buffer;
+
+  UINT8_TO_BITSTREAM(p, activity->activity);
+  UINT32_TO_BITSTREAM(p, activity->time);
+  UINT16_TO_BITSTREAM(p, activity->features.mean);
+  UINT16_TO_BITSTREAM(p, activity->features.deviation);
+  UINT16_TO_BITSTREAM(p, activity->features.energy);
+  UINT16_TO_BITSTREAM(p, activity->features.crossings);
+}
+
+static void activityChanged(const AccoriActivity_t *activity)
+{
+  uint8_t buffer[ACTIVITY_PAYLOAD_LENGTH];
+
+  if (!activityNotification) {
+    return;
+  }
+
+  activityPayload(activity, buffer);
+  gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                         gattdb_accor_activity,
+                                                         ACTIVITY_PAYLOAD_LENGTH,
+                                                         buffer);
+}
+
 /***************************************************************************************************
  * Public Function Definitions
  **************************************************************************************************/
@@ -119,9 +317,23 @@ void accoriServiceInit(void)
 {
   gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_ACC_TIMER, false);
   gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_ORI_TIMER, false);
+  gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_MOTION_TIMER, false);
+  gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_LINEAR_TIMER, false);
+  gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_RAW_TIMER, false);
+  captureDownloadStop();
 
   accelerationNotification = false;
   orientationNotification  = false;
+  motionNotification = false;
+  linearNotification = false;
+  rawNotification = false;
+  eventNotification = false;
+  captureNotification = false;
+  spectrumNotification = false;
+  activityNotification = false;
+  // A new connection starts at the default ATT MTU, where a keyframe does not fit
+  rawCodecEnabled = false;
+  imuCodecReset(&rawCodec, RAW_CODEC_KEYFRAME_INTERVAL);
 }
 
 void accoriServiceConnectionOpened(void)
@@ -132,15 +344,30 @@ void accoriServiceConnectionClosed(void)
 {
   gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_ACC_TIMER, false);
   gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_ORI_TIMER, false);
+  gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_MOTION_TIMER, false);
+  gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_LINEAR_TIMER, false);
+  gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_RAW_TIMER, false);
+  captureDownloadStop();
   accelerationNotification = false;
   orientationNotification  = false;
+  motionNotification = false;
+  linearNotification = false;
+  rawNotification = false;
+  eventNotification = false;
+  captureNotification = false;
+  spectrumNotification = false;
+  activityNotification = false;
+  // A new connection starts at the default ATT MTU, where a keyframe does not fit
+  rawCodecEnabled = false;
+  imuCodecReset(&rawCodec, RAW_CODEC_KEYFRAME_INTERVAL);
 }
 
 void accoriServiceAccelerationCharStatusChange(uint8_t connection,
                                                uint16_t clientConfig)
 {
   accelerationNotification = (clientConfig > 0);
-  if (accelerationNotification) {
+  if (accelerationNotification && !motionNotification) {
+    accoriDeviceAccelerationPeriodSet(ACCELERATION_MEASUREMENT_PERIOD);
     gecko_cmd_hardware_set_soft_timer(TIMER_MS_2_TIMERTICK(ACCELERATION_MEASUREMENT_PERIOD), ACCORI_SERVICE_ACC_TIMER, false);
   } else {
     gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_ACC_TIMER, false);
@@ -151,13 +378,136 @@ void accoriServiceOrientationCharStatusChange(uint8_t connection,
                                               uint16_t clientConfig)
 {
   orientationNotification = (clientConfig > 0);
-  if (orientationNotification) {
+  if (orientationNotification && !motionNotification) {
+    accoriDeviceOrientationPeriodSet(ORIENTATION_MEASUREMENT_PERIOD);
     gecko_cmd_hardware_set_soft_timer(TIMER_MS_2_TIMERTICK(ORIENTATION_MEASUREMENT_PERIOD), ACCORI_SERVICE_ORI_TIMER, false);
   } else {
     gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_ORI_TIMER, false);
   }
 }
 
+void accoriServiceMotionCharStatusChange(uint8_t connection,
+                                         uint16_t clientConfig)
+{
+  motionNotification = (clientConfig > 0);
+  if (motionNotification) {
+    gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_ACC_TIMER, false);
+    gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_ORI_TIMER, false);
+    accoriDeviceAccelerationPeriodSet(MOTION_MEASUREMENT_PERIOD);
+    accoriDeviceOrientationPeriodSet(MOTION_MEASUREMENT_PERIOD);
+    gecko_cmd_hardware_set_soft_timer(TIMER_MS_2_TIMERTICK(MOTION_MEASUREMENT_PERIOD), ACCORI_SERVICE_MOTION_TIMER, false);
+  } else {
+    gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_MOTION_TIMER, false);
+    // Back to the separate notifications
+    accoriServiceAccelerationCharStatusChange(connection, accelerationNotification);
+    accoriServiceOrientationCharStatusChange(connection, orientationNotification);
+  }
+}
+
+void accoriServiceLinearCharStatusChange(uint8_t connection,
+                                         uint16_t clientConfig)
+{
+  linearNotification = (clientConfig > 0);
+  if (linearNotification) {
+    gecko_cmd_hardware_set_soft_timer(TIMER_MS_2_TIMERTICK(LINEAR_MEASUREMENT_PERIOD), ACCORI_SERVICE_LINEAR_TIMER, false);
+  } else {
+    gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_LINEAR_TIMER, false);
+  }
+}
+
+void accoriServiceRawCharStatusChange(uint8_t connection,
+                                      uint16_t clientConfig)
+{
+  rawNotification = (clientConfig > 0);
+  rawHoldCnt = 0;
+  imuCodecReset(&rawCodec, RAW_CODEC_KEYFRAME_INTERVAL);
+  if (rawNotification) {
+    gecko_cmd_hardware_set_soft_timer(TIMER_MS_2_TIMERTICK(RAW_NOTIFICATION_PERIOD), ACCORI_SERVICE_RAW_TIMER, false);
+  } else {
+    gecko_cmd_hardware_set_soft_timer(0, ACCORI_SERVICE_RAW_TIMER, false);
+  }
+}
+
+void accoriServiceEventCharStatusChange(uint8_t connection,
+                                        uint16_t clientConfig)
+{
+  eventNotification = (clientConfig > 0);
+  accoriDeviceEventEnable(eventNotification ? &eventDetected : NULL);
+}
+
+void accoriServiceEventRead(void)
+{
+  MotionEvent_t event = { 0, 0, 0 };
+  uint8_t buffer[EVENT_PAYLOAD_LENGTH];
+
+  // All zero until the first event
+  accoriDeviceEventLastRead(&event);
+  eventPayload(&event, buffer);
+  gecko_cmd_gatt_server_send_user_read_response(conGetConnectionId(),
+                                                gattdb_accor_event,
+                                                0,
+                                                EVENT_PAYLOAD_LENGTH,
+                                                buffer);
+}
+
+void accoriServiceCaptureCharStatusChange(uint8_t connection,
+                                          uint16_t clientConfig)
+{
+  captureNotification = (clientConfig > 0);
+  if (!captureNotification) {
+    captureDownloadStop();
+  }
+}
+
+void accoriServiceCaptureRead(void)
+{
+  AccoriCaptureStatus_t status;
+  uint8_t buffer[CAPTURE_STATUS_LENGTH];
+  uint8_t *p = buffer;
+
+  accoriDeviceCaptureStatus(&status);
+  UINT8_TO_BITSTREAM(p, status.state);
+  UINT8_TO_BITSTREAM(p, status.cause);
+  UINT16_TO_BITSTREAM(p, status.count);
+  UINT16_TO_BITSTREAM(p, status.pre);
+  UINT32_TO_BITSTREAM(p, status.triggerTime);
+  UINT16_TO_BITSTREAM(p, status.intervalUs);
+  gecko_cmd_gatt_server_send_user_read_response(conGetConnectionId(),
+                                                gattdb_accor_capture,
+                                                0,
+                                                CAPTURE_STATUS_LENGTH,
+                                                buffer);
+}
+
+void accoriServiceActivityCharStatusChange(uint8_t connection,
+                                           uint16_t clientConfig)
+{
+  activityNotification = (clientConfig > 0);
+  accoriDeviceActivityEnable(activityNotification ? &activityChanged : NULL);
+}
+
+void accoriServiceActivityRead(void)
+{
+  AccoriActivity_t activity = { 0, 0, { 0, 0, 0, 0 } };
+  uint8_t buffer[ACTIVITY_PAYLOAD_LENGTH];
+
+  // All zero until the activity is known
+  accoriDeviceActivityRead(&activity);
+  activityPayload(&activity, buffer);
+  gecko_cmd_gatt_server_send_user_read_response(conGetConnectionId(),
+                                                gattdb_accor_activity,
+                                                0,
+                                                ACTIVITY_PAYLOAD_LENGTH,
+                                                buffer);
+}
+
+void accoriServiceSpectrumCharStatusChange(uint8_t connection,
+                                           uint16_t clientConfig)
+{
+  spectrumNotification = (clientConfig > 0);
+  accoriDeviceSpectrumEnable(spectrumNotification ? &spectrumDone : NULL);
+}
+
 void accoriServiceCpCharStatusChange(uint8_t connection,
                                      uint16_t clientConfig)
 {
@@ -183,11 +533,10 @@ void accoriServiceAccelerationTimerEvtHandler(void)
     return;
   }
 
-  gecko_cmd_gatt_server_send_characteristic_notification(
-    conGetConnectionId(),
-    gattdb_accor_acceleration,
-    ACCELERATION_PAYLOAD_LENGTH,
-    buffer);
+  notifyFilterSend(conGetConnectionId(),
+                   gattdb_accor_acceleration,
+                   ACCELERATION_PAYLOAD_LENGTH,
+                   buffer);
 }
 
 void accoriServiceOrientationTimerEvtHandler(void)
@@ -208,11 +557,177 @@ void accoriServiceOrientationTimerEvtHandler(void)
     return;
   }
 
-  gecko_cmd_gatt_server_send_characteristic_notification(
-    conGetConnectionId(),
-    gattdb_accor_orientation,
-    ORIENTATION_PAYLOAD_LENGTH,
-    buffer);
+  notifyFilterSend(conGetConnectionId(),
+                   gattdb_accor_orientation,
+                   ORIENTATION_PAYLOAD_LENGTH,
+                   buffer);
+}
+
+void accoriServiceMotionTimerEvtHandler(void)
+{
+  int16_t acc[ACC_AXIS];
+  int16_t ori[ORI_AXIS];
+  uint8_t buffer[MOTION_PAYLOAD_LENGTH];
+  uint8_t *p = buffer;
+
+  if (!motionNotification) {
+    return;
+  }
+
+  accoriDeviceAccelerationRead(&acc[0], &acc[1], &acc[2]);
+  accoriDeviceOrientationRead(&ori[0], &ori[1], &ori[2]);
+
+  UINT32_TO_BITSTREAM(p, accoriDeviceSampleTimeGet());
+  for (uint8_t i = 0; i < ACC_AXIS; i++) {
+    UINT16_TO_BITSTREAM(p, (uint16_t)acc[i]);
+  }
+  for (uint8_t i = 0; i < ORI_AXIS; i++) {
+    UINT16_TO_BITSTREAM(p, (uint16_t)ori[i]);
+  }
+
+  notifyFilterSend(conGetConnectionId(),
+                   gattdb_accor_motion,
+                   MOTION_PAYLOAD_LENGTH,
+                   buffer);
+}
+
+void accoriServiceLinearTimerEvtHandler(void)
+{
+  int16_t acc[3];
+  int16_t vel[3];
+  uint8_t buffer[LINEAR_PAYLOAD_LENGTH];
+  uint8_t *p = buffer;
+
+  if (!linearNotification) {
+    return;
+  }
+
+  accoriDeviceLinearRead(acc, vel);
+
+  UINT32_TO_BITSTREAM(p, accoriDeviceSampleTimeGet());
+  for (uint8_t i = 0; i < 3; i++) {
+    UINT16_TO_BITSTREAM(p, (uint16_t)acc[i]);
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    UINT16_TO_BITSTREAM(p, (uint16_t)vel[i]);
+  }
+
+  notifyFilterSend(conGetConnectionId(),
+                   gattdb_accor_linear,
+                   LINEAR_PAYLOAD_LENGTH,
+                   buffer);
+}
+
+void accoriServiceRawTimerEvtHandler(void)
+{
+  uint8_t buffer[RAW_PAYLOAD_MAX_LENGTH];
+  uint16_t payloadMax;
+  uint16_t samplesMax;
+  uint16_t count;
+  uint16_t sent;
+  uint16_t sequence;
+  uint32_t timestamp;
+  uint16_t intervalUs;
+  uint8_t *p;
+  bool codec;
+
+  if (!rawNotification) {
+    return;
+  }
+
+  payloadMax = conGetNotificationPayloadMax();
+  if (payloadMax > RAW_PAYLOAD_MAX_LENGTH) {
+    payloadMax = RAW_PAYLOAD_MAX_LENGTH;
+  }
+  // Plain packing whenever a keyframe would not fit, starting over with a
+  // keyframe if the codec gets the room again
+  codec = rawCodecEnabled && (payloadMax >= RAW_CODEC_PAYLOAD_MIN_LENGTH);
+  if (!codec) {
+    imuCodecReset(&rawCodec, RAW_CODEC_KEYFRAME_INTERVAL);
+  }
+  samplesMax = codec ? RAW_CODEC_SAMPLES_MAX
+               : (payloadMax - RAW_HEADER_LENGTH) / RAW_SAMPLE_LENGTH;
+
+  while (true) {
+    count = accoriDeviceRawRead(rawSamples, samplesMax, &sequence, &timestamp, &intervalUs);
+    if (count == 0) {
+      rawHoldCnt = 0;
+      break;
+    }
+
+    p = buffer;
+    UINT16_TO_BITSTREAM(p, sequence);
+    UINT32_TO_BITSTREAM(p, timestamp);
+    UINT16_TO_BITSTREAM(p, intervalUs);
+    if (codec) {
+      // The samples are six consecutive int16, as the codec expects
+      p += imuCodecEncode(&rawCodec, (const int16_t *)rawSamples, count,
+                          p, payloadMax - RAW_HEADER_LENGTH, &sent);
+    } else {
+      sent = count;
+      for (uint16_t i = 0; i < count; i++) {
+        p = rawSamplePack(p, &rawSamples[i]);
+      }
+    }
+    if (sent == 0) {
+      break;
+    }
+
+    // Wait for a full notification, but not forever
+    if ((sent == count) && (count < samplesMax) && (++rawHoldCnt < RAW_HOLD_PERIODS)) {
+      break;
+    }
+
+    // Keep the samples for the next period if the stack is out of buffers
+    if (gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                               gattdb_accor_raw,
+                                                               (uint8_t)(p - buffer),
+                                                               buffer)->result) {
+      break;
+    }
+    if (codec) {
+      imuCodecCommit(&rawCodec, (const int16_t *)rawSamples, sent);
+    }
+    accoriDeviceRawRelease(sent);
+    rawHoldCnt = 0;
+  }
+}
+
+void accoriServiceCaptureTimerEvtHandler(void)
+{
+  uint8_t buffer[RAW_PAYLOAD_MAX_LENGTH];
+  uint16_t payloadMax;
+  uint16_t samplesMax;
+  uint16_t count;
+  uint8_t *p;
+
+  payloadMax = conGetNotificationPayloadMax();
+  if (payloadMax > RAW_PAYLOAD_MAX_LENGTH) {
+    payloadMax = RAW_PAYLOAD_MAX_LENGTH;
+  }
+  samplesMax = (payloadMax - CAPTURE_HEADER_LENGTH) / RAW_SAMPLE_LENGTH;
+
+  // As many notifications as the stack takes, the rest in the next period
+  while (captureDownload) {
+    count = accoriDeviceCaptureRead(captureOffset, rawSamples, samplesMax);
+    if (count == 0) {
+      captureDownloadStop();
+      break;
+    }
+
+    p = buffer;
+    UINT16_TO_BITSTREAM(p, captureOffset);
+    for (uint16_t i = 0; i < count; i++) {
+      p = rawSamplePack(p, &rawSamples[i]);
+    }
+    if (gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                               gattdb_accor_capture,
+                                                               (uint8_t)(p - buffer),
+                                                               buffer)->result) {
+      break;
+    }
+    captureOffset += count;
+  }
 }
 
 void accoriServiceCpWrite(uint8array *writeValue)
@@ -242,6 +757,159 @@ void accoriServiceCpWrite(uint8array *writeValue)
                                                                respBuf);
         break;
 
+      case CP_OPCODE_RAWRATE:
+        if ((writeValue->len >= 3)
+            && accoriDeviceRawRateSet((uint16_t)(writeValue->data[1] | (writeValue->data[2] << 8)))) {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_SUCCESS);
+        } else {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_ERROR);
+        }
+        gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                               gattdb_accor_cp,
+                                                               3,
+                                                               respBuf);
+        break;
+
+      case CP_OPCODE_RAWCODEC:
+        // A keyframe must fit, which takes a larger ATT MTU than the default
+        if ((writeValue->len >= 2)
+            && (!writeValue->data[1]
+                || (USE_RAW_CODEC
+                    && (conGetNotificationPayloadMax() >= RAW_CODEC_PAYLOAD_MIN_LENGTH)))) {
+          rawCodecEnabled = (writeValue->data[1] != 0);
+          imuCodecReset(&rawCodec, RAW_CODEC_KEYFRAME_INTERVAL);
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_SUCCESS);
+        } else {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_ERROR);
+        }
+        gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                               gattdb_accor_cp,
+                                                               3,
+                                                               respBuf);
+        break;
+
+      case CP_OPCODE_NOTIFYFILTER:
+        if (writeValue->len >= CP_NOTIFYFILTER_LENGTH) {
+          NotifyFilterConfig_t config;
+          uint8_t *p = writeValue->data;
+
+          config.flags = p[3];
+          config.deadbandAbs = (uint16_t)(p[4] | (p[5] << 8));
+          config.deadbandRel = (uint16_t)(p[6] | (p[7] << 8));
+          config.minIntervalMs = (uint16_t)(p[8] | (p[9] << 8));
+          config.maxRate = p[10];
+          if (notifyFilterConfigure((uint16_t)(p[1] | (p[2] << 8)), &config)) {
+            UINT8_TO_BITSTREAM(respBufp, CP_RESP_SUCCESS);
+          } else {
+            UINT8_TO_BITSTREAM(respBufp, CP_RESP_ERROR);
+          }
+        } else {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_ERROR);
+        }
+        gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                               gattdb_accor_cp,
+                                                               3,
+                                                               respBuf);
+        break;
+
+      case CP_OPCODE_EVENTCONFIG:
+        if ((writeValue->len >= CP_EVENTCONFIG_LENGTH)
+            && accoriDeviceEventConfigure(writeValue->data[1],
+                                          (uint16_t)(writeValue->data[2] | (writeValue->data[3] << 8)),
+                                          (uint16_t)(writeValue->data[4] | (writeValue->data[5] << 8)))) {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_SUCCESS);
+        } else {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_ERROR);
+        }
+        gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                               gattdb_accor_cp,
+                                                               3,
+                                                               respBuf);
+        break;
+
+      case CP_OPCODE_CAPTUREARM:
+        if ((writeValue->len >= CP_CAPTUREARM_LENGTH)
+            && accoriDeviceCaptureArm(writeValue->data[1],
+                                      (uint16_t)(writeValue->data[2] | (writeValue->data[3] << 8)),
+                                      (uint16_t)(writeValue->data[4] | (writeValue->data[5] << 8)),
+                                      (uint16_t)(writeValue->data[6] | (writeValue->data[7] << 8)))) {
+          captureDownloadStop();
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_SUCCESS);
+        } else {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_ERROR);
+        }
+        gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                               gattdb_accor_cp,
+                                                               3,
+                                                               respBuf);
+        break;
+
+      case CP_OPCODE_CAPTURETRIGGER:
+        if (accoriDeviceCaptureTrigger()) {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_SUCCESS);
+        } else {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_ERROR);
+        }
+        gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                               gattdb_accor_cp,
+                                                               3,
+                                                               respBuf);
+        break;
+
+      case CP_OPCODE_CAPTUREREAD:
+      {
+        AccoriCaptureStatus_t status;
+
+        accoriDeviceCaptureStatus(&status);
+        if ((writeValue->len >= CP_CAPTUREREAD_LENGTH) && captureNotification
+            && (status.state == accoriCaptureFrozen)) {
+          captureOffset = (uint16_t)(writeValue->data[1] | (writeValue->data[2] << 8));
+          captureDownload = true;
+          gecko_cmd_hardware_set_soft_timer(TIMER_MS_2_TIMERTICK(CAPTURE_NOTIFICATION_PERIOD),
+                                            ACCORI_SERVICE_CAPTURE_TIMER, false);
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_SUCCESS);
+        } else {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_ERROR);
+        }
+        gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                               gattdb_accor_cp,
+                                                               3,
+                                                               respBuf);
+        break;
+      }
+
+      case CP_OPCODE_SPECTRUM:
+        if ((writeValue->len >= CP_SPECTRUM_LENGTH)
+            && ((writeValue->data[1] == SPECTRUM_MODE_BANDS) || (writeValue->data[1] == SPECTRUM_MODE_PEAKS))
+            && accoriDeviceSpectrumConfigure((uint16_t)(writeValue->data[3] | (writeValue->data[4] << 8)),
+                                             (uint16_t)(writeValue->data[5] | (writeValue->data[6] << 8)),
+                                             writeValue->data[2],
+                                             (uint16_t)(writeValue->data[7] | (writeValue->data[8] << 8)))) {
+          spectrumMode = writeValue->data[1];
+          spectrumAxis = writeValue->data[2];
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_SUCCESS);
+        } else {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_ERROR);
+        }
+        gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                               gattdb_accor_cp,
+                                                               3,
+                                                               respBuf);
+        break;
+
+      case CP_OPCODE_MOUNTING:
+        if ((writeValue->len >= CP_MOUNTING_LENGTH)
+            && accoriDeviceMountingSet(&writeValue->data[1])) {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_SUCCESS);
+        } else {
+          UINT8_TO_BITSTREAM(respBufp, CP_RESP_ERROR);
+        }
+        gecko_cmd_gatt_server_send_characteristic_notification(conGetConnectionId(),
+                                                               gattdb_accor_cp,
+                                                               3,
+                                                               respBuf);
+        break;
+
       case CP_OPCODE_CALRESET:
         accoriDeviceCalibrateReset();
         UINT8_TO_BITSTREAM(respBufp, CP_RESP_SUCCESS);
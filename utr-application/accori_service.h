@@ -82,6 +82,28 @@ void accoriServiceAccelerationCharStatusChange(uint8_t connection, uint16_t clie
  *************************************************************************************************/
 void accoriServiceOrientationCharStatusChange(uint8_t connection, uint16_t clientConfig);
 
+/**********************************************************************************************//**
+ * \brief  Combined motion characteristics changed event handler function. While enabled, it
+ *         replaces the acceleration and orientation notifications.
+ * \param[in]  connection  Connection ID.
+ * \param[in]  clientConfig  New value of characteristics.
+ *************************************************************************************************/
+void accoriServiceMotionCharStatusChange(uint8_t connection, uint16_t clientConfig);
+
+/**********************************************************************************************//**
+ * \brief  Linear motion characteristics changed event handler function.
+ * \param[in]  connection  Connection ID.
+ * \param[in]  clientConfig  New value of characteristics.
+ *************************************************************************************************/
+void accoriServiceLinearCharStatusChange(uint8_t connection, uint16_t clientConfig);
+
+/**********************************************************************************************//**
+ * \brief  Raw stream characteristics changed event handler function.
+ * \param[in]  connection  Connection ID.
+ * \param[in]  clientConfig  New value of characteristics.
+ *************************************************************************************************/
+void accoriServiceRawCharStatusChange(uint8_t connection, uint16_t clientConfig);
+
 /**********************************************************************************************//**
  * \brief  Control Point characteristics changed event handler function.
  * \param[in]  connection  Connection ID.
@@ -89,9 +111,66 @@ void accoriServiceOrientationCharStatusChange(uint8_t connection, uint16_t clien
  *************************************************************************************************/
 void accoriServiceCpCharStatusChange(uint8_t connection, uint16_t clientConfig);
 
+/**********************************************************************************************//**
+ * \brief  Motion event characteristics changed event handler function.
+ * \param[in]  connection  Connection ID.
+ * \param[in]  clientConfig  New value of characteristics.
+ *************************************************************************************************/
+void accoriServiceEventCharStatusChange(uint8_t connection, uint16_t clientConfig);
+
+/**********************************************************************************************//**
+ * \brief  Motion event read, responds with the last event.
+ *************************************************************************************************/
+void accoriServiceEventRead(void);
+
+/**********************************************************************************************//**
+ * \brief  Capture buffer characteristics changed event handler function.
+ * \param[in]  connection  Connection ID.
+ * \param[in]  clientConfig  New value of characteristics.
+ *************************************************************************************************/
+void accoriServiceCaptureCharStatusChange(uint8_t connection, uint16_t clientConfig);
+
+/**********************************************************************************************//**
+ * \brief  Capture buffer read, responds with the capture state.
+ *************************************************************************************************/
+void accoriServiceCaptureRead(void);
+
+/**********************************************************************************************//**
+ * \brief  Vibration spectrum characteristics changed event handler function.
+ * \param[in]  connection  Connection ID.
+ * \param[in]  clientConfig  New value of characteristics.
+ *************************************************************************************************/
+void accoriServiceSpectrumCharStatusChange(uint8_t connection, uint16_t clientConfig);
+
+/**********************************************************************************************//**
+ * \brief  Activity characteristics changed event handler function.
+ * \param[in]  connection  Connection ID.
+ * \param[in]  clientConfig  New value of characteristics.
+ *************************************************************************************************/
+void accoriServiceActivityCharStatusChange(uint8_t connection, uint16_t clientConfig);
+
+/**********************************************************************************************//**
+ * \brief  Activity read, responds with the current activity.
+ *************************************************************************************************/
+void accoriServiceActivityRead(void);
+
 /**********************************************************************************************//**
  * \brief  Control Point write, used to start a control point function.
- * \param[in]  writeValue  The function ID. 0x01=Start calibration, 0x02=Reset orientation
+ * \param[in]  writeValue  The function ID. 0x01=Start calibration, 0x02=Reset orientation,
+ *                         0x03=Set raw stream rate (followed by uint16 rate in Hz),
+ *                         0x04=Raw stream compression (followed by uint8 0=off, 1=on),
+ *                         0x05=Notification filter (followed by uint16 characteristic, uint8 flags,
+ *                         uint16 deadband, uint16 relative deadband in permille, uint16 min interval
+ *                         in ms, uint8 max rate per second),
+ *                         0x06=Motion events (followed by uint8 wake mask, uint16 tap threshold
+ *                         in mg, uint16 shock threshold in mg),
+ *                         0x07=Arm capture (followed by uint8 triggers, 0 to disarm, uint16
+ *                         acceleration threshold in mg, uint16 samples before and after trigger),
+ *                         0x08=Trigger capture, 0x09=Download capture (followed by uint16 first
+ *                         sample), 0x0A=Vibration spectrum (followed by uint8 1=bands, 2=peaks,
+ *                         uint8 axis, 3=magnitude, uint16 window length, uint16 rate in Hz,
+ *                         uint16 interval in ms), 0x0B=Mounting (followed by uint8 sensor axis
+ *                         0-2 for board X, Y and Z, 0x80 added to negate, rotations only)
  *************************************************************************************************/
 void accoriServiceCpWrite(uint8array *writeValue);
 
@@ -105,6 +184,26 @@ void accoriServiceAccelerationTimerEvtHandler(void);
  *************************************************************************************************/
 void accoriServiceOrientationTimerEvtHandler(void);
 
+/**********************************************************************************************//**
+ * \brief  Event to handle periodic combined acceleration and orientation measurements
+ *************************************************************************************************/
+void accoriServiceMotionTimerEvtHandler(void);
+
+/**********************************************************************************************//**
+ * \brief  Event to handle periodic linear acceleration and velocity measurements
+ *************************************************************************************************/
+void accoriServiceLinearTimerEvtHandler(void);
+
+/**********************************************************************************************//**
+ * \brief  Event to handle periodic raw stream notifications
+ *************************************************************************************************/
+void accoriServiceRawTimerEvtHandler(void);
+
+/**********************************************************************************************//**
+ * \brief  Event to handle capture download notifications
+ *************************************************************************************************/
+void accoriServiceCaptureTimerEvtHandler(void);
+
 /** @} (end addtogroup accor) */
 /** @} (end addtogroup Features) */
 
@@ -26,6 +26,7 @@
 
 #include "aio_device.h"
 #include "connection.h"
+#include "notify_filter.h"
 
 /***********************************************************************************************//**
  * @addtogroup Features
@@ -136,11 +137,10 @@ void aioServiceDigitalInUpdate(void)
 
   // Notify any subscribers
   if (digitalInNotification) {
-    gecko_cmd_gatt_server_send_characteristic_notification(
-      conGetConnectionId(),
-      gattdb_aio_digital_in,
-      AIO_DIGITAL_INPUT_PAYLOAD_LEN,
-      &inStates);
+    notifyFilterSend(conGetConnectionId(),
+                     gattdb_aio_digital_in,
+                     AIO_DIGITAL_INPUT_PAYLOAD_LEN,
+                     &inStates);
   }
 }
 
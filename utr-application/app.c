@@ -87,6 +87,20 @@ static void advStart(void)
   gecko_cmd_hardware_set_soft_timer(TIMER_MS_2_TIMERTICK(ADV_TIMEOUT_MS), ADV_TIMEOUT_TIMER, true);
 }
 
+static void wakeUp(void)
+{
+  if (sleeping) {
+    sleeping = false;
+    batteryMeasure();
+    advStart();
+  }
+}
+
+static void motionHandler(void)
+{
+  wakeUp();
+}
+
 static void sleep(void)
 {
   appBleAdvStop();
@@ -99,6 +113,9 @@ static void sleep(void)
   appUiSleep();
 
   sleeping = true;
+
+  // Moving the board wakes it up, just like a button push
+  accoriDeviceWakeOnMotion(&motionHandler);
 }
 
 static void buttonHandler(uint8_t buttonNo, bool pushed)
@@ -108,11 +125,7 @@ static void buttonHandler(uint8_t buttonNo, bool pushed)
   }
 
   if (pushed) {
-    if (sleeping) {
-      sleeping = false;
-      batteryMeasure();
-      advStart();
-    }
+    wakeUp();
   }
 }
 
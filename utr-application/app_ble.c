@@ -37,6 +37,7 @@
 #include "battery_device.h"
 #include "csc_device.h"
 #include "rd0057.h"
+#include "rht_device.h"
 
 /* profiles */
 #include "connection.h"
@@ -50,6 +51,7 @@
 /* uncannier headers */
 #include "di_service.h"
 #include "ota_service.h"
+#include "notify_filter.h"
 
 #include <stdbool.h>
 #include <stdio.h>
@@ -116,7 +118,10 @@ AppBleGattServerUserReadRequest_t AppBleGattServerUserReadRequest[] =
   { gattdb_es_uvindex, esServiceUvIndexRead },
   { gattdb_amblight_lux, amblightServiceRead },
   { gattdb_aio_digital_in, aioServiceDigitalInRead },
-  { gattdb_aio_digital_out, aioServiceDigitalOutRead }
+  { gattdb_aio_digital_out, aioServiceDigitalOutRead },
+  { gattdb_accor_event, accoriServiceEventRead },
+  { gattdb_accor_capture, accoriServiceCaptureRead },
+  { gattdb_accor_activity, accoriServiceActivityRead }
 };
 
 AppBleGattServerUserWriteRequest_t AppBleGattServerUserWriteRequest[] =
@@ -137,7 +142,17 @@ AppBleGattServerCharStatus_t AppBleGattServerCharStatus[] =
   { gattdb_accor_acceleration, accoriDeviceAccelerationCharStatusChange },
   { gattdb_accor_orientation, accoriServiceOrientationCharStatusChange },
   { gattdb_accor_orientation, accoriDeviceOrientationCharStatusChange },
+  { gattdb_accor_motion, accoriServiceMotionCharStatusChange },
+  { gattdb_accor_motion, accoriDeviceMotionCharStatusChange },
+  { gattdb_accor_linear, accoriServiceLinearCharStatusChange },
+  { gattdb_accor_linear, accoriDeviceLinearCharStatusChange },
   { gattdb_accor_cp, accoriServiceCpCharStatusChange },
+  { gattdb_accor_raw, accoriServiceRawCharStatusChange },
+  { gattdb_accor_raw, accoriDeviceRawCharStatusChange },
+  { gattdb_accor_event, accoriServiceEventCharStatusChange },
+  { gattdb_accor_capture, accoriServiceCaptureCharStatusChange },
+  { gattdb_accor_spectrum, accoriServiceSpectrumCharStatusChange },
+  { gattdb_accor_activity, accoriServiceActivityCharStatusChange },
   { gattdb_battery_measurement, batteryServiceCharStatusChange }
 };
 
@@ -242,6 +257,7 @@ void appBleConnectionClosedEvent(uint8_t connection, uint16_t reason)
   otaServiceConnectionClosed();
 
   accoriServiceConnectionClosed();
+  notifyFilterReset();
   conConnectionClosed();
 
   appBleAdvStart();
@@ -290,6 +306,12 @@ void appBleHandleEvents(struct gecko_cmd_packet *evt)
 
       break;
 
+    /* The client has exchanged the ATT MTU, which sets the max notification size */
+    case gecko_evt_gatt_mtu_exchanged_id:
+      conMtuExchanged(evt->data.evt_gatt_mtu_exchanged.connection,
+                      evt->data.evt_gatt_mtu_exchanged.mtu);
+      break;
+
     /* Value of attribute changed from the local database by remote GATT client */
     case gecko_evt_gatt_server_attribute_value_id:
       for (i = 0; i < AppBleGattServerAttributeValueSize; i++) {
@@ -306,6 +328,8 @@ void appBleHandleEvents(struct gecko_cmd_packet *evt)
     case gecko_evt_gatt_server_characteristic_status_id:
       /* Char status changed */
       if (evt->data.evt_gatt_server_characteristic_status.status_flags == 0x01) {
+        /* The first value after notifications are enabled always goes out */
+        notifyFilterRestart(evt->data.evt_gatt_server_characteristic_status.characteristic);
         for (i = 0; i < AppBleGattServerCharStatusSize; i++) {
           if ((AppBleGattServerCharStatus[i].charId
                == evt->data.evt_gatt_server_characteristic_status.characteristic)
@@ -385,6 +409,14 @@ void appBleHandleEvents(struct gecko_cmd_packet *evt)
           accoriServiceOrientationTimerEvtHandler();
           break;
 
+        case ACCORI_SERVICE_MOTION_TIMER:
+          accoriServiceMotionTimerEvtHandler();
+          break;
+
+        case ACCORI_SERVICE_LINEAR_TIMER:
+          accoriServiceLinearTimerEvtHandler();
+          break;
+
         case BATT_SERVICE_TIMER:
           batteryServiceMeasure();
           break;
@@ -393,6 +425,22 @@ void appBleHandleEvents(struct gecko_cmd_packet *evt)
           cscServiceMeasure();
           break;
 
+        case ACCORI_DEVICE_FIFO_TIMER:
+          accoriDeviceFifoTimerEvtHandler();
+          break;
+
+        case RHT_DEVICE_TIMER:
+          rhtDeviceTimerEvtHandler();
+          break;
+
+        case ACCORI_SERVICE_RAW_TIMER:
+          accoriServiceRawTimerEvtHandler();
+          break;
+
+        case ACCORI_SERVICE_CAPTURE_TIMER:
+          accoriServiceCaptureTimerEvtHandler();
+          break;
+
         default:
           break;
       }
@@ -18,6 +18,8 @@
 #include "app_interrupt.h"
 #include "rd0057.h"
 #include "em_gpio.h"
+#include "em_rtcc.h"
+#include "em_core.h"
 #include "csc_device.h"
 #include "accori_device.h"
 #include "aluv_device.h"
@@ -54,6 +56,10 @@
  * Local Variables
  **************************************************************************************************/
 
+// RTCC counter at the latest accelerometer/gyro edge, and edges since read
+static volatile uint32_t accGyroEdgeTime;
+static volatile uint16_t accGyroEdgeCount;
+
 /***************************************************************************************************
  * Local Function Definitions
  **************************************************************************************************/
@@ -71,6 +77,9 @@ static void gpioIrqHandler(void)
   }
 
   if (intFlags & 1 << ACCGYRO_INTERRUPT_NO) {
+    // The edge is when the sample was taken, the event comes later
+    accGyroEdgeTime = RTCC_CounterGet();
+    accGyroEdgeCount++;
     gecko_external_signal(EXTSIGNAL_ACCGYRO);
   }
 
@@ -158,6 +167,20 @@ void appInterruptInit(void)
   NVIC_EnableIRQ(GPIO_ODD_IRQn);
 }
 
+uint16_t appInterruptAccGyroEdgeGet(uint32_t *time)
+{
+  uint16_t count;
+  CORE_DECLARE_IRQ_STATE;
+
+  CORE_ENTER_ATOMIC();
+  *time = accGyroEdgeTime;
+  count = accGyroEdgeCount;
+  accGyroEdgeCount = 0;
+  CORE_EXIT_ATOMIC();
+
+  return count;
+}
+
 /***************************************************************************************************
  * Interrupt Handlers
  **************************************************************************************************/
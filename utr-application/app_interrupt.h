@@ -18,6 +18,8 @@
 #ifndef APP_INTERRUPT_H
 #define APP_INTERRUPT_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -63,6 +65,17 @@ typedef enum {
 
 void appInterruptInit(void);
 
+/***********************************************************************************************//**
+ * \brief
+ *   Get the time of the latest accelerometer/gyro interrupt edge, taken in the
+ *   interrupt handler.
+ * \param[out] time
+ *   RTCC counter at the edge, unchanged if there was none.
+ * \return
+ *   Number of edges since the previous call.
+ **************************************************************************************************/
+uint16_t appInterruptAccGyroEdgeGet(uint32_t *time);
+
 /** @} (end addtogroup app_interrupt) */
 /** @} (end addtogroup Thunderboard) */
 
@@ -53,6 +53,12 @@ typedef enum {
   ACCORI_SERVICE_ORI_TIMER =  5,
   BATT_SERVICE_TIMER       =  6,
   CSC_SERVICE_TIMER        =  7,
+  ACCORI_DEVICE_FIFO_TIMER =  8,
+  ACCORI_SERVICE_RAW_TIMER =  9,
+  ACCORI_SERVICE_CAPTURE_TIMER = 10,
+  ACCORI_SERVICE_MOTION_TIMER = 11,
+  ACCORI_SERVICE_LINEAR_TIMER = 12,
+  RHT_DEVICE_TIMER         = 13,
 } appTimer_t;
 
 /** @} (end addtogroup app) */
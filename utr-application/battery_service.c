@@ -29,6 +29,7 @@
 #include "battery_device.h"
 #include "app_timer.h"
 #include "connection.h"
+#include "notify_filter.h"
 
 /* Own header*/
 #include "battery_service.h"
@@ -99,8 +100,7 @@ void batteryServiceMeasure(void)
   batteryLevel = appHwReadBatteryLevel();
 
   /* Send notification */
-  gecko_cmd_gatt_server_send_characteristic_notification(
-    conGetConnectionId(), gattdb_battery_measurement, sizeof(batteryLevel), &batteryLevel);
+  notifyFilterSend(conGetConnectionId(), gattdb_battery_measurement, sizeof(batteryLevel), &batteryLevel);
 }
 
 void batteryServiceRead(void)
@@ -42,6 +42,12 @@
 /** Indicates currently there is no bonding. */
 #define CON_NO_BONDING         0xFF
 
+/** ATT MTU until the client exchanges a larger one. */
+#define CON_DEFAULT_MTU        23
+
+/** Opcode and handle in front of the value of a notification. */
+#define CON_NOTIFICATION_HEADER_LEN  3
+
 /***************************************************************************************************
  * Public Variables
  **************************************************************************************************/
@@ -51,6 +57,7 @@
  **************************************************************************************************/
 
 static uint8_t conConnectionId = CON_NO_CONNECTION; /* Connection Handle ID */
+static uint16_t conMtu = CON_DEFAULT_MTU; /* Negotiated ATT MTU */
 
 /***************************************************************************************************
  * Static Function Declarations
@@ -75,6 +82,7 @@ void conConnectionStarted(uint8_t connection, uint8_t bonding)
 {
   /* Update connection handle ID */
   conConnectionId = connection;
+  conMtu = CON_DEFAULT_MTU;
 
 #ifdef SILABS_AF_PLUGIN_CONNECTION_CON_PAIRING
   /* Initiate pairing*/
@@ -88,6 +96,7 @@ void conConnectionStarted(uint8_t connection, uint8_t bonding)
 void conConnectionClosed(void)
 {
   conConnectionId = CON_NO_CONNECTION; /* Invalidate connection handle */
+  conMtu = CON_DEFAULT_MTU;
 }
 
 void conConnectionParameters(uint8_t connection,
@@ -98,6 +107,18 @@ void conConnectionParameters(uint8_t connection,
 {
 }
 
+void conMtuExchanged(uint8_t connection, uint16_t mtu)
+{
+  if (connection == conConnectionId) {
+    conMtu = mtu;
+  }
+}
+
+uint16_t conGetNotificationPayloadMax(void)
+{
+  return conMtu - CON_NOTIFICATION_HEADER_LEN;
+}
+
 uint8_t conGetConnectionId(void)
 {
   /* Return connection handle ID */
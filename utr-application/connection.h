@@ -77,6 +77,19 @@ void conConnectionParameters(uint8_t connection,
  **************************************************************************************************/
 uint8_t conGetConnectionId(void);
 
+/***********************************************************************************************//**
+ *  \brief  Indicate that the ATT MTU has been exchanged.
+ *  \param[in]  connection  ConnectionId.
+ *  \param[in]  mtu  Negotiated ATT MTU.
+ **************************************************************************************************/
+void conMtuExchanged(uint8_t connection, uint16_t mtu);
+
+/***********************************************************************************************//**
+ *  \brief  Get the max payload of a notification on the current connection.
+ *  \return  ATT MTU minus the notification header.
+ **************************************************************************************************/
+uint16_t conGetNotificationPayloadMax(void);
+
 /***********************************************************************************************//**
  *  \brief  Init connection parameters (bonding, etc).
  **************************************************************************************************/
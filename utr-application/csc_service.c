@@ -30,6 +30,7 @@
 #include "csc_device.h"
 #include "app_timer.h"
 #include "connection.h"
+#include "notify_filter.h"
 
 /* Own header*/
 #include "csc_service.h"
@@ -164,8 +165,7 @@ void cscServiceMeasure(void)
   length = cscProcMeas(cscTempBuffer);
 
   /* Send notification */
-  gecko_cmd_gatt_server_send_characteristic_notification(
-    conGetConnectionId(), gattdb_cycling_speed_measurement, length, cscTempBuffer);
+  notifyFilterSend(conGetConnectionId(), gattdb_cycling_speed_measurement, length, cscTempBuffer);
 }
 
 //#ifdef SILABS_AF_PLUGIN_CSC_WHEEL_DATA_SUP
@@ -67,11 +67,95 @@ GATT_DATA(const uint8_t bg_gattdb_data_uuidtable_128_map [])=
 0x9f, 0xdc, 0x9c, 0x81, 0xff, 0xfe, 0x5d, 0x88, 0xe5, 0x11, 0xe5, 0x4b, 0xe2, 0xf6, 0xc1, 0xc4, 
 0x9a, 0xf4, 0x94, 0xe9, 0xb5, 0xf3, 0x9f, 0xba, 0xdd, 0x45, 0xe3, 0xbe, 0x94, 0xb6, 0xc4, 0xb7, 
 0x6b, 0x85, 0x75, 0xba, 0xbb, 0xb0, 0xa0, 0xb0, 0x03, 0x47, 0x31, 0x41, 0x8c, 0x0b, 0xe3, 0x71, 
+0x50, 0x53, 0x46, 0x17, 0xee, 0x48, 0xb1, 0x92, 0xee, 0x40, 0xa3, 0x80, 0xda, 0xaa, 0xba, 0x1f, 
+0x74, 0x8c, 0xea, 0xec, 0x4c, 0x26, 0xe2, 0xb6, 0x21, 0x42, 0x05, 0xbc, 0x7e, 0x54, 0x89, 0x27, 
+0x2f, 0x11, 0x6a, 0x51, 0xb7, 0x33, 0xd2, 0xb9, 0x26, 0x4f, 0xe8, 0xa4, 0xe9, 0xfe, 0xe2, 0x35, 
+0xbe, 0x7f, 0x84, 0xba, 0x7a, 0x02, 0xc6, 0xa9, 0x8d, 0x41, 0x6a, 0xec, 0xac, 0xff, 0xee, 0x01, 
+0xe9, 0xb5, 0x27, 0xf4, 0x89, 0x10, 0x5b, 0x84, 0xd1, 0x41, 0x1c, 0xfe, 0x7b, 0x6a, 0xfe, 0xa4, 
+0x1e, 0x85, 0x88, 0x78, 0xbb, 0xd0, 0xc4, 0xb9, 0x19, 0x4f, 0x4a, 0xca, 0x97, 0x04, 0xc2, 0x94, 
+0x2d, 0x98, 0xcf, 0x97, 0x56, 0xb1, 0x48, 0x93, 0x56, 0x44, 0x13, 0x8f, 0x83, 0xe7, 0xfd, 0x01, 
 };
 
 
 
 
+GATT_DATA(const struct bg_gattdb_attribute_chrvalue	bg_gattdb_data_attribute_field_89 ) = {
+	.properties=0x12,
+	.index=26,
+	.max_len=0,
+	.data=NULL,
+};
+
+GATT_DATA(const struct bg_gattdb_buffer_with_len	bg_gattdb_data_attribute_field_88 ) = {
+	.len=19,
+	.data={0x12,0x5a,0x00,0x2d,0x98,0xcf,0x97,0x56,0xb1,0x48,0x93,0x56,0x44,0x13,0x8f,0x83,0xe7,0xfd,0x01,}
+};
+GATT_DATA(const struct bg_gattdb_attribute_chrvalue	bg_gattdb_data_attribute_field_86 ) = {
+	.properties=0x10,
+	.index=25,
+	.max_len=0,
+	.data=NULL,
+};
+
+GATT_DATA(const struct bg_gattdb_buffer_with_len	bg_gattdb_data_attribute_field_85 ) = {
+	.len=19,
+	.data={0x10,0x57,0x00,0x1e,0x85,0x88,0x78,0xbb,0xd0,0xc4,0xb9,0x19,0x4f,0x4a,0xca,0x97,0x04,0xc2,0x94,}
+};
+GATT_DATA(const struct bg_gattdb_attribute_chrvalue	bg_gattdb_data_attribute_field_83 ) = {
+	.properties=0x10,
+	.index=24,
+	.max_len=0,
+	.data=NULL,
+};
+
+GATT_DATA(const struct bg_gattdb_buffer_with_len	bg_gattdb_data_attribute_field_82 ) = {
+	.len=19,
+	.data={0x10,0x54,0x00,0xe9,0xb5,0x27,0xf4,0x89,0x10,0x5b,0x84,0xd1,0x41,0x1c,0xfe,0x7b,0x6a,0xfe,0xa4,}
+};
+GATT_DATA(const struct bg_gattdb_attribute_chrvalue	bg_gattdb_data_attribute_field_80 ) = {
+	.properties=0x10,
+	.index=23,
+	.max_len=0,
+	.data=NULL,
+};
+
+GATT_DATA(const struct bg_gattdb_buffer_with_len	bg_gattdb_data_attribute_field_79 ) = {
+	.len=19,
+	.data={0x10,0x51,0x00,0xbe,0x7f,0x84,0xba,0x7a,0x02,0xc6,0xa9,0x8d,0x41,0x6a,0xec,0xac,0xff,0xee,0x01,}
+};
+GATT_DATA(const struct bg_gattdb_attribute_chrvalue	bg_gattdb_data_attribute_field_77 ) = {
+	.properties=0x12,
+	.index=22,
+	.max_len=0,
+	.data=NULL,
+};
+
+GATT_DATA(const struct bg_gattdb_buffer_with_len	bg_gattdb_data_attribute_field_76 ) = {
+	.len=19,
+	.data={0x12,0x4e,0x00,0x2f,0x11,0x6a,0x51,0xb7,0x33,0xd2,0xb9,0x26,0x4f,0xe8,0xa4,0xe9,0xfe,0xe2,0x35,}
+};
+GATT_DATA(const struct bg_gattdb_attribute_chrvalue	bg_gattdb_data_attribute_field_74 ) = {
+	.properties=0x12,
+	.index=21,
+	.max_len=0,
+	.data=NULL,
+};
+
+GATT_DATA(const struct bg_gattdb_buffer_with_len	bg_gattdb_data_attribute_field_73 ) = {
+	.len=19,
+	.data={0x12,0x4b,0x00,0x74,0x8c,0xea,0xec,0x4c,0x26,0xe2,0xb6,0x21,0x42,0x05,0xbc,0x7e,0x54,0x89,0x27,}
+};
+GATT_DATA(const struct bg_gattdb_attribute_chrvalue	bg_gattdb_data_attribute_field_71 ) = {
+	.properties=0x10,
+	.index=20,
+	.max_len=0,
+	.data=NULL,
+};
+
+GATT_DATA(const struct bg_gattdb_buffer_with_len	bg_gattdb_data_attribute_field_70 ) = {
+	.len=19,
+	.data={0x10,0x48,0x00,0x50,0x53,0x46,0x17,0xee,0x48,0xb1,0x92,0xee,0x40,0xa3,0x80,0xda,0xaa,0xba,0x1f,}
+};
 GATT_DATA(const struct bg_gattdb_attribute_chrvalue	bg_gattdb_data_attribute_field_68 ) = {
 	.properties=0x28,
 	.index=19,
@@ -464,6 +548,27 @@ GATT_DATA(const struct bg_gattdb_attribute bg_gattdb_data_attributes_map[])={
     {.uuid=0x0002,.permissions=0x801,.caps=0xffff,.datatype=0x00,.min_key_size=0x00,.constdata=&bg_gattdb_data_attribute_field_67},
     {.uuid=0x8007,.permissions=0x802,.caps=0xffff,.datatype=0x07,.min_key_size=0x00,.dynamicdata=&bg_gattdb_data_attribute_field_68},
     {.uuid=0x001e,.permissions=0x807,.caps=0xffff,.datatype=0x03,.min_key_size=0x00,.configdata={.flags=0x02,.index=0x13,.clientconfig_index=0x07}},
+    {.uuid=0x0002,.permissions=0x801,.caps=0xffff,.datatype=0x00,.min_key_size=0x00,.constdata=&bg_gattdb_data_attribute_field_70},
+    {.uuid=0x8008,.permissions=0x800,.caps=0xffff,.datatype=0x07,.min_key_size=0x00,.dynamicdata=&bg_gattdb_data_attribute_field_71},
+    {.uuid=0x001e,.permissions=0x807,.caps=0xffff,.datatype=0x03,.min_key_size=0x00,.configdata={.flags=0x01,.index=0x14,.clientconfig_index=0x08}},
+    {.uuid=0x0002,.permissions=0x801,.caps=0xffff,.datatype=0x00,.min_key_size=0x00,.constdata=&bg_gattdb_data_attribute_field_73},
+    {.uuid=0x8009,.permissions=0x801,.caps=0xffff,.datatype=0x07,.min_key_size=0x00,.dynamicdata=&bg_gattdb_data_attribute_field_74},
+    {.uuid=0x001e,.permissions=0x807,.caps=0xffff,.datatype=0x03,.min_key_size=0x00,.configdata={.flags=0x01,.index=0x15,.clientconfig_index=0x09}},
+    {.uuid=0x0002,.permissions=0x801,.caps=0xffff,.datatype=0x00,.min_key_size=0x00,.constdata=&bg_gattdb_data_attribute_field_76},
+    {.uuid=0x800a,.permissions=0x801,.caps=0xffff,.datatype=0x07,.min_key_size=0x00,.dynamicdata=&bg_gattdb_data_attribute_field_77},
+    {.uuid=0x001e,.permissions=0x807,.caps=0xffff,.datatype=0x03,.min_key_size=0x00,.configdata={.flags=0x01,.index=0x16,.clientconfig_index=0x0a}},
+    {.uuid=0x0002,.permissions=0x801,.caps=0xffff,.datatype=0x00,.min_key_size=0x00,.constdata=&bg_gattdb_data_attribute_field_79},
+    {.uuid=0x800b,.permissions=0x800,.caps=0xffff,.datatype=0x07,.min_key_size=0x00,.dynamicdata=&bg_gattdb_data_attribute_field_80},
+    {.uuid=0x001e,.permissions=0x807,.caps=0xffff,.datatype=0x03,.min_key_size=0x00,.configdata={.flags=0x01,.index=0x17,.clientconfig_index=0x0b}},
+    {.uuid=0x0002,.permissions=0x801,.caps=0xffff,.datatype=0x00,.min_key_size=0x00,.constdata=&bg_gattdb_data_attribute_field_82},
+    {.uuid=0x800c,.permissions=0x800,.caps=0xffff,.datatype=0x07,.min_key_size=0x00,.dynamicdata=&bg_gattdb_data_attribute_field_83},
+    {.uuid=0x001e,.permissions=0x807,.caps=0xffff,.datatype=0x03,.min_key_size=0x00,.configdata={.flags=0x01,.index=0x18,.clientconfig_index=0x0c}},
+    {.uuid=0x0002,.permissions=0x801,.caps=0xffff,.datatype=0x00,.min_key_size=0x00,.constdata=&bg_gattdb_data_attribute_field_85},
+    {.uuid=0x800d,.permissions=0x800,.caps=0xffff,.datatype=0x07,.min_key_size=0x00,.dynamicdata=&bg_gattdb_data_attribute_field_86},
+    {.uuid=0x001e,.permissions=0x807,.caps=0xffff,.datatype=0x03,.min_key_size=0x00,.configdata={.flags=0x01,.index=0x19,.clientconfig_index=0x0d}},
+    {.uuid=0x0002,.permissions=0x801,.caps=0xffff,.datatype=0x00,.min_key_size=0x00,.constdata=&bg_gattdb_data_attribute_field_88},
+    {.uuid=0x800e,.permissions=0x801,.caps=0xffff,.datatype=0x07,.min_key_size=0x00,.dynamicdata=&bg_gattdb_data_attribute_field_89},
+    {.uuid=0x001e,.permissions=0x807,.caps=0xffff,.datatype=0x03,.min_key_size=0x00,.configdata={.flags=0x01,.index=0x1a,.clientconfig_index=0x0e}},
 };
 
 GATT_DATA(const uint16_t bg_gattdb_data_attributes_dynamic_mapping_map[])={
@@ -487,18 +592,25 @@ GATT_DATA(const uint16_t bg_gattdb_data_attributes_dynamic_mapping_map[])={
 	0x003f,
 	0x0042,
 	0x0045,
+	0x0048,
+	0x004b,
+	0x004e,
+	0x0051,
+	0x0054,
+	0x0057,
+	0x005a,
 };
 
 GATT_DATA(const uint8_t bg_gattdb_data_adv_uuid16_map[])={0x0f, 0x18, 0x16, 0x18, };
 GATT_DATA(const uint8_t bg_gattdb_data_adv_uuid128_map[])={0x0};
 GATT_HEADER(const struct bg_gattdb_def bg_gattdb_data)={
     .attributes=bg_gattdb_data_attributes_map,
-    .attributes_max=70,
+    .attributes_max=91,
     .uuidtable_16_size=31,
     .uuidtable_16=bg_gattdb_data_uuidtable_16_map,
-    .uuidtable_128_size=8,
+    .uuidtable_128_size=15,
     .uuidtable_128=bg_gattdb_data_uuidtable_128_map,
-    .attributes_dynamic_max=20,
+    .attributes_dynamic_max=27,
     .attributes_dynamic_mapping=bg_gattdb_data_attributes_dynamic_mapping_map,
     .adv_uuid16=bg_gattdb_data_adv_uuid16_map,
     .adv_uuid16_num=2,
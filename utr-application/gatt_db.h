@@ -33,5 +33,12 @@ extern const struct bg_gattdb_def bg_gattdb_data;
 #define gattdb_accor_acceleration              63
 #define gattdb_accor_orientation               66
 #define gattdb_accor_cp                        69
+#define gattdb_accor_raw                       72
+#define gattdb_accor_event                     75
+#define gattdb_accor_capture                   78
+#define gattdb_accor_spectrum                  81
+#define gattdb_accor_motion                    84
+#define gattdb_accor_linear                    87
+#define gattdb_accor_activity                  90
 
 #endif
@@ -18,38 +18,108 @@
 #include "imu.h"
 #include <math.h>
 
+// The fixed-point engine is implemented in imu_fixed.c
+#if !IMU_FIXED_POINT
+
 /***************************************************************************************************
  * Local Macros and Definitions
  **************************************************************************************************/
 
-#define MAX_ACCEL_FOR_ANGLE             0.9848
+/* All constants are single precision so nothing in the hot path is promoted to
+ * double, which the Cortex-M4 FPU can't do in hardware */
+#define MAX_ACCEL_FOR_ANGLE             0.9848f
+#define PI_F                            ((ImuFloat_t)IMU_PI)
+#define TWO_PI_F                        ((ImuFloat_t)(2 * IMU_PI))
+
+/* Keep the compiler honest, any implicit promotion in here is a build error */
+#pragma GCC diagnostic error "-Wdouble-promotion"
 
 /***************************************************************************************************
  * Local Function Definitions
  **************************************************************************************************/
-static void matrixMultiply(ImuFloat_t out[3][3], ImuFloat_t in_a[3][3], ImuFloat_t in_b[3][3])
+static inline ImuFloat_t vectorDotProduct(const ImuFloat_t in_a[3], const ImuFloat_t in_b[3])
 {
-  ImuFloat_t op[3];
+  return (in_a[0] * in_b[0]) + (in_a[1] * in_b[1]) + (in_a[2] * in_b[2]);
+}
 
-  for (uint8_t x = 0; x < 3; x++) {
-    for (uint8_t y = 0; y < 3; y++) {
-      for (uint8_t w = 0; w < 3; w++) {
-        op[w] = in_a[x][w] * in_b[w][y];
-      }
-      out[x][y] = op[0] + op[1] + op[2];
-    }
-  }
+/* out = in + (in x ang), i.e. one row of the dcm-matrix rotated by the skew
+ * symmetric matrix of ang. Safe to use in place. */
+static inline void rowRotate(ImuFloat_t out[3], const ImuFloat_t in[3], const ImuFloat_t ang[3])
+{
+  ImuFloat_t r0 = in[0];
+  ImuFloat_t r1 = in[1];
+  ImuFloat_t r2 = in[2];
+
+  out[0] = r0 + (r1 * ang[2]) - (r2 * ang[1]);
+  out[1] = r1 + (r2 * ang[0]) - (r0 * ang[2]);
+  out[2] = r2 + (r0 * ang[1]) - (r1 * ang[0]);
 }
 
-static ImuFloat_t vectorDotProduct(ImuFloat_t in_a[3], ImuFloat_t in_b[3])
+/* out = in * (3 - |in|^2) / 2, the Taylor expansion of in / |in| around 1 */
+static inline void rowRenormalize(ImuFloat_t out[3], const ImuFloat_t in[3])
 {
-  ImuFloat_t op = 0;
+  ImuFloat_t renorm = 0.5f * (3.0f - vectorDotProduct(in, in));
 
-  for (uint8_t x = 0; x < 3; x++) {
-    op += in_a[x] * in_b[x];
+  out[0] = in[0] * renorm;
+  out[1] = in[1] * renorm;
+  out[2] = in[2] * renorm;
+}
+
+/* Estimated direction of gravity in the rotating coordinate system, i.e. the
+ * bottom row of the rotation matrix of the quaternion */
+static inline void quatGravity(const ImuFloat_t q[4], ImuFloat_t v[3])
+{
+  v[0] = 2.0f * ((q[1] * q[3]) - (q[0] * q[2]));
+  v[1] = 2.0f * ((q[0] * q[1]) + (q[2] * q[3]));
+  v[2] = 1.0f - (2.0f * ((q[1] * q[1]) + (q[2] * q[2])));
+}
+
+/* q += q * (0, ang) / 2, i.e. rotate by the small angles in ang */
+static inline void quatRotate(ImuFloat_t q[4], const ImuFloat_t ang[3])
+{
+  ImuFloat_t hx = 0.5f * ang[0];
+  ImuFloat_t hy = 0.5f * ang[1];
+  ImuFloat_t hz = 0.5f * ang[2];
+  ImuFloat_t q0 = q[0];
+  ImuFloat_t q1 = q[1];
+  ImuFloat_t q2 = q[2];
+  ImuFloat_t q3 = q[3];
+
+  q[0] = q0 - (q1 * hx) - (q2 * hy) - (q3 * hz);
+  q[1] = q1 + (q0 * hx) + (q2 * hz) - (q3 * hy);
+  q[2] = q2 + (q0 * hy) - (q1 * hz) + (q3 * hx);
+  q[3] = q3 + (q0 * hz) + (q1 * hy) - (q2 * hx);
+}
+
+static inline void quatNormalize(ImuFloat_t q[4])
+{
+  ImuFloat_t norm = (q[0] * q[0]) + (q[1] * q[1]) + (q[2] * q[2]) + (q[3] * q[3]);
+  ImuFloat_t scale = 1.0f / sqrtf(norm);
+
+  q[0] *= scale;
+  q[1] *= scale;
+  q[2] *= scale;
+  q[3] *= scale;
+}
+
+/* Normalized copy of the accelerometer vector, false if it can't be used */
+static bool accNormalize(ImuFloat_t out[3], bool accValid, const ImuFloat_t accVec[3])
+{
+  ImuFloat_t norm;
+
+  if (!accValid) {
+    return false;
   }
+  norm = vectorDotProduct(accVec, accVec);
+  if (norm <= 0.0f) {
+    return false;
+  }
+  norm = 1.0f / sqrtf(norm);
+  out[0] = accVec[0] * norm;
+  out[1] = accVec[1] * norm;
+  out[2] = accVec[2] * norm;
 
-  return op;
+  return true;
 }
 
 /***************************************************************************************************
@@ -57,18 +127,18 @@ static ImuFloat_t vectorDotProduct(ImuFloat_t in_a[3], ImuFloat_t in_b[3])
  **************************************************************************************************/
 void imuAngleNormalize(ImuFloat_t *a)
 {
-  while (*a >= IMU_PI) {
-    *a -= (2 * IMU_PI);
+  while (*a >= PI_F) {
+    *a -= TWO_PI_F;
   }
-  while (*a < -IMU_PI) {
-    *a += (2 * IMU_PI);
+  while (*a < -PI_F) {
+    *a += TWO_PI_F;
   }
 }
 
 void imuVectorReset(ImuFloat_t inout[3])
 {
   for (uint8_t x = 0; x < 3; x++) {
-    inout[x] = 0.0;
+    inout[x] = 0.0f;
   }
 }
 
@@ -129,57 +199,38 @@ void imuDcmResetZ(ImuFloat_t dcmMatrix[3][3])
   dcmMatrix[0][1] = 0;
   dcmMatrix[0][2] = 0;
   imuVectorCrossProduct(&dcmMatrix[1][0], &dcmMatrix[0][0], &dcmMatrix[2][0]);
-  imuVectorScale(&dcmMatrix[1][0], -1.0);
+  imuVectorScale(&dcmMatrix[1][0], -1.0f);
   imuVectorCrossProduct(&dcmMatrix[0][0], &dcmMatrix[1][0], &dcmMatrix[2][0]);
 }
 
 void imuDcmRotate(ImuFloat_t dcmMatrix[3][3], ImuFloat_t ang[3])
 {
-  ImuFloat_t um[3][3];
-  ImuFloat_t tm[3][3];
-
-  um[0][0] = 0;
-  um[0][1] = -ang[2];
-  um[0][2] = ang[1];
-  um[1][0] = ang[2];
-  um[1][1] = 0;
-  um[1][2] = -ang[0];
-  um[2][0] = -ang[1];
-  um[2][1] = ang[0];
-  um[2][2] = 0;
-
-  matrixMultiply(tm, dcmMatrix, um);
-  for (uint8_t y = 0; y < 3; y++) {
-    for (uint8_t x = 0; x < 3; x++) {
-      dcmMatrix[y][x] += tm[y][x];
-    }
-  }
+  /* Equivalent to dcmMatrix += dcmMatrix * skew(ang), but the skew symmetric
+   * matrix is mostly zeros so each row is just a cross product */
+  rowRotate(dcmMatrix[0], dcmMatrix[0], ang);
+  rowRotate(dcmMatrix[1], dcmMatrix[1], ang);
+  rowRotate(dcmMatrix[2], dcmMatrix[2], ang);
 }
 
 void imuDcmNormalize(ImuFloat_t dcmMatrix[3][3])
 {
-  ImuFloat_t error = 0;
+  ImuFloat_t error;
   ImuFloat_t temporary[3][3];
-  ImuFloat_t renorm = 0;
-
-  error = -vectorDotProduct(&dcmMatrix[0][0], &dcmMatrix[1][0]) * .5;
-
-  imuVectorCopyAndScale(&temporary[0][0], &dcmMatrix[1][0], error);
-  imuVectorCopyAndScale(&temporary[1][0], &dcmMatrix[0][0], error);
 
-  imuVectorAdd(&temporary[0][0], &temporary[0][0], &dcmMatrix[0][0]);
-  imuVectorAdd(&temporary[1][0], &temporary[1][0], &dcmMatrix[1][0]);
+  error = -0.5f * vectorDotProduct(dcmMatrix[0], dcmMatrix[1]);
 
-  imuVectorCrossProduct(&temporary[2][0], &temporary[0][0], &temporary[1][0]);
+  /* Share the orthogonality error between the X and Y rows, then Z = X x Y */
+  temporary[0][0] = dcmMatrix[0][0] + (dcmMatrix[1][0] * error);
+  temporary[0][1] = dcmMatrix[0][1] + (dcmMatrix[1][1] * error);
+  temporary[0][2] = dcmMatrix[0][2] + (dcmMatrix[1][2] * error);
+  temporary[1][0] = dcmMatrix[1][0] + (dcmMatrix[0][0] * error);
+  temporary[1][1] = dcmMatrix[1][1] + (dcmMatrix[0][1] * error);
+  temporary[1][2] = dcmMatrix[1][2] + (dcmMatrix[0][2] * error);
+  imuVectorCrossProduct(temporary[2], temporary[0], temporary[1]);
 
-  renorm = .5 * (3 - vectorDotProduct(&temporary[0][0], &temporary[0][0]));
-  imuVectorCopyAndScale(&dcmMatrix[0][0], &temporary[0][0], renorm);
-
-  renorm = .5 * (3 - vectorDotProduct(&temporary[1][0], &temporary[1][0]));
-  imuVectorCopyAndScale(&dcmMatrix[1][0], &temporary[1][0], renorm);
-
-  renorm = .5 * (3 - vectorDotProduct(&temporary[2][0], &temporary[2][0]));
-  imuVectorCopyAndScale(&dcmMatrix[2][0], &temporary[2][0], renorm);
+  rowRenormalize(dcmMatrix[0], temporary[0]);
+  rowRenormalize(dcmMatrix[1], temporary[1]);
+  rowRenormalize(dcmMatrix[2], temporary[2]);
 }
 
 void imuDcmGetAngles(ImuFloat_t dcmMatrix[3][3], ImuFloat_t ang[3])
@@ -221,9 +272,9 @@ void imuSensorFusionGyroCorrCalc(ImuSensorFusion_t *fus, ImuFloat_t ori[3],
       imuVectorSubtract(fus->fusionAngleCorrection, accAng, ori);
       imuVectorAngleNormalize(fus->fusionAngleCorrection);
     } else {
-      accAng[0] = IMU_PI - imuAsin(accVec[1]);
+      accAng[0] = PI_F - imuAsin(accVec[1]);
       accAng[1] = -imuAsin(accVec[0]);
-      accAng[2] = IMU_PI + dirZ;
+      accAng[2] = PI_F + dirZ;
       imuVectorAngleNormalize(accAng);
       imuVectorSubtract(fus->fusionAngleCorrection, accAng, ori);
       imuVectorAngleNormalize(fus->fusionAngleCorrection);
@@ -232,6 +283,146 @@ void imuSensorFusionGyroCorrCalc(ImuSensorFusion_t *fus, ImuFloat_t ori[3],
     if (!dirValid) {
       fus->fusionAngleCorrection[2] = 0;
     }
-    imuVectorScale(fus->fusionAngleCorrection, 0.5 / freq);
+    imuVectorScale(fus->fusionAngleCorrection, 0.5f / freq);
+  }
+}
+
+void imuQuatReset(ImuQuatFusion_t *fus)
+{
+  fus->q[0] = 1.0f;
+  fus->q[1] = 0.0f;
+  fus->q[2] = 0.0f;
+  fus->q[3] = 0.0f;
+  imuVectorReset(fus->integral);
+}
+
+void imuQuatResetZ(ImuQuatFusion_t *fus)
+{
+  ImuFloat_t ang[3];
+  ImuFloat_t cr, sr, cp, sp;
+
+  // Rebuild from roll and pitch only, this is rare so the trig doesn't matter
+  imuQuatGetAngles(fus, ang);
+  cr = cosf(0.5f * ang[0]);
+  sr = sinf(0.5f * ang[0]);
+  cp = cosf(0.5f * ang[1]);
+  sp = sinf(0.5f * ang[1]);
+
+  fus->q[0] = cr * cp;
+  fus->q[1] = sr * cp;
+  fus->q[2] = cr * sp;
+  fus->q[3] = -sr * sp;
+}
+
+void imuQuatRotate(ImuQuatFusion_t *fus, ImuFloat_t gyr[3], int16_t freq)
+{
+  ImuFloat_t ang[3];
+  ImuFloat_t dt = 1.0f / freq;
+
+  // Mahony integral feedback is a gyro bias estimate, applied every sample
+  ang[0] = gyr[0] + (fus->integral[0] * dt);
+  ang[1] = gyr[1] + (fus->integral[1] * dt);
+  ang[2] = gyr[2] + (fus->integral[2] * dt);
+
+  quatRotate(fus->q, ang);
+}
+
+void imuQuatNormalize(ImuQuatFusion_t *fus)
+{
+  quatNormalize(fus->q);
+}
+
+void imuQuatMahonyCorrect(ImuQuatFusion_t *fus,
+                          bool accValid, ImuFloat_t accVec[3],
+                          ImuFloat_t kp, ImuFloat_t ki,
+                          int16_t freq)
+{
+  ImuFloat_t acc[3];
+  ImuFloat_t v[3];
+  ImuFloat_t err[3];
+  ImuFloat_t dt = 1.0f / freq;
+
+  if (accNormalize(acc, accValid, accVec)) {
+    // Error is the rotation from estimated to measured gravity
+    quatGravity(fus->q, v);
+    imuVectorCrossProduct(err, acc, v);
+
+    for (uint8_t x = 0; x < 3; x++) {
+      fus->integral[x] += ki * err[x] * dt;
+      err[x] *= kp * dt;
+    }
+    quatRotate(fus->q, err);
+  }
+}
+
+void imuQuatMadgwickCorrect(ImuQuatFusion_t *fus,
+                            bool accValid, ImuFloat_t accVec[3],
+                            ImuFloat_t beta,
+                            int16_t freq)
+{
+  ImuFloat_t *q = fus->q;
+  ImuFloat_t acc[3];
+  ImuFloat_t f[3];
+  ImuFloat_t s[4];
+  ImuFloat_t norm;
+  ImuFloat_t step;
+
+  if (accNormalize(acc, accValid, accVec)) {
+    // Objective function, estimated minus measured gravity
+    quatGravity(q, f);
+    f[0] -= acc[0];
+    f[1] -= acc[1];
+    f[2] -= acc[2];
+
+    // Gradient, the transposed Jacobian of the objective function times f
+    s[0] = (-2.0f * q[2] * f[0]) + (2.0f * q[1] * f[1]);
+    s[1] = (2.0f * q[3] * f[0]) + (2.0f * q[0] * f[1]) - (4.0f * q[1] * f[2]);
+    s[2] = (-2.0f * q[0] * f[0]) + (2.0f * q[3] * f[1]) - (4.0f * q[2] * f[2]);
+    s[3] = (2.0f * q[1] * f[0]) + (2.0f * q[2] * f[1]);
+
+    norm = (s[0] * s[0]) + (s[1] * s[1]) + (s[2] * s[2]) + (s[3] * s[3]);
+    if (norm > 0.0f) {
+      step = beta / (freq * sqrtf(norm));
+      q[0] -= s[0] * step;
+      q[1] -= s[1] * step;
+      q[2] -= s[2] * step;
+      q[3] -= s[3] * step;
+    }
+  }
+}
+
+void imuQuatGetDcm(ImuQuatFusion_t *fus, ImuFloat_t dcmMatrix[3][3])
+{
+  ImuFloat_t *q = fus->q;
+
+  dcmMatrix[0][0] = 1.0f - (2.0f * ((q[2] * q[2]) + (q[3] * q[3])));
+  dcmMatrix[0][1] = 2.0f * ((q[1] * q[2]) - (q[0] * q[3]));
+  dcmMatrix[0][2] = 2.0f * ((q[1] * q[3]) + (q[0] * q[2]));
+  dcmMatrix[1][0] = 2.0f * ((q[1] * q[2]) + (q[0] * q[3]));
+  dcmMatrix[1][1] = 1.0f - (2.0f * ((q[1] * q[1]) + (q[3] * q[3])));
+  dcmMatrix[1][2] = 2.0f * ((q[2] * q[3]) - (q[0] * q[1]));
+  quatGravity(q, dcmMatrix[2]);
+}
+
+void imuQuatGetAngles(ImuQuatFusion_t *fus, ImuFloat_t ang[3])
+{
+  ImuFloat_t *q = fus->q;
+  ImuFloat_t sinPitch = 2.0f * ((q[1] * q[3]) - (q[0] * q[2]));
+
+  // Same as imuDcmGetAngles() on the rotation matrix of the quaternion
+  if (sinPitch > 1.0f) {
+    sinPitch = 1.0f;
+  } else if (sinPitch < -1.0f) {
+    sinPitch = -1.0f;
   }
+  // Roll
+  ang[0] = imuAtan2(2.0f * ((q[0] * q[1]) + (q[2] * q[3])),
+                    1.0f - (2.0f * ((q[1] * q[1]) + (q[2] * q[2]))));
+  // Pitch
+  ang[1] = -imuAsin(sinPitch);
+  // Yaw
+  ang[2] = imuAtan2(2.0f * ((q[1] * q[2]) + (q[0] * q[3])),
+                    1.0f - (2.0f * ((q[2] * q[2]) + (q[3] * q[3]))));
 }
+
+#endif // !IMU_FIXED_POINT
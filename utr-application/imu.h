@@ -61,24 +61,87 @@ extern "C" {
 #define IMU_DEG_TO_RAD(ang)     (ang * IMU_DEG_TO_RAD_FACTOR)
 #define IMU_RAD_TO_DEG(ang)     (ang * IMU_RAD_TO_DEG_FACTOR)
 
-#if 1
+/** Select the fixed-point engine in imu_fixed.c instead of the floating point
+ *  engine in imu.c. The fixed-point engine needs no FPU and has a data
+ *  independent cycle count. */
+#define IMU_FIXED_POINT 0
+
+/** Use the polynomial approximations in fastmath.c instead of libm for the
+ *  floating point engine trig. Max error is FASTMATH_TRIG_MAX_ERROR.
+ *  Off until it is timed on the target. On an x86 host fastAtan2f() is about
+ *  twice as fast as atan2f(), but fastAsinf() is slower than asinf(), see the
+ *  throughput report of utest/fastmath_test.cpp. */
+#define IMU_FAST_TRIG 0
+
+#if IMU_FIXED_POINT
+#include "imu_fixed.h"
+#define ImuFloat_t  ImuFixed_t
+#define imuAsin(x)  imuFixedAsin(x)
+#define imuAtan2(x, y) imuFixedAtan2(x, y)
+#elif IMU_FAST_TRIG
+/* Single precision only, the Cortex-M4 FPU has no double precision support */
+#include "fastmath.h"
+#define ImuFloat_t  float
+#define imuAsin(x)  fastAsinf(x)
+#define imuAtan2(x, y) fastAtan2f(x, y)
+#else
 #define ImuFloat_t  float
 #define imuAsin(x)  asinf(x)
 #define imuAtan2(x, y) atan2f(x, y)
+#endif
+
+/** Engine independent conversions, use these instead of mixing ImuFloat_t with
+ *  other types directly.
+ *  IMU_CONST converts a constant expression, imuFromRatio converts num / den,
+ *  imuToInt converts to an integer after scaling and imuMul multiplies. */
+#if IMU_FIXED_POINT
+#define IMU_CONST(x)            IMU_FIXED(x)
+#define imuFromRatio(num, den)  imuFixedFromRatio(num, den)
+#define imuToInt(a, scale)      imuFixedToInt(a, scale)
+#define imuMul(a, b)            imuFixedMul(a, b)
 #else
-#define ImuFloat_t  double
-#define imuAsin(x)  asin(x)
-#define imuAtan2(x, y) atan2(x, y)
+#define IMU_CONST(x)            ((ImuFloat_t)(x))
+#define imuFromRatio(num, den)  ((ImuFloat_t)(num) / (ImuFloat_t)(den))
+#define imuToInt(a, scale)      ((int32_t)((a) * (ImuFloat_t)(scale)))
+#define imuMul(a, b)            ((a) * (b))
+#endif
+
+#if IMU_FIXED_POINT
+#define ImuSensorFusion_t               ImuFixedSensorFusion_t
+#define imuAngleNormalize               imuFixedAngleNormalize
+#define imuVectorReset                  imuFixedVectorReset
+#define imuVectorAngleNormalize         imuFixedVectorAngleNormalize
+#define imuVectorAdd                    imuFixedVectorAdd
+#define imuVectorSubtract               imuFixedVectorSubtract
+#define imuVectorCopyAndScale           imuFixedVectorCopyAndScale
+#define imuVectorScale                  imuFixedVectorScale
+#define imuVectorCrossProduct           imuFixedVectorCrossProduct
+#define imuDcmReset                     imuFixedDcmReset
+#define imuDcmResetZ                    imuFixedDcmResetZ
+#define imuDcmRotate                    imuFixedDcmRotate
+#define imuDcmNormalize                 imuFixedDcmNormalize
+#define imuDcmGetAngles                 imuFixedDcmGetAngles
+#define imuSensorFusionGyroCorrClr      imuFixedSensorFusionGyroCorrClr
+#define imuSensorFusionGyroCorrDo       imuFixedSensorFusionGyroCorrDo
+#define imuSensorFusionGyroCorrCalc     imuFixedSensorFusionGyroCorrCalc
 #endif
 
 /**************************************************************************************************
  * Public Type Declarations
  *************************************************************************************************/
 
+#if !IMU_FIXED_POINT
 typedef struct {
   ImuFloat_t   fusionAngleCorrection[3];
 } ImuSensorFusion_t;
 
+/** Quaternion sensor fusion state, floating point engine only */
+typedef struct {
+  ImuFloat_t   q[4];
+  ImuFloat_t   integral[3];
+} ImuQuatFusion_t;
+#endif
+
 /**************************************************************************************************
  * Public Function Declarations
  *************************************************************************************************/
@@ -256,6 +319,110 @@ void imuSensorFusionGyroCorrCalc(ImuSensorFusion_t *fus, ImuFloat_t ori[3],
                                  bool dirValid, ImuFloat_t dirZ,
                                  int16_t freq);
 
+#if !IMU_FIXED_POINT
+/**********************************************************************************************//**
+ * @brief
+ *   Reset the quaternion fusion, i.e. identity orientation and no integrated
+ *   error.
+ * @param[out] fus
+ *   Pointer to the quaternion fusion data.
+ *************************************************************************************************/
+void imuQuatReset(ImuQuatFusion_t *fus);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Reset only the rotation around the z-axis, keeping roll and pitch.
+ * @param[in,out] fus
+ *   Pointer to the quaternion fusion data.
+ *************************************************************************************************/
+void imuQuatResetZ(ImuQuatFusion_t *fus);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Rotate the quaternion by the gyro data and the integrated Mahony feedback.
+ *   Call for every sample.
+ * @param[in,out] fus
+ *   Pointer to the quaternion fusion data.
+ * @param[in] gyr
+ *   Angles turned since the previous sample, relative to the rotating
+ *   coordinate system.
+ * @param[in] freq
+ *   The sample frequency.
+ *************************************************************************************************/
+void imuQuatRotate(ImuQuatFusion_t *fus, ImuFloat_t gyr[3], int16_t freq);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Adjust the quaternion to unit length. Doesn't need to be called for every
+ *   sample, the length only drifts slowly.
+ * @param[in,out] fus
+ *   Pointer to the quaternion fusion data.
+ *************************************************************************************************/
+void imuQuatNormalize(ImuQuatFusion_t *fus);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Correct the quaternion towards the accelerometer with Mahony PI feedback.
+ * @param[in,out] fus
+ *   Pointer to the quaternion fusion data.
+ * @param[in] accValid
+ *   A boolean that says if the accelerometer vector contains valid data.
+ * @param[in] accVec
+ *   The accelerometer vector.
+ * @param[in] kp
+ *   Proportional gain, in 1/s.
+ * @param[in] ki
+ *   Integral gain, in 1/s^2.
+ * @param[in] freq
+ *   The correction frequency.
+ *************************************************************************************************/
+void imuQuatMahonyCorrect(ImuQuatFusion_t *fus,
+                          bool accValid, ImuFloat_t accVec[3],
+                          ImuFloat_t kp, ImuFloat_t ki,
+                          int16_t freq);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Correct the quaternion towards the accelerometer with a Madgwick gradient
+ *   descent step.
+ * @param[in,out] fus
+ *   Pointer to the quaternion fusion data.
+ * @param[in] accValid
+ *   A boolean that says if the accelerometer vector contains valid data.
+ * @param[in] accVec
+ *   The accelerometer vector.
+ * @param[in] beta
+ *   Gradient step gain, in rad/s.
+ * @param[in] freq
+ *   The correction frequency.
+ *************************************************************************************************/
+void imuQuatMadgwickCorrect(ImuQuatFusion_t *fus,
+                            bool accValid, ImuFloat_t accVec[3],
+                            ImuFloat_t beta,
+                            int16_t freq);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Get the quaternion angles, same convention as imuDcmGetAngles().
+ * @param[in] fus
+ *   Pointer to the quaternion fusion data.
+ * @param[out] ang
+ *   The angles relative to the fixed coordinate system.
+ *************************************************************************************************/
+void imuQuatGetAngles(ImuQuatFusion_t *fus, ImuFloat_t ang[3]);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Get the rotation matrix of the quaternion, same convention as the
+ *   dcm-matrix.
+ * @param[in] fus
+ *   Pointer to the quaternion fusion data.
+ * @param[out] dcmMatrix
+ *   Pointer to the matrix.
+ *************************************************************************************************/
+void imuQuatGetDcm(ImuQuatFusion_t *fus, ImuFloat_t dcmMatrix[3][3]);
+#endif
+
 /** @} (end addtogroup imu) */
 /** @} (end addtogroup Thunderboard) */
 
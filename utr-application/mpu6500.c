@@ -16,7 +16,9 @@
  ******************************************************************************/
 
 #include "mpu6500.h"
+#include "dmp_quat.h"
 #include <stdlib.h>
+#include <string.h>
 
 /***************************************************************************************************
  *******************************   DEFINES   *******************************************************
@@ -32,12 +34,24 @@
 #define REG_GYRO_CONFIG                 27
 #define REG_ACCEL_CONFIG                28
 #define REG_ACCEL_CONFIG_2              29
+#define REG_LP_ACCEL_ODR                30
+#define REG_WOM_THR                     31
+#define REG_FIFO_EN                     35
 #define REG_INT_PIN_CFG                 55
 #define REG_INT_ENABLE                  56
 #define REG_INT_STATUS                  58
 #define REG_ACCE_TEMP_GYRO              59
+#define REG_TEMP_OUT                    65
+#define REG_ACCEL_INTEL_CTRL           105
+#define REG_USER_CTRL                  106
 #define REG_PWR_MANAGEMENT_1           107
 #define REG_PWR_MANAGEMENT_2           108
+#define REG_BANK_SEL                   109
+#define REG_MEM_START_ADDR             110
+#define REG_MEM_R_W                    111
+#define REG_PRGM_START_H               112
+#define REG_FIFO_COUNT                 114
+#define REG_FIFO_R_W                   116
 #define REG_WHO_AM_I                   117
 
 #define REG_CONFIG_DLPF_CFG_250HZ                       0x00
@@ -48,6 +62,7 @@
 #define REG_CONFIG_DLPF_CFG_10HZ                        0x05
 #define REG_CONFIG_DLPF_CFG_5HZ                         0x06
 #define REG_CONFIG_DLPF_CFG_3600HZ                      0x07
+#define REG_CONFIG_FIFO_MODE_NO_OVERWRITE               0x40
 #define REG_GYRO_CONFIG_FCHOICE_B_USE_DLPF              0x00
 #define REG_GYRO_CONFIG_GYRO_FS_SEL_250DPS              0x00
 #define REG_GYRO_CONFIG_GYRO_FS_SEL_500DPS              0x08
@@ -64,26 +79,73 @@
 #define REG_ACCEL_CONFIG_2_A_DLPF_CFG_20HZ              0x04
 #define REG_ACCEL_CONFIG_2_A_DLPF_CFG_10HZ              0x05
 #define REG_ACCEL_CONFIG_2_A_DLPF_CFG_5HZ               0x06
+#define REG_FIFO_EN_DISABLE                             0x00
+#define REG_FIFO_EN_GYRO_XYZ                            0x70
+#define REG_FIFO_EN_ACCEL                               0x08
+#define REG_USER_CTRL_DMP_EN                            0x80
+#define REG_USER_CTRL_FIFO_EN                           0x40
+#define REG_USER_CTRL_DMP_RST                           0x08
+#define REG_USER_CTRL_FIFO_RST                          0x04
+#define REG_USER_CTRL_RESET_BITS                        0x0f
+#define REG_PWR_MANAGEMENT_1_H_RESET                    0x80
 #define REG_PWR_MANAGEMENT_1_GYRO_STANDBY               0x10
 #define REG_PWR_MANAGEMENT_1_SLEEP                      0x40
+#define REG_PWR_MANAGEMENT_1_CYCLE                      0x20
 #define REG_PWR_MANAGEMENT_2_DISABLE_GYROS              0x07
 #define REG_PWR_MANAGEMENT_2_DISABLE_ACCELEROMETERS     0x38
 #define REG_INT_PIN_CFG_LATCH_INT_EN                    0x20
 #define REG_INT_PIN_CFG_ACTL                            0x80
 #define REG_INT_ENABLE_DISABLE                          0x00
+#define REG_INT_ENABLE_WOM_EN                           0x40
+#define REG_INT_ENABLE_FIFO_OFLOW_EN                    0x10
 #define REG_INT_ENABLE_RAW_RDY_EN                       0x01
+#define REG_INT_STATUS_FIFO_OFLOW                       0x10
 #define REG_INT_STATUS_DATA_RDY                         0x01
+#define REG_ACCEL_INTEL_CTRL_EN                         0x80
+#define REG_ACCEL_INTEL_CTRL_MODE_COMPARE               0x40
 #define REG_WHO_AM_I_EXPECTED                           0x70
 
 #define DUMMY_INTERRUPT_FREQ            1
 
+#define FIFO_SIZE                       512
+#define FIFO_SAMPLE_SIZE                sizeof(Mpu6500Sample_t)
+
+// The DMP runs from its own memory, written in chunks that don't cross a
+// bank. It samples at a fixed rate and puts a quaternion packet in the FIFO
+// every so many samples, see dmp_quat.h.
+#define DMP_BANK_SIZE                   256
+#define DMP_CHUNK_SIZE                  16
+#define DMP_SAMPLE_FREQ                 200
+#define DMP_CONFIG_MAX_LENGTH           12
+
 #define SHOW_GYROOFS                    0
 
 #define BUFFER_TO_INT16(buf, ofs) ((buf[ofs] << 8) + buf[ofs + 1])
 
+// Temperature in 0.01 degrees C is TEMP_OUT / 3.3387 + 2100
+#define TEMP_SENSITIVITY_X10000         33387
+#define TEMP_OFFSET                     2100
+
 #define ERROR_LEVEL_ACC_REG             30000
 #define ERROR_LEVEL_GYR_REG             30000
 
+// Wake-on-motion threshold resolution
+#define WOM_THRESHOLD_MG_PER_LSB        4
+
+#define SHADOW_REG_COUNT                (sizeof(shadowRegs) / sizeof(shadowRegs[0]))
+
+#if MPU6500_DMP_FIRMWARE_AVAILABLE
+/** A write to DMP memory, for the firmware specific configuration */
+typedef struct {
+  uint16_t addr;
+  uint8_t  len;
+  uint8_t  data[DMP_CONFIG_MAX_LENGTH];
+} Mpu6500DmpWrite_t;
+
+// The DMP image and its configuration, see MPU6500_DMP_FIRMWARE_AVAILABLE
+#include "mpu6500_dmp_firmware.h"
+#endif
+
 /***************************************************************************************************
  **************************   LOCAL variables    ***************************************************
  **************************************************************************************************/
@@ -94,6 +156,8 @@ static bool     accEnable = true;
 static int16_t  gyrScale = 250;
 static bool     gyrEnable = true;
 
+static uint8_t  configFifoMode = 0;
+
 static int16_t  gyrOfsX = 0;
 static int16_t  gyrOfsY = 0;
 static int16_t  gyrOfsZ = 0;
@@ -105,10 +169,34 @@ static int32_t  gyroCalibrationTotalCnt = 0;
 static int32_t  gyroCalibrationProgressCnt = 0;
 static int32_t  gyroCalibrationFactor = 8;
 
+// Shadow of the writable configuration registers. Reads are served from the
+// shadow and writes of an unchanged value skip the bus. A register is only
+// valid once it has been read or written, and all are invalidated whenever the
+// chip may have been reset.
+static const uint8_t shadowRegs[] = {
+  REG_SMPLRT_DIV,
+  REG_CONFIG,
+  REG_GYRO_CONFIG,
+  REG_ACCEL_CONFIG,
+  REG_ACCEL_CONFIG_2,
+  REG_LP_ACCEL_ODR,
+  REG_WOM_THR,
+  REG_FIFO_EN,
+  REG_INT_PIN_CFG,
+  REG_INT_ENABLE,
+  REG_ACCEL_INTEL_CTRL,
+  REG_USER_CTRL,
+  REG_PWR_MANAGEMENT_1,
+  REG_PWR_MANAGEMENT_2,
+};
+static uint8_t  shadowValue[SHADOW_REG_COUNT];
+static uint16_t shadowValid = 0;
+static uint32_t shadowSavedTransactions = 0;
+
 /***************************************************************************************************
  **************************   LOCAL FUNCTIONS   ***************************************************
  **************************************************************************************************/
-static I2C_TransferReturn_TypeDef registerRead8(I2C_TypeDef *i2c, uint8_t addr, uint8_t reg, uint8_t *val)
+static I2C_TransferReturn_TypeDef busRead8(I2C_TypeDef *i2c, uint8_t addr, uint8_t reg, uint8_t *val)
 {
   I2C_TransferSeq_TypeDef    seq;
   I2C_TransferReturn_TypeDef ret;
@@ -162,7 +250,7 @@ static I2C_TransferReturn_TypeDef registerRead16(I2C_TypeDef *i2c, uint8_t addr,
   return ret;
 }
 
-static I2C_TransferReturn_TypeDef registerWrite8(I2C_TypeDef *i2c, uint8_t addr, uint8_t reg, uint8_t val)
+static I2C_TransferReturn_TypeDef busWrite8(I2C_TypeDef *i2c, uint8_t addr, uint8_t reg, uint8_t val)
 {
   I2C_TransferSeq_TypeDef    seq;
   I2C_TransferReturn_TypeDef ret;
@@ -205,6 +293,145 @@ static I2C_TransferReturn_TypeDef registerWrite16(I2C_TypeDef *i2c, uint8_t addr
   return ret;
 }
 
+#if MPU6500_DMP_FIRMWARE_AVAILABLE
+static I2C_TransferReturn_TypeDef dmpMemTransfer(I2C_TypeDef *i2c, uint8_t addr, uint16_t memAddr,
+                                                 uint8_t *data, uint16_t len, bool write)
+{
+  I2C_TransferSeq_TypeDef    seq;
+  I2C_TransferReturn_TypeDef ret;
+  uint8_t                    i2c_write_data[3];
+
+  // Bank and start address in one go, they are consecutive registers
+  seq.addr  = addr;
+  seq.flags = I2C_FLAG_WRITE;
+  i2c_write_data[0] = REG_BANK_SEL;
+  i2c_write_data[1] = memAddr >> 8;
+  i2c_write_data[2] = memAddr & 0xff;
+  seq.buf[0].data   = i2c_write_data;
+  seq.buf[0].len    = 3;
+  seq.buf[1].data = 0;
+  seq.buf[1].len  = 0;
+  ret = I2CSPM_Transfer(i2c, &seq);
+  if (ret != i2cTransferDone) {
+    return ret;
+  }
+
+  seq.flags = write ? I2C_FLAG_WRITE_WRITE : I2C_FLAG_WRITE_READ;
+  i2c_write_data[0] = REG_MEM_R_W;
+  seq.buf[0].data   = i2c_write_data;
+  seq.buf[0].len    = 1;
+  seq.buf[1].data = data;
+  seq.buf[1].len  = len;
+  return I2CSPM_Transfer(i2c, &seq);
+}
+
+static bool dmpMemWrite(I2C_TypeDef *i2c, uint8_t addr, uint16_t memAddr,
+                        const uint8_t *data, uint16_t len)
+{
+  uint8_t  chunk[DMP_CHUNK_SIZE];
+  uint8_t  verify[DMP_CHUNK_SIZE];
+  uint16_t n;
+
+  while (len) {
+    n = (len < DMP_CHUNK_SIZE) ? len : DMP_CHUNK_SIZE;
+    if ((memAddr % DMP_BANK_SIZE) + n > DMP_BANK_SIZE) {
+      n = DMP_BANK_SIZE - (memAddr % DMP_BANK_SIZE);
+    }
+
+    // Copied, as the transfer wants a writable buffer
+    memcpy(chunk, data, n);
+    if ((dmpMemTransfer(i2c, addr, memAddr, chunk, n, true) != i2cTransferDone)
+        || (dmpMemTransfer(i2c, addr, memAddr, verify, n, false) != i2cTransferDone)
+        || (memcmp(chunk, verify, n) != 0)) {
+      return false;
+    }
+
+    memAddr += n;
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+#endif
+
+static int8_t shadowIndex(uint8_t reg)
+{
+  for (uint8_t i = 0; i < SHADOW_REG_COUNT; i++) {
+    if (shadowRegs[i] == reg) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void shadowInvalidate(void)
+{
+  shadowValid = 0;
+}
+
+static I2C_TransferReturn_TypeDef registerRead8(I2C_TypeDef *i2c, uint8_t addr, uint8_t reg, uint8_t *val)
+{
+  I2C_TransferReturn_TypeDef ret;
+  uint8_t                    data;
+  int8_t                     idx = shadowIndex(reg);
+
+  if ((idx >= 0) && (shadowValid & (1 << idx))) {
+    shadowSavedTransactions++;
+    if (NULL != val) {
+      *val = shadowValue[idx];
+    }
+    return i2cTransferDone;
+  }
+
+  ret = busRead8(i2c, addr, reg, &data);
+  if (ret != i2cTransferDone) {
+    return ret;
+  }
+  if (idx >= 0) {
+    shadowValue[idx] = data;
+    shadowValid |= (1 << idx);
+  }
+  if (NULL != val) {
+    *val = data;
+  }
+  return ret;
+}
+
+static I2C_TransferReturn_TypeDef registerWrite8(I2C_TypeDef *i2c, uint8_t addr, uint8_t reg, uint8_t val)
+{
+  I2C_TransferReturn_TypeDef ret;
+  uint8_t                    resetBits = 0;
+  int8_t                     idx = shadowIndex(reg);
+
+  // Self clearing reset bits always go to the chip, and aren't kept
+  if (reg == REG_USER_CTRL) {
+    resetBits = REG_USER_CTRL_RESET_BITS;
+  } else if (reg == REG_PWR_MANAGEMENT_1) {
+    resetBits = REG_PWR_MANAGEMENT_1_H_RESET;
+  }
+
+  if ((idx >= 0) && !(val & resetBits)
+      && (shadowValid & (1 << idx)) && (shadowValue[idx] == val)) {
+    shadowSavedTransactions++;
+    return i2cTransferDone;
+  }
+
+  ret = busWrite8(i2c, addr, reg, val);
+  if ((reg == REG_PWR_MANAGEMENT_1) && (val & REG_PWR_MANAGEMENT_1_H_RESET)) {
+    // Every register is back at its reset value
+    shadowInvalidate();
+  } else if (idx >= 0) {
+    if (ret == i2cTransferDone) {
+      shadowValue[idx] = val & ~resetBits;
+      shadowValid |= (1 << idx);
+    } else {
+      // Don't know what the chip got
+      shadowValid &= ~(1 << idx);
+    }
+  }
+  return ret;
+}
+
 static void waitForNewData(I2C_TypeDef *i2c, uint8_t addr)
 {
   uint8_t uReg;
@@ -257,6 +484,13 @@ static void gyroCalibrateStep(I2C_TypeDef *i2c, uint8_t addr,
   }
 }
 
+static void rangeErrorTest(int16_t x, int16_t y, int16_t z, bool *rangeError)
+{
+  *rangeError = ((abs(x) >= ERROR_LEVEL_ACC_REG)
+                 || (abs(y) >= ERROR_LEVEL_ACC_REG)
+                 || (abs(z) >= ERROR_LEVEL_ACC_REG));
+}
+
 static bool chipEnable(I2C_TypeDef *i2c, uint8_t addr, bool enable)
 {
   uint8_t reg;
@@ -298,6 +532,9 @@ bool mpu6500_Detect(I2C_TypeDef *i2c, uint8_t addr)
   I2C_TransferReturn_TypeDef sta;
   bool detected = false;
 
+  // The chip may have been power cycled or reset since it was last seen
+  shadowInvalidate();
+
   sta = registerRead8(i2c, addr, REG_WHO_AM_I, &reg);
   detected = sta == i2cTransferDone;
   if (detected) {
@@ -322,6 +559,92 @@ bool mpu6500_ConfigureInterrupt(I2C_TypeDef *i2c, uint8_t addr, bool on, int16_t
   return sta == i2cTransferDone;
 }
 
+bool mpu6500_ConfigureFifo(I2C_TypeDef *i2c, uint8_t addr, bool on, int16_t freq)
+{
+  I2C_TransferReturn_TypeDef sta;
+  uint8_t reg;
+
+  // Stop and flush the FIFO before changing anything
+  registerWrite8(i2c, addr, REG_FIFO_EN, REG_FIFO_EN_DISABLE);
+  registerWrite8(i2c, addr, REG_USER_CTRL, REG_USER_CTRL_FIFO_RST);
+
+  // Never let the FIFO overwrite old data, as that would break the sample
+  // alignment. Data is instead dropped when full, which is signalled through
+  // the overflow interrupt.
+  configFifoMode = on ? REG_CONFIG_FIFO_MODE_NO_OVERWRITE : 0;
+  sta = registerRead8(i2c, addr, REG_CONFIG, &reg);
+  reg &= ~REG_CONFIG_FIFO_MODE_NO_OVERWRITE;
+  reg |= configFifoMode;
+  sta = registerWrite8(i2c, addr, REG_CONFIG, reg);
+
+  reg = (1000 / freq) - 1;
+  sta = registerWrite8(i2c, addr, REG_SMPLRT_DIV, reg);
+  sta = registerWrite8(i2c, addr, REG_INT_PIN_CFG, REG_INT_PIN_CFG_ACTL);
+  sta = registerWrite8(i2c, addr, REG_INT_ENABLE,
+                       on ? REG_INT_ENABLE_FIFO_OFLOW_EN : REG_INT_ENABLE_DISABLE);
+  if (on) {
+    sta = registerWrite8(i2c, addr, REG_USER_CTRL, REG_USER_CTRL_FIFO_EN);
+    sta = registerWrite8(i2c, addr, REG_FIFO_EN, REG_FIFO_EN_ACCEL | REG_FIFO_EN_GYRO_XYZ);
+  } else {
+    sta = registerWrite8(i2c, addr, REG_USER_CTRL, 0);
+  }
+
+  return sta == i2cTransferDone;
+}
+
+bool mpu6500_ConfigureWakeOnMotion(I2C_TypeDef *i2c, uint8_t addr, bool on,
+                                   uint16_t thresholdMg, Mpu6500LpAccelFreq_t rate)
+{
+  I2C_TransferReturn_TypeDef sta;
+  uint8_t reg;
+  uint16_t threshold;
+
+  if (on) {
+    threshold = thresholdMg / WOM_THRESHOLD_MG_PER_LSB;
+    if (threshold > UINT8_MAX) {
+      threshold = UINT8_MAX;
+    }
+
+    // Accelerometer only, at full bandwidth, as required by the motion
+    // detection logic
+    chipEnable(i2c, addr, true);
+    sta = registerWrite8(i2c, addr, REG_PWR_MANAGEMENT_2, REG_PWR_MANAGEMENT_2_DISABLE_GYROS);
+    sta = registerWrite8(i2c, addr, REG_ACCEL_CONFIG_2, REG_ACCEL_CONFIG_2_A_DLPF_CFG_184HZ);
+
+    sta = registerWrite8(i2c, addr, REG_INT_PIN_CFG, REG_INT_PIN_CFG_ACTL);
+    sta = registerWrite8(i2c, addr, REG_INT_ENABLE, REG_INT_ENABLE_WOM_EN);
+    sta = registerWrite8(i2c, addr, REG_ACCEL_INTEL_CTRL,
+                         REG_ACCEL_INTEL_CTRL_EN | REG_ACCEL_INTEL_CTRL_MODE_COMPARE);
+    sta = registerWrite8(i2c, addr, REG_WOM_THR, (uint8_t)threshold);
+    sta = registerWrite8(i2c, addr, REG_LP_ACCEL_ODR, (uint8_t)rate);
+
+    // Let the chip sleep between accelerometer samples
+    sta = registerRead8(i2c, addr, REG_PWR_MANAGEMENT_1, &reg);
+    reg |= REG_PWR_MANAGEMENT_1_CYCLE;
+    sta = registerWrite8(i2c, addr, REG_PWR_MANAGEMENT_1, reg);
+  } else {
+    sta = registerRead8(i2c, addr, REG_PWR_MANAGEMENT_1, &reg);
+    reg &= ~REG_PWR_MANAGEMENT_1_CYCLE;
+    sta = registerWrite8(i2c, addr, REG_PWR_MANAGEMENT_1, reg);
+
+    sta = registerWrite8(i2c, addr, REG_INT_ENABLE, REG_INT_ENABLE_DISABLE);
+    sta = registerWrite8(i2c, addr, REG_ACCEL_INTEL_CTRL, 0);
+
+    // Back to the power state set up by the enable functions
+    reg = 0;
+    if (!accEnable) {
+      reg |= REG_PWR_MANAGEMENT_2_DISABLE_ACCELEROMETERS;
+    }
+    if (!gyrEnable) {
+      reg |= REG_PWR_MANAGEMENT_2_DISABLE_GYROS;
+    }
+    chipEnable(i2c, addr, accEnable || gyrEnable);
+    sta = registerWrite8(i2c, addr, REG_PWR_MANAGEMENT_2, reg);
+  }
+
+  return sta == i2cTransferDone;
+}
+
 bool mpu6500_InterruptAcknowledge(I2C_TypeDef *i2c, uint8_t addr)
 {
   I2C_TransferReturn_TypeDef sta;
@@ -484,6 +807,8 @@ bool mpu6500_ConfigureGyroRate(I2C_TypeDef *i2c, uint8_t addr, Mpu6500GyroFreq_t
     default:
       reg = REG_CONFIG_DLPF_CFG_250HZ;
   }
+  // Keep the FIFO mode, it shares the register with the filter setting
+  reg |= configFifoMode;
   sta = registerWrite8(i2c, addr, REG_CONFIG, reg);
   return sta == i2cTransferDone;
 }
@@ -569,18 +894,14 @@ bool mpu6500_Measure(I2C_TypeDef *i2c, uint8_t addr,
   *accY = BUFFER_TO_INT16(i2c_read_data, 2);
   *accZ = BUFFER_TO_INT16(i2c_read_data, 4);
   // Test for range error
-  *accRangeError = (abs(*accX >= ERROR_LEVEL_ACC_REG)
-                    || (abs(*accY) >= ERROR_LEVEL_ACC_REG)
-                    || (abs(*accZ) >= ERROR_LEVEL_ACC_REG));
+  rangeErrorTest(*accX, *accY, *accZ, accRangeError);
 
   // Get gyrometer stuff
   *gyrX = BUFFER_TO_INT16(i2c_read_data, 8);
   *gyrY = BUFFER_TO_INT16(i2c_read_data, 10);
   *gyrZ = BUFFER_TO_INT16(i2c_read_data, 12);
   // Test for range error
-  *gyrRangeError = (abs(*gyrX >= ERROR_LEVEL_ACC_REG)
-                    || (abs(*gyrY) >= ERROR_LEVEL_ACC_REG)
-                    || (abs(*gyrZ) >= ERROR_LEVEL_ACC_REG));
+  rangeErrorTest(*gyrX, *gyrY, *gyrZ, gyrRangeError);
 
   gyroCalibrateStep(i2c, addr, *gyrX, *gyrY, *gyrZ);
 
@@ -593,6 +914,80 @@ bool mpu6500_Measure(I2C_TypeDef *i2c, uint8_t addr,
   return true;
 }
 
+bool mpu6500_RangeError(const int16_t *xyz)
+{
+  bool rangeError;
+
+  rangeErrorTest(xyz[0], xyz[1], xyz[2], &rangeError);
+  return rangeError;
+}
+
+bool mpu6500_FifoRead(I2C_TypeDef *i2c, uint8_t addr,
+                      Mpu6500Sample_t *samples, uint16_t maxCount, uint16_t *count)
+{
+  I2C_TransferSeq_TypeDef    seq;
+  I2C_TransferReturn_TypeDef ret;
+  uint8_t                    i2c_write_data[1];
+  uint8_t                    *data;
+  uint16_t                   fifoCount;
+  uint16_t                   n;
+
+  *count = 0;
+
+  ret = registerRead16(i2c, addr, REG_FIFO_COUNT, &fifoCount);
+  if (ret != i2cTransferDone) {
+    return false;
+  }
+
+  n = fifoCount / FIFO_SAMPLE_SIZE;
+  if (n > maxCount) {
+    n = maxCount;
+  }
+
+  if (n) {
+    seq.addr  = addr;
+    seq.flags = I2C_FLAG_WRITE_READ;
+    // Select command to issue
+    i2c_write_data[0] = REG_FIFO_R_W;
+    seq.buf[0].data   = i2c_write_data;
+    seq.buf[0].len    = 1;
+    // Burst read straight into the sample buffer, the byte order is fixed below
+    seq.buf[1].data = (uint8_t *)samples;
+    seq.buf[1].len  = n * FIFO_SAMPLE_SIZE;
+
+    ret = I2CSPM_Transfer(i2c, &seq);
+    if (ret != i2cTransferDone) {
+      return false;
+    }
+
+    for (uint16_t i = 0; i < n; i++) {
+      data = (uint8_t *)&samples[i];
+      for (uint8_t j = 0; j < 3; j++) {
+        samples[i].acc[j] = BUFFER_TO_INT16(data, j * 2);
+      }
+      for (uint8_t j = 0; j < 3; j++) {
+        samples[i].gyr[j] = BUFFER_TO_INT16(data, 6 + j * 2);
+      }
+
+      gyroCalibrateStep(i2c, addr, samples[i].gyr[0], samples[i].gyr[1], samples[i].gyr[2]);
+    }
+  }
+  *count = n;
+
+  // A full FIFO has stopped accepting samples and may hold a partial one,
+  // flush what is left to get back in sync
+  if (fifoCount >= (FIFO_SIZE - FIFO_SAMPLE_SIZE + 1)) {
+    registerWrite8(i2c, addr, REG_USER_CTRL, REG_USER_CTRL_FIFO_EN | REG_USER_CTRL_FIFO_RST);
+  }
+
+  return true;
+}
+
+uint32_t mpu6500_ShadowSavedTransactions(void)
+{
+  return shadowSavedTransactions;
+}
+
 void mpu6500_GyroCalibrateBegin(uint32_t cnt)
 {
   gyroCalibrateBegin(cnt);
@@ -609,3 +1004,184 @@ void mpu6500_GyroCalibrateReset(I2C_TypeDef *i2c, uint8_t addr)
   registerWrite16(i2c, addr, REG_YG_OFFSET, 0);
   registerWrite16(i2c, addr, REG_ZG_OFFSET, 0);
 }
+
+bool mpu6500_GyroOffsetGet(I2C_TypeDef *i2c, uint8_t addr, int16_t offset[3])
+{
+  I2C_TransferReturn_TypeDef sta;
+  uint16_t reg;
+
+  sta = registerRead16(i2c, addr, REG_XG_OFFSET, &reg);
+  offset[0] = (int16_t)reg;
+  if (sta == i2cTransferDone) {
+    sta = registerRead16(i2c, addr, REG_YG_OFFSET, &reg);
+    offset[1] = (int16_t)reg;
+  }
+  if (sta == i2cTransferDone) {
+    sta = registerRead16(i2c, addr, REG_ZG_OFFSET, &reg);
+    offset[2] = (int16_t)reg;
+  }
+  return sta == i2cTransferDone;
+}
+
+bool mpu6500_GyroOffsetSet(I2C_TypeDef *i2c, uint8_t addr, const int16_t offset[3])
+{
+  I2C_TransferReturn_TypeDef sta;
+
+  sta = registerWrite16(i2c, addr, REG_XG_OFFSET, (uint16_t)offset[0]);
+  if (sta == i2cTransferDone) {
+    sta = registerWrite16(i2c, addr, REG_YG_OFFSET, (uint16_t)offset[1]);
+  }
+  if (sta == i2cTransferDone) {
+    sta = registerWrite16(i2c, addr, REG_ZG_OFFSET, (uint16_t)offset[2]);
+  }
+  if (sta == i2cTransferDone) {
+    gyrOfsX = offset[0];
+    gyrOfsY = offset[1];
+    gyrOfsZ = offset[2];
+  }
+  return sta == i2cTransferDone;
+}
+
+bool mpu6500_TemperatureRead(I2C_TypeDef *i2c, uint8_t addr, int16_t *temperature)
+{
+  I2C_TransferReturn_TypeDef sta;
+  uint16_t reg;
+
+  sta = registerRead16(i2c, addr, REG_TEMP_OUT, &reg);
+  if (sta != i2cTransferDone) {
+    return false;
+  }
+  *temperature = (int16_t)((int32_t)(int16_t)reg * 10000 / TEMP_SENSITIVITY_X10000 + TEMP_OFFSET);
+  return true;
+}
+
+bool mpu6500_DmpLoad(I2C_TypeDef *i2c, uint8_t addr)
+{
+#if MPU6500_DMP_FIRMWARE_AVAILABLE
+  uint8_t reg;
+  bool loaded;
+
+  // The memory can't be written while the chip sleeps
+  chipEnable(i2c, addr, true);
+
+  // Not shadowed registers, so straight to the chip
+  loaded = dmpMemWrite(i2c, addr, 0, MPU6500_DMP_IMAGE, sizeof(MPU6500_DMP_IMAGE))
+           && (busWrite8(i2c, addr, REG_PRGM_START_H, MPU6500_DMP_START_ADDR >> 8) == i2cTransferDone)
+           && (busWrite8(i2c, addr, REG_PRGM_START_H + 1, MPU6500_DMP_START_ADDR & 0xff) == i2cTransferDone)
+           && (busRead8(i2c, addr, REG_PRGM_START_H + 1, &reg) == i2cTransferDone)
+           && (reg == (MPU6500_DMP_START_ADDR & 0xff));
+
+  chipEnable(i2c, addr, accEnable || gyrEnable);
+  return loaded;
+#else
+  return false;
+#endif
+}
+
+bool mpu6500_ConfigureDmp(I2C_TypeDef *i2c, uint8_t addr, bool on, int16_t freq)
+{
+#if MPU6500_DMP_FIRMWARE_AVAILABLE
+  I2C_TransferReturn_TypeDef sta;
+  uint8_t reg;
+  uint8_t rate[2];
+  uint16_t div;
+
+  // Stop the DMP and the FIFO before changing anything
+  registerWrite8(i2c, addr, REG_FIFO_EN, REG_FIFO_EN_DISABLE);
+  registerWrite8(i2c, addr, REG_USER_CTRL, REG_USER_CTRL_FIFO_RST | REG_USER_CTRL_DMP_RST);
+
+  configFifoMode = on ? REG_CONFIG_FIFO_MODE_NO_OVERWRITE : 0;
+  sta = registerRead8(i2c, addr, REG_CONFIG, &reg);
+  reg &= ~REG_CONFIG_FIFO_MODE_NO_OVERWRITE;
+  reg |= configFifoMode;
+  sta = registerWrite8(i2c, addr, REG_CONFIG, reg);
+
+  if (!on) {
+    sta = registerWrite8(i2c, addr, REG_INT_ENABLE, REG_INT_ENABLE_DISABLE);
+    sta = registerWrite8(i2c, addr, REG_USER_CTRL, 0);
+    return sta == i2cTransferDone;
+  }
+
+  for (uint8_t i = 0; i < sizeof(MPU6500_DMP_QUAT_CONFIG) / sizeof(MPU6500_DMP_QUAT_CONFIG[0]); i++) {
+    if (!dmpMemWrite(i2c, addr, MPU6500_DMP_QUAT_CONFIG[i].addr,
+                     MPU6500_DMP_QUAT_CONFIG[i].data, MPU6500_DMP_QUAT_CONFIG[i].len)) {
+      return false;
+    }
+  }
+  div = (freq < DMP_SAMPLE_FREQ) ? (DMP_SAMPLE_FREQ / freq) - 1 : 0;
+  rate[0] = div >> 8;
+  rate[1] = div & 0xff;
+  if (!dmpMemWrite(i2c, addr, MPU6500_DMP_FIFO_RATE_ADDR, rate, sizeof(rate))) {
+    return false;
+  }
+
+  // The DMP writes the FIFO itself, FIFO_EN stays off
+  sta = registerWrite8(i2c, addr, REG_SMPLRT_DIV, (1000 / DMP_SAMPLE_FREQ) - 1);
+  sta = registerWrite8(i2c, addr, REG_INT_PIN_CFG, REG_INT_PIN_CFG_ACTL);
+  sta = registerWrite8(i2c, addr, REG_INT_ENABLE, REG_INT_ENABLE_FIFO_OFLOW_EN);
+  sta = registerWrite8(i2c, addr, REG_USER_CTRL, REG_USER_CTRL_DMP_EN | REG_USER_CTRL_FIFO_EN);
+
+  return sta == i2cTransferDone;
+#else
+  return false;
+#endif
+}
+
+bool mpu6500_DmpQuatRead(I2C_TypeDef *i2c, uint8_t addr,
+                         Mpu6500Quat_t *quats, uint16_t maxCount, uint16_t *count)
+{
+  I2C_TransferSeq_TypeDef    seq;
+  I2C_TransferReturn_TypeDef ret;
+  uint8_t                    i2c_write_data[1];
+  uint16_t                   fifoCount;
+  uint16_t                   n;
+  bool                       desync = false;
+
+  *count = 0;
+
+  ret = registerRead16(i2c, addr, REG_FIFO_COUNT, &fifoCount);
+  if (ret != i2cTransferDone) {
+    return false;
+  }
+
+  n = fifoCount / DMP_QUAT_PACKET_SIZE;
+  if (n > maxCount) {
+    n = maxCount;
+  }
+
+  if (n) {
+    seq.addr  = addr;
+    seq.flags = I2C_FLAG_WRITE_READ;
+    // Select command to issue
+    i2c_write_data[0] = REG_FIFO_R_W;
+    seq.buf[0].data   = i2c_write_data;
+    seq.buf[0].len    = 1;
+    // Burst read straight into the quaternion buffer, the byte order is fixed below
+    seq.buf[1].data = (uint8_t *)quats;
+    seq.buf[1].len  = n * DMP_QUAT_PACKET_SIZE;
+
+    ret = I2CSPM_Transfer(i2c, &seq);
+    if (ret != i2cTransferDone) {
+      return false;
+    }
+
+    // A quaternion that isn't unit length means the FIFO is out of step,
+    // the rest of the burst is dropped
+    for (uint16_t i = 0; i < n; i++) {
+      dmpQuatParse((const uint8_t *)&quats[i], quats[i].q);
+      if (!dmpQuatValid(quats[i].q)) {
+        n = i;
+        desync = true;
+      }
+    }
+  }
+  *count = n;
+
+  // Same as for the samples, get back in sync after an overflow
+  if (desync || (fifoCount >= (FIFO_SIZE - DMP_QUAT_PACKET_SIZE + 1))) {
+    registerWrite8(i2c, addr, REG_USER_CTRL,
+                   REG_USER_CTRL_DMP_EN | REG_USER_CTRL_FIFO_EN | REG_USER_CTRL_FIFO_RST);
+  }
+
+  return true;
+}
@@ -58,6 +58,32 @@ extern "C" {
 /** I2C device address for mpu6500 */
 #define MPU6500_ADDR      0xd0
 
+/** Max number of accelerometer and gyrometer samples the FIFO can hold */
+#define MPU6500_FIFO_MAX_SAMPLES  42
+
+/** Set to 1 when mpu6500_dmp_firmware.h, with the InvenSense DMP image and its
+ *  configuration, is on the include path. The image is licensed separately and
+ *  not part of this project. Without it the DMP functions return false.
+ *
+ *  The header is included by mpu6500.c after Mpu6500DmpWrite_t is declared,
+ *  and provides:
+ *    MPU6500_DMP_IMAGE[]         const uint8_t, the image loaded from DMP
+ *                                address 0
+ *    MPU6500_DMP_START_ADDR      The program start address
+ *    MPU6500_DMP_FIFO_RATE_ADDR  The FIFO rate divider, a big endian uint16
+ *    MPU6500_DMP_QUAT_CONFIG[]   const Mpu6500DmpWrite_t, the memory writes
+ *                                that make the 6-axis quaternion the only FIFO
+ *                                output, for +-16 g and +-2000 deg/s full scale
+ *
+ *  The unit test build uses the placeholder in utest/stubs, which lets the DMP
+ *  path build but would not run on a sensor. */
+#ifndef MPU6500_DMP_FIRMWARE_AVAILABLE
+#define MPU6500_DMP_FIRMWARE_AVAILABLE  0
+#endif
+
+/** Max number of DMP quaternions the FIFO can hold */
+#define MPU6500_DMP_MAX_QUATS     32
+
 typedef enum {
   mpu6500AccelFreq_460Hz,
   mpu6500AccelFreq_184Hz,
@@ -93,6 +119,33 @@ typedef enum {
   mpu6500GyroScale_2000
 } Mpu6500GyroScale_t;
 
+/** Accelerometer sample rate in low-power cycled mode */
+typedef enum {
+  mpu6500LpAccelFreq_0_24Hz,
+  mpu6500LpAccelFreq_0_49Hz,
+  mpu6500LpAccelFreq_0_98Hz,
+  mpu6500LpAccelFreq_1_95Hz,
+  mpu6500LpAccelFreq_3_91Hz,
+  mpu6500LpAccelFreq_7_81Hz,
+  mpu6500LpAccelFreq_15_63Hz,
+  mpu6500LpAccelFreq_31_25Hz,
+  mpu6500LpAccelFreq_62_50Hz,
+  mpu6500LpAccelFreq_125Hz,
+  mpu6500LpAccelFreq_250Hz,
+  mpu6500LpAccelFreq_500Hz,
+} Mpu6500LpAccelFreq_t;
+
+/** Raw accelerometer and gyrometer sample as stored in the FIFO */
+typedef struct {
+  int16_t acc[3];
+  int16_t gyr[3];
+} Mpu6500Sample_t;
+
+/** DMP quaternion w, x, y, z in Q30, rotating the sensor axes to the world axes */
+typedef struct {
+  int32_t q[4];
+} Mpu6500Quat_t;
+
 /***************************************************************************************************
  *****************************   PROTOTYPES   ******************************************************
  **************************************************************************************************/
@@ -138,6 +191,50 @@ bool mpu6500_Detect(I2C_TypeDef *i2c, uint8_t addr);
  *************************************************************************************************/
 bool mpu6500_ConfigureInterrupt(I2C_TypeDef *i2c, uint8_t addr, bool on, int16_t freq);
 
+/**********************************************************************************************//**
+ * @brief
+ *   Configure FIFO batch mode. Accelerometer and gyrometer samples are queued
+ *   in the FIFO at the given frequency and the interrupt is only raised if the
+ *   FIFO overflows. The FIFO must be drained with mpu6500_FifoRead() before it
+ *   holds MPU6500_FIFO_MAX_SAMPLES samples.
+ * @param[in] i2c
+ *   The I2C peripheral to use.
+ * @param[in] addr
+ *   The I2C address to use.
+ * @param[in] on
+ *   True if the FIFO shall be turned on.
+ * @param[in] freq
+ *   The sample frequency. Note that the actual frequency is determined by
+ *   the sample rate of 1 kHz and a divider.
+ * @return
+ *   True if a mpu6500 is present, false otherwise.
+ *************************************************************************************************/
+bool mpu6500_ConfigureFifo(I2C_TypeDef *i2c, uint8_t addr, bool on, int16_t freq);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Configure wake-on-motion. When on, the gyrometers are turned off and the
+ *   accelerometer is cycled in low-power mode at the given rate. The interrupt
+ *   is raised when the acceleration on any axis changes by more than the
+ *   threshold since the previous sample. When off, the sensors are put back in
+ *   the state set by mpu6500_ConfigureAccelEnable() and
+ *   mpu6500_ConfigureGyroEnable(), with interrupts disabled.
+ * @param[in] i2c
+ *   The I2C peripheral to use.
+ * @param[in] addr
+ *   The I2C address to use.
+ * @param[in] on
+ *   True if wake-on-motion shall be turned on.
+ * @param[in] thresholdMg
+ *   The motion threshold in mg, with a resolution of 4 mg and a max of 1020 mg.
+ * @param[in] rate
+ *   The accelerometer sample rate while waiting for motion.
+ * @return
+ *   True if a mpu6500 is present, false otherwise.
+ *************************************************************************************************/
+bool mpu6500_ConfigureWakeOnMotion(I2C_TypeDef *i2c, uint8_t addr, bool on,
+                                   uint16_t thresholdMg, Mpu6500LpAccelFreq_t rate);
+
 /**********************************************************************************************//**
  * @brief
  *   Acknowledge the mpu6500 interrupt. This will turn off the current interrupt
@@ -255,6 +352,15 @@ bool mpu6500_ConfigureGyroScale(I2C_TypeDef *i2c, uint8_t addr, Mpu6500GyroScale
  *************************************************************************************************/
 int32_t mpu6500_GyroRegToAngle(int16_t reg);
 
+/**********************************************************************************************//**
+ * @brief
+ *   Get the number of I2C transactions saved by the register shadow, i.e.
+ *   configuration reads served from the shadow and writes of unchanged values.
+ * @return
+ *   The number of saved transactions since boot.
+ *************************************************************************************************/
+uint32_t mpu6500_ShadowSavedTransactions(void);
+
 /**********************************************************************************************//**
  * @brief
  *   Start a gyrometer calibration.
@@ -286,6 +392,48 @@ bool mpu6500_GyroCalibrateInProgress(void);
  *************************************************************************************************/
 void mpu6500_GyroCalibrateReset(I2C_TypeDef *i2c, uint8_t addr);
 
+/**********************************************************************************************//**
+ * @brief
+ *   Get the gyrometer offsets, i.e. the calibration result.
+ * @param[in] i2c
+ *   The I2C peripheral to use.
+ * @param[in] addr
+ *   The I2C address to use.
+ * @param[out] offset
+ *   The raw offset register values for the X, Y and Z-axis.
+ * @return
+ *   Returns true if the offsets were read else false.
+ *************************************************************************************************/
+bool mpu6500_GyroOffsetGet(I2C_TypeDef *i2c, uint8_t addr, int16_t offset[3]);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Set the gyrometer offsets, e.g. to restore a saved calibration.
+ * @param[in] i2c
+ *   The I2C peripheral to use.
+ * @param[in] addr
+ *   The I2C address to use.
+ * @param[in] offset
+ *   The raw offset register values for the X, Y and Z-axis.
+ * @return
+ *   Returns true if the offsets were written else false.
+ *************************************************************************************************/
+bool mpu6500_GyroOffsetSet(I2C_TypeDef *i2c, uint8_t addr, const int16_t offset[3]);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Read the die temperature. Only updated while the sensors are enabled.
+ * @param[in] i2c
+ *   The I2C peripheral to use.
+ * @param[in] addr
+ *   The I2C address to use.
+ * @param[out] temperature
+ *   The temperature in 0.01 degrees Celsius.
+ * @return
+ *   Returns true if the temperature was read else false.
+ *************************************************************************************************/
+bool mpu6500_TemperatureRead(I2C_TypeDef *i2c, uint8_t addr, int16_t *temperature);
+
 /**********************************************************************************************//**
  * @brief
  *  Read the accelerometors and gyrometers.
@@ -321,6 +469,91 @@ bool mpu6500_Measure(I2C_TypeDef *i2c, uint8_t addr,
                      bool *gyrRangeError,
                      bool wait);
 
+/**********************************************************************************************//**
+ * @brief
+ *  Test one sample of a sensor for a range error.
+ * @param[in] xyz
+ *   The raw X, Y and Z values.
+ * @return
+ *   True if any of the axes reached max value.
+ *************************************************************************************************/
+bool mpu6500_RangeError(const int16_t *xyz);
+
+/**********************************************************************************************//**
+ * @brief
+ *  Read all queued accelerometer and gyrometer samples from the FIFO in one
+ *  burst. The samples are not tested for range errors, see
+ *  mpu6500_RangeError().
+ * @param[in] i2c
+ *   The I2C peripheral to use.
+ * @param[in] addr
+ *   The I2C address to use.
+ * @param[out] samples
+ *   The raw samples, oldest first.
+ * @param[in] maxCount
+ *   The max number of samples to read.
+ * @param[out] count
+ *   The number of samples read.
+ * @return
+ *   Returns true if the FIFO was read else false.
+ *************************************************************************************************/
+bool mpu6500_FifoRead(I2C_TypeDef *i2c, uint8_t addr,
+                      Mpu6500Sample_t *samples, uint16_t maxCount, uint16_t *count);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Load the DMP image into the motion processor memory and set its start
+ *   address. The memory survives sleep, but not a reset or power cycle.
+ * @param[in] i2c
+ *   The I2C peripheral to use.
+ * @param[in] addr
+ *   The I2C address to use.
+ * @return
+ *   True if the image was loaded and verified, false otherwise or if there is
+ *   no image.
+ *************************************************************************************************/
+bool mpu6500_DmpLoad(I2C_TypeDef *i2c, uint8_t addr);
+
+/**********************************************************************************************//**
+ * @brief
+ *   Configure DMP mode. The motion processor fuses the accelerometers and
+ *   gyrometers on its own, and queues quaternions in the FIFO at the given
+ *   frequency. The interrupt is only raised if the FIFO overflows, so it must
+ *   be drained with mpu6500_DmpQuatRead() before it holds
+ *   MPU6500_DMP_MAX_QUATS quaternions. Replaces mpu6500_ConfigureFifo().
+ * @param[in] i2c
+ *   The I2C peripheral to use.
+ * @param[in] addr
+ *   The I2C address to use.
+ * @param[in] on
+ *   True if the DMP shall be turned on.
+ * @param[in] freq
+ *   The quaternion frequency. Note that the actual frequency is determined by
+ *   the DMP sample rate of 200 Hz and a divider.
+ * @return
+ *   True if the DMP was configured, false otherwise or if there is no image.
+ *************************************************************************************************/
+bool mpu6500_ConfigureDmp(I2C_TypeDef *i2c, uint8_t addr, bool on, int16_t freq);
+
+/**********************************************************************************************//**
+ * @brief
+ *  Read all queued DMP quaternions from the FIFO in one burst.
+ * @param[in] i2c
+ *   The I2C peripheral to use.
+ * @param[in] addr
+ *   The I2C address to use.
+ * @param[out] quats
+ *   The quaternions, oldest first.
+ * @param[in] maxCount
+ *   The max number of quaternions to read.
+ * @param[out] count
+ *   The number of quaternions read.
+ * @return
+ *   Returns true if the FIFO was read else false.
+ *************************************************************************************************/
+bool mpu6500_DmpQuatRead(I2C_TypeDef *i2c, uint8_t addr,
+                         Mpu6500Quat_t *quats, uint16_t maxCount, uint16_t *count);
+
 #ifdef __cplusplus
 }
 #endif
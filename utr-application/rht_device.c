@@ -20,6 +20,10 @@
 #include <stdlib.h>
 #include "rd0057.h"
 #include "si7013.h"
+#include "em_rtcc.h"
+#include "native_gecko.h"
+#include "app_timer.h"
+#include <stddef.h>
 
 /***********************************************************************************************//**
  * @addtogroup app_hardware
@@ -35,6 +39,20 @@
  * Local Macros and Definitions
  **************************************************************************************************/
 
+// The humidity and the temperature come from one conversion, the temperature
+// is read back from the humidity measurement. Reads within the freshness
+// window get the same pair, so reading both characteristics converts once.
+#define RHT_FRESH_MS            1000
+#define RTCC_FREQ               32768
+
+// The no-hold conversion is read back once the soft timer expires instead of
+// clock-stretching the bus. A 12-bit humidity conversion is 12 ms and the
+// temperature conversion within it another 10.8 ms, at the datasheet maximum.
+// The sensor NACKs a read while still converting, so the read is retried.
+#define RHT_CONVERSION_MS       25
+#define RHT_RETRY_MS            5
+#define RHT_READ_RETRIES        2
+
 /***************************************************************************************************
  * Local Type Definitions
  **************************************************************************************************/
@@ -44,10 +62,74 @@
  **************************************************************************************************/
 
 static bool si7013Detected = false;
+static bool rhtFresh = false;
+static uint32_t rhtTime;
+static uint32_t rhtRhData;
+static int32_t rhtTempData;
+static bool rhtInProgress = false;
+static uint8_t rhtRetries;
+static void (*humidityMeasurementDoneCallback)(uint16_t) = NULL;
+static void (*temperatureMeasurementDoneCallback)(int16_t) = NULL;
 
 /***************************************************************************************************
  * Local Function Definitions
  **************************************************************************************************/
+static bool rhtCached(void)
+{
+  return rhtFresh
+         && ((RTCC_CounterGet() - rhtTime) < ((uint32_t)RHT_FRESH_MS * RTCC_FREQ / 1000));
+}
+
+static void rhtDone(uint32_t rhData, int32_t tempData)
+{
+  void (*humidityDone)(uint16_t) = humidityMeasurementDoneCallback;
+  void (*temperatureDone)(int16_t) = temperatureMeasurementDoneCallback;
+
+  humidityMeasurementDoneCallback = NULL;
+  temperatureMeasurementDoneCallback = NULL;
+
+  // Limit the value to 100%.
+  if (rhData > 100000) {
+    rhData = 100000;
+  }
+  if (humidityDone) {
+    humidityDone((uint16_t)(rhData / 10));
+  }
+  if (temperatureDone) {
+    temperatureDone((int16_t)(tempData / 10));
+  }
+}
+
+static void rhtMeasure(void)
+{
+  if (rhtCached()) {
+    rhtDone(rhtRhData, rhtTempData);
+    return;
+  }
+
+  // A conversion already under way serves both reads
+  if (rhtInProgress) {
+    return;
+  }
+
+  if (!si7013Detected
+      || (Si7013_StartNoHoldMeasureRHAndTemp(i2cInit.port, SI7021_ADDR) != 0)) {
+    rhtDone(0, 0);
+    return;
+  }
+
+  rhtInProgress = true;
+  rhtRetries = 0;
+  gecko_cmd_hardware_set_soft_timer(TIMER_MS_2_TIMERTICK(RHT_CONVERSION_MS), RHT_DEVICE_TIMER, true);
+}
+
+static void rhtStop(void)
+{
+  gecko_cmd_hardware_set_soft_timer(TIMER_STOP, RHT_DEVICE_TIMER, false);
+  rhtInProgress = false;
+  humidityMeasurementDoneCallback = NULL;
+  temperatureMeasurementDoneCallback = NULL;
+}
 
 /***************************************************************************************************
  * Public Function Definitions
@@ -69,7 +151,8 @@ uint8_t rhtDeviceTest(void)
 
 void rhtDeviceSleep(void)
 {
-  // Nothing
+  rhtStop();
+  rhtFresh = false;
 }
 
 void rhtDeviceConnectionOpened(void)
@@ -79,35 +162,47 @@ void rhtDeviceConnectionOpened(void)
 
 void rhtDeviceConnectionClosed(void)
 {
-  // nothing to do
+  // The reads are for the connection
+  rhtStop();
 }
 
 void rhtDeviceHumidityMeasure(void (*humidityMeasurementDone)(uint16_t))
 {
-  uint32_t      rhData = 0;
-  int32_t       tempData = 0;
-
-  if ( si7013Detected) {
-    Si7013_MeasureRHAndTemp(i2cInit.port, SI7021_ADDR, &rhData, &tempData);
-  }
-  // Limit the value to 100%.
-  if (rhData > 100000) {
-    rhData = 100000;
-  }
-  rhData /= 10;
-  humidityMeasurementDone((uint16_t)rhData);
+  humidityMeasurementDoneCallback = humidityMeasurementDone;
+  rhtMeasure();
 }
 
 void rhtDeviceTemperatureMeasure(void (*temperatureMeasurementDone)(int16_t))
+{
+  temperatureMeasurementDoneCallback = temperatureMeasurementDone;
+  rhtMeasure();
+}
+
+void rhtDeviceTimerEvtHandler(void)
 {
   uint32_t      rhData = 0;
   int32_t       tempData = 0;
 
-  if ( si7013Detected) {
-    Si7013_MeasureRHAndTemp(i2cInit.port, SI7021_ADDR, &rhData, &tempData);
+  if (!rhtInProgress) {
+    return;
+  }
+
+  rhtFresh = (Si7013_ReadNoHoldRHAndTemp(i2cInit.port, SI7021_ADDR, &rhData, &tempData) == 0);
+  if (!rhtFresh && (rhtRetries++ < RHT_READ_RETRIES)) {
+    gecko_cmd_hardware_set_soft_timer(TIMER_MS_2_TIMERTICK(RHT_RETRY_MS), RHT_DEVICE_TIMER, true);
+    return;
+  }
+
+  rhtInProgress = false;
+  if (rhtFresh) {
+    rhtTime = RTCC_CounterGet();
+    rhtRhData = rhData;
+    rhtTempData = tempData;
+  } else {
+    rhData = 0;
+    tempData = 0;
   }
-  tempData /= 10;
-  temperatureMeasurementDone((int16_t)tempData);
+  rhtDone(rhData, tempData);
 }
 
 /** @} (end addtogroup rht-sensor) */
@@ -63,6 +63,8 @@ void rhtDeviceHumidityMeasure(void (*humidityMeasurementDone)(uint16_t));
 
 void rhtDeviceTemperatureMeasure(void (*temperatureMeasurementDone)(int16_t));
 
+void rhtDeviceTimerEvtHandler(void);
+
 /** @} (end addtogroup rht-sensor) */
 /** @} (end addtogroup app_hardware) */
 
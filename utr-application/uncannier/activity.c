@@ -0,0 +1,250 @@
+///-----------------------------------------------------------------------------
+///
+/// @file activity.c
+///
+/// @brief Activity classifier
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include "activity.h"
+
+typedef enum
+{
+    activityFeatureMean,
+    activityFeatureDeviation,
+    activityFeatureEnergy,
+    activityFeatureCrossings,
+} ActivityFeature_t;
+
+// Goes to the below child if the feature is at most the threshold, otherwise
+// to the above child. Children with ACTIVITY_TREE_LEAF set are activities.
+typedef struct
+{
+    uint8_t feature;
+    uint16_t threshold;
+    uint8_t below;
+    uint8_t above;
+} ActivityTreeNode_t;
+
+#define ACTIVITY_TREE_LEAF          0x80
+
+static const ActivityTreeNode_t activityTree[] =
+{
+    // 0: Barely moving
+    { activityFeatureDeviation, 12, ACTIVITY_TREE_LEAF | ACTIVITY_IDLE, 1 },
+    // 1: Small movements, handling is slow but engines and roads rattle
+    { activityFeatureDeviation, 60, 2, 3 },
+    { activityFeatureCrossings, 80, ACTIVITY_TREE_LEAF | ACTIVITY_IDLE, ACTIVITY_TREE_LEAF | ACTIVITY_VEHICLE },
+    // 3: Nobody walks that hard
+    { activityFeatureDeviation, 600, 4, ACTIVITY_TREE_LEAF | ACTIVITY_SHAKE },
+    // 4: Steps are up to about 3.5 Hz
+    { activityFeatureCrossings, 70, ACTIVITY_TREE_LEAF | ACTIVITY_WALK, 5 },
+    // 5: Rough roads or shaking, a shake is jerkier
+    { activityFeatureEnergy, 200, ACTIVITY_TREE_LEAF | ACTIVITY_VEHICLE, ACTIVITY_TREE_LEAF | ACTIVITY_SHAKE },
+};
+
+static uint32_t squareRoot( uint32_t square )
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while( bit > square )
+    {
+        bit >>= 2;
+    }
+    while( bit )
+    {
+        if( square >= root + bit )
+        {
+            square -= root + bit;
+            root = ( root >> 1 ) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+static uint16_t saturate( uint32_t value )
+{
+    return ( value > UINT16_MAX ) ? UINT16_MAX : (uint16_t)value;
+}
+
+static uint16_t featureGet( const ActivityFeatures_t *features, uint8_t feature )
+{
+    switch( feature )
+    {
+        case activityFeatureMean:
+            return features->mean;
+        case activityFeatureDeviation:
+            return features->deviation;
+        case activityFeatureEnergy:
+            return features->energy;
+        default:
+            return features->crossings;
+    }
+}
+
+static void windowStart( ActivityClassifier_t *ac )
+{
+    ac->sum = 0;
+    ac->diffSumSq = 0;
+    ac->count = 0;
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        ac->sumSq[i] = 0;
+        ac->crossingCnt[i] = 0;
+    }
+}
+
+static void windowEnd( ActivityClassifier_t *ac )
+{
+    uint64_t sumSq = 0;
+    uint8_t dominant = 0;
+
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        sumSq += ac->sumSq[i];
+        if( ac->sumSq[i] > ac->sumSq[dominant] )
+        {
+            dominant = i;
+        }
+    }
+    ac->features.mean = saturate( ac->sum / ac->count );
+    ac->features.deviation = saturate( squareRoot( (uint32_t)( sumSq / ac->count ) ) );
+    ac->features.energy = saturate( squareRoot( (uint32_t)( ac->diffSumSq / ac->count ) ) );
+    ac->features.crossings = saturate( (uint32_t)ac->crossingCnt[dominant] * ACTIVITY_FREQ * 10 / ac->count );
+}
+
+static void crossingUpdate( ActivityClassifier_t *ac, uint8_t axis, int32_t dyn )
+{
+    if( ( dyn > ACTIVITY_CROSSING_HYSTERESIS_MG ) && ( ac->side[axis] <= 0 ) )
+    {
+        ac->crossingCnt[axis] += ( ac->side[axis] < 0 );
+        ac->side[axis] = 1;
+    }
+    else if( ( dyn < -ACTIVITY_CROSSING_HYSTERESIS_MG ) && ( ac->side[axis] >= 0 ) )
+    {
+        ac->crossingCnt[axis] += ( ac->side[axis] > 0 );
+        ac->side[axis] = -1;
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Reset the classifier, back to an unknown activity
+///
+///-----------------------------------------------------------------------------
+void activityReset( ActivityClassifier_t *ac )
+{
+    ac->lowpassValid = false;
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        ac->previous[i] = 0;
+        ac->side[i] = 0;
+    }
+    ac->activity = ACTIVITY_UNKNOWN;
+    ac->candidate = ACTIVITY_UNKNOWN;
+    ac->candidateCnt = 0;
+    ac->features.mean = 0;
+    ac->features.deviation = 0;
+    ac->features.energy = 0;
+    ac->features.crossings = 0;
+    windowStart( ac );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Add a sample, at ACTIVITY_FREQ
+///
+/// @param[in]  acc - Accelerations in mg
+///
+/// @return True if the activity changed
+///
+///-----------------------------------------------------------------------------
+bool activityUpdate( ActivityClassifier_t *ac, const int32_t acc[3] )
+{
+    uint8_t next;
+
+    if( !ac->lowpassValid )
+    {
+        for( uint8_t i = 0; i < 3; i++ )
+        {
+            ac->lowpass[i] = acc[i] << ACTIVITY_LOWPASS_SHIFT;
+        }
+        ac->lowpassValid = true;
+    }
+
+    ac->sum += squareRoot( (uint32_t)( acc[0] * acc[0] ) + (uint32_t)( acc[1] * acc[1] )
+                           + (uint32_t)( acc[2] * acc[2] ) );
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        int32_t dyn;
+        int32_t diff;
+
+        ac->lowpass[i] += acc[i] - ( ac->lowpass[i] >> ACTIVITY_LOWPASS_SHIFT );
+        dyn = acc[i] - ( ac->lowpass[i] >> ACTIVITY_LOWPASS_SHIFT );
+        diff = dyn - ac->previous[i];
+        ac->previous[i] = dyn;
+
+        ac->sumSq[i] += (uint64_t)( (int64_t)dyn * dyn );
+        ac->diffSumSq += (uint64_t)( (int64_t)diff * diff );
+        crossingUpdate( ac, i, dyn );
+    }
+
+    if( ++ac->count < ACTIVITY_WINDOW_SAMPLES )
+    {
+        return false;
+    }
+    windowEnd( ac );
+    windowStart( ac );
+
+    next = activityClassify( &ac->features );
+    if( next != ac->candidate )
+    {
+        ac->candidate = next;
+        ac->candidateCnt = 0;
+    }
+    if( ac->candidateCnt < UINT8_MAX )
+    {
+        ac->candidateCnt++;
+    }
+    if( ( next != ac->activity )
+        && ( ( ac->candidateCnt >= ACTIVITY_CONFIRM_WINDOWS ) || ( ac->activity == ACTIVITY_UNKNOWN ) ) )
+    {
+        ac->activity = next;
+        return true;
+    }
+    return false;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Walk the decision tree
+///
+/// @param[in]  features - Features of a window
+///
+/// @return Activity
+///
+///-----------------------------------------------------------------------------
+uint8_t activityClassify( const ActivityFeatures_t *features )
+{
+    uint8_t node = 0;
+
+    while( node < sizeof( activityTree ) / sizeof( activityTree[0] ) )
+    {
+        const ActivityTreeNode_t *n = &activityTree[node];
+
+        node = ( featureGet( features, n->feature ) <= n->threshold ) ? n->below : n->above;
+        if( node & ACTIVITY_TREE_LEAF )
+        {
+            return node & ~ACTIVITY_TREE_LEAF;
+        }
+    }
+    return ACTIVITY_UNKNOWN;
+}
@@ -0,0 +1,94 @@
+///-----------------------------------------------------------------------------
+///
+/// @file activity.h
+///
+/// @brief Activity classifier
+///
+/// Splits the accelerometer samples into windows and sums each up as features.
+/// The slowly varying part of each axis, which holds gravity, is removed by a
+/// low pass filter first, leaving the movement in any direction:
+///
+///   mean        Mean magnitude of the acceleration in mg
+///   deviation   Standard deviation of the movement in mg, the square root of
+///               the variance summed over the axes
+///   energy      RMS of the change of the movement between samples in mg,
+///               high for jerky movement
+///   crossings   Rate the axis with the most movement crosses its low pass,
+///               in 0.1 Hz, i.e. twice the dominant frequency
+///
+/// A decision tree in flash takes the features to an activity. A new
+/// activity has to be seen for ACTIVITY_CONFIRM_WINDOWS windows in a row
+/// before the classifier changes over to it.
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#ifndef UNCANNIER_ACTIVITY_H_
+#define UNCANNIER_ACTIVITY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Activities
+#define ACTIVITY_UNKNOWN            0x00    ///< Until the first window is done
+#define ACTIVITY_IDLE               0x01
+#define ACTIVITY_WALK               0x02
+#define ACTIVITY_VEHICLE            0x03
+#define ACTIVITY_SHAKE              0x04
+
+/// Sample rate in Hz, the caller decimates to it
+#define ACTIVITY_FREQ               25
+
+/// Window length in samples, about 2.5 s
+#define ACTIVITY_WINDOW_SAMPLES     64
+
+#define ACTIVITY_CONFIRM_WINDOWS    2
+
+/// Low pass filter moves 1/2^n of the way to each sample
+#define ACTIVITY_LOWPASS_SHIFT      5
+
+/// The magnitude has to get this far past the low pass, in mg, for a crossing
+#define ACTIVITY_CROSSING_HYSTERESIS_MG 10
+
+typedef struct
+{
+    uint16_t mean;
+    uint16_t deviation;
+    uint16_t energy;
+    uint16_t crossings;
+} ActivityFeatures_t;
+
+typedef struct
+{
+    // Low pass of each axis in mg << ACTIVITY_LOWPASS_SHIFT
+    int32_t lowpass[3];
+    bool lowpassValid;
+    int32_t previous[3];
+    int8_t side[3];
+
+    uint32_t sum;
+    uint64_t sumSq[3];
+    uint64_t diffSumSq;
+    uint16_t crossingCnt[3];
+    uint16_t count;
+
+    ActivityFeatures_t features;
+    uint8_t activity;
+    uint8_t candidate;
+    uint8_t candidateCnt;
+} ActivityClassifier_t;
+
+void activityReset( ActivityClassifier_t *ac );
+bool activityUpdate( ActivityClassifier_t *ac, const int32_t acc[3] );
+uint8_t activityClassify( const ActivityFeatures_t *features );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UNCANNIER_ACTIVITY_H_
@@ -0,0 +1,139 @@
+///-----------------------------------------------------------------------------
+///
+/// @file dmp_quat.c
+///
+/// @brief MPU-6500 DMP quaternion packets
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdlib.h>
+#include "dmp_quat.h"
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Parse a FIFO packet. Each value is read before it is written, so
+///         the packet may be parsed in place.
+///
+/// @param[in]  packet - DMP_QUAT_PACKET_SIZE bytes from the FIFO
+/// @param[out] q - Quaternion w, x, y, z in Q30
+///
+///-----------------------------------------------------------------------------
+void dmpQuatParse( const uint8_t *packet, int32_t q[4] )
+{
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        const uint8_t *b = &packet[4 * i];
+        uint32_t value = ( (uint32_t)b[0] << 24 ) | ( (uint32_t)b[1] << 16 ) | ( (uint32_t)b[2] << 8 ) | b[3];
+
+        q[i] = (int32_t)value;
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Check a parsed quaternion is close to unit length
+///
+/// @param[in]  q - Quaternion in Q30
+///
+/// @return     True if it is, false if the FIFO is out of step
+///
+///-----------------------------------------------------------------------------
+bool dmpQuatValid( const int32_t q[4] )
+{
+    int64_t normSq = 0;
+    int64_t deviation;
+
+    // Q15 squared is Q30
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        int64_t q15 = q[i] >> 15;
+
+        normSq += q15 * q15;
+    }
+    deviation = normSq - DMP_QUAT_ONE;
+
+    return llabs( deviation ) <= ( DMP_QUAT_ONE >> DMP_QUAT_NORM_TOLERANCE_SHIFT );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Rotation matrix of a quaternion
+///
+/// @param[in]  q - Quaternion in Q30
+/// @param[out] r - The same rotation, r[i][j] the i component of axis j
+///
+///-----------------------------------------------------------------------------
+void dmpQuatToMatrix( const int32_t q[4], float r[3][3] )
+{
+    float w = (float)q[0] / DMP_QUAT_ONE;
+    float x = (float)q[1] / DMP_QUAT_ONE;
+    float y = (float)q[2] / DMP_QUAT_ONE;
+    float z = (float)q[3] / DMP_QUAT_ONE;
+
+    r[0][0] = 1.0f - 2.0f * ( y * y + z * z );
+    r[0][1] = 2.0f * ( x * y - w * z );
+    r[0][2] = 2.0f * ( x * z + w * y );
+    r[1][0] = 2.0f * ( x * y + w * z );
+    r[1][1] = 1.0f - 2.0f * ( x * x + z * z );
+    r[1][2] = 2.0f * ( y * z - w * x );
+    r[2][0] = 2.0f * ( x * z - w * y );
+    r[2][1] = 2.0f * ( w * x + y * z );
+    r[2][2] = 1.0f - 2.0f * ( x * x + y * y );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Unit quaternion of a rotation matrix, from the largest of its
+///         components for accuracy
+///
+/// @param[in]  m - Rotation matrix, as from dmpQuatToMatrix()
+/// @param[out] q - Quaternion w, x, y, z with w >= 0 when the trace is positive
+///
+///-----------------------------------------------------------------------------
+void dmpQuatFromMatrix( const float m[3][3], float q[4] )
+{
+    float s;
+    float norm;
+
+    if( m[0][0] + m[1][1] + m[2][2] > 0.0f )
+    {
+        s = 2.0f * sqrtf( 1.0f + m[0][0] + m[1][1] + m[2][2] );
+        q[0] = 0.25f * s;
+        q[1] = ( m[2][1] - m[1][2] ) / s;
+        q[2] = ( m[0][2] - m[2][0] ) / s;
+        q[3] = ( m[1][0] - m[0][1] ) / s;
+    }
+    else if( ( m[0][0] > m[1][1] ) && ( m[0][0] > m[2][2] ) )
+    {
+        s = 2.0f * sqrtf( 1.0f + m[0][0] - m[1][1] - m[2][2] );
+        q[0] = ( m[2][1] - m[1][2] ) / s;
+        q[1] = 0.25f * s;
+        q[2] = ( m[0][1] + m[1][0] ) / s;
+        q[3] = ( m[0][2] + m[2][0] ) / s;
+    }
+    else if( m[1][1] > m[2][2] )
+    {
+        s = 2.0f * sqrtf( 1.0f + m[1][1] - m[0][0] - m[2][2] );
+        q[0] = ( m[0][2] - m[2][0] ) / s;
+        q[1] = ( m[0][1] + m[1][0] ) / s;
+        q[2] = 0.25f * s;
+        q[3] = ( m[1][2] + m[2][1] ) / s;
+    }
+    else
+    {
+        s = 2.0f * sqrtf( 1.0f + m[2][2] - m[0][0] - m[1][1] );
+        q[0] = ( m[1][0] - m[0][1] ) / s;
+        q[1] = ( m[0][2] + m[2][0] ) / s;
+        q[2] = ( m[1][2] + m[2][1] ) / s;
+        q[3] = 0.25f * s;
+    }
+
+    norm = sqrtf( q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3] );
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        q[i] /= norm;
+    }
+}
@@ -0,0 +1,46 @@
+///-----------------------------------------------------------------------------
+///
+/// @file dmp_quat.h
+///
+/// @brief MPU-6500 DMP quaternion packets
+///
+/// The DMP puts its 6-axis orientation in the FIFO as 16 byte packets, the
+/// quaternion w, x, y, z as big endian Q30. A packet read out of step with
+/// the FIFO parses to a quaternion far from unit length, which is how a lost
+/// byte is noticed. The conversions to and from a rotation matrix let the DMP
+/// orientation seed the host fusion, which is in either form.
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#ifndef UNCANNIER_DMP_QUAT_H_
+#define UNCANNIER_DMP_QUAT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Size of a quaternion packet in the FIFO
+#define DMP_QUAT_PACKET_SIZE        16
+
+/// 1.0 in Q30
+#define DMP_QUAT_ONE                ( 1L << 30 )
+
+/// Max deviation of the squared norm from 1, as 1/2^n. The DMP keeps its
+/// quaternion within a fraction of a percent of unit length.
+#define DMP_QUAT_NORM_TOLERANCE_SHIFT   4
+
+void dmpQuatParse( const uint8_t *packet, int32_t q[4] );
+bool dmpQuatValid( const int32_t q[4] );
+void dmpQuatToMatrix( const int32_t q[4], float r[3][3] );
+void dmpQuatFromMatrix( const float m[3][3], float q[4] );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UNCANNIER_DMP_QUAT_H_
@@ -0,0 +1,82 @@
+///-----------------------------------------------------------------------------
+///
+/// @file fastmath.c
+///
+/// @brief Fast single precision trig approximations
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <math.h>
+#include "fastmath.h"
+
+#define FAST_PI                     3.14159265f
+#define FAST_PI_2                   1.57079633f
+
+// Odd minimax polynomial for atan() on [0,1], max error 1e-5 rad. Same
+// coefficients as the fixed-point engine.
+#define ATAN_C1                     0.9998660f
+#define ATAN_C3                     -0.3302995f
+#define ATAN_C5                     0.1801410f
+#define ATAN_C7                     -0.0851330f
+#define ATAN_C9                     0.0208351f
+
+static inline float atanUnit( float r )
+{
+    float r2 = r * r;
+
+    return r * ( ATAN_C1 + r2 * ( ATAN_C3 + r2 * ( ATAN_C5 + r2 * ( ATAN_C7 + r2 * ATAN_C9 ) ) ) );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Arc tangent of y/x in all four quadrants, 0 for (0,0)
+///
+///-----------------------------------------------------------------------------
+float fastAtan2f( float y, float x )
+{
+    float ax = fabsf( x );
+    float ay = fabsf( y );
+    float a;
+
+    if( ax == 0.0f && ay == 0.0f )
+    {
+        return 0.0f;
+    }
+
+    // Reduce to the first octant so the polynomial input is within [0,1]
+    if( ay <= ax )
+    {
+        a = atanUnit( ay / ax );
+    }
+    else
+    {
+        a = FAST_PI_2 - atanUnit( ax / ay );
+    }
+
+    if( x < 0.0f )
+    {
+        a = FAST_PI - a;
+    }
+    return ( y < 0.0f ) ? -a : a;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Arc sine, the input is clamped to [-1,1]
+///
+///-----------------------------------------------------------------------------
+float fastAsinf( float x )
+{
+    if( x > 1.0f )
+    {
+        x = 1.0f;
+    }
+    else if( x < -1.0f )
+    {
+        x = -1.0f;
+    }
+
+    return fastAtan2f( x, sqrtf( ( 1.0f - x ) * ( 1.0f + x ) ) );
+}
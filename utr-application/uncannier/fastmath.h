@@ -0,0 +1,36 @@
+///-----------------------------------------------------------------------------
+///
+/// @file fastmath.h
+///
+/// @brief Fast single precision trig approximations
+///
+/// Polynomial approximations of the trig functions used by the IMU, for when
+/// libm's full accuracy isn't needed. The orientation is reported in 0.01 deg
+/// (1.7e-4 rad) so an error of FASTMATH_TRIG_MAX_ERROR is well below the
+/// output resolution. Each function is a handful of multiply-adds, at most one
+/// divide and one square root, so it is branch light and data independent.
+///
+/// The functions are selected for the IMU with IMU_FAST_TRIG in imu.h.
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#ifndef UNCANNIER_FASTMATH_H_
+#define UNCANNIER_FASTMATH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Max absolute error of fastAtan2f() and fastAsinf() in radians
+#define FASTMATH_TRIG_MAX_ERROR     1.2e-5
+
+float fastAtan2f( float y, float x );
+float fastAsinf( float x );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UNCANNIER_FASTMATH_H_
@@ -0,0 +1,159 @@
+///-----------------------------------------------------------------------------
+///
+/// @file gyro_bias.c
+///
+/// @brief Online gyro bias estimator
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include "gyro_bias.h"
+
+static void windowClear( GyroBias_t *gb )
+{
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        gb->gyrSum[i] = 0;
+        gb->gyrSumSq[i] = 0;
+        gb->accSum[i] = 0;
+        gb->accSumSq[i] = 0;
+    }
+    gb->count = 0;
+    gb->accValid = true;
+}
+
+// True if the variance of the window is within stddev, without dividing:
+// n * sum(x^2) - sum(x)^2 <= (n * stddev)^2
+static bool varianceWithin( int64_t sum, int64_t sumSq, uint16_t n, int32_t stddev )
+{
+    int64_t limit = (int64_t)n * stddev;
+
+    return ( (int64_t)n * sumSq - sum * sum ) <= limit * limit;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Forget the bias estimate and start a new window
+///
+/// @param[in]  window - Number of samples per window
+///
+///-----------------------------------------------------------------------------
+void gyroBiasReset( GyroBias_t *gb, uint16_t window )
+{
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        gb->biasQ8[i] = 0;
+    }
+    gb->biasValid = false;
+    gyroBiasSetWindow( gb, window );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Change the window length, keeping the bias estimate
+///
+/// @param[in]  window - Number of samples per window
+///
+///-----------------------------------------------------------------------------
+void gyroBiasSetWindow( GyroBias_t *gb, uint16_t window )
+{
+    gb->window = window ? window : 1;
+    windowClear( gb );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Add a sample to the window, and update the estimate at the end of
+///         a stationary window
+///
+/// @param[in]  gyr - Gyro rates in 0.01 deg/s, bias not removed
+/// @param[in]  acc - Accelerations in mg, or NULL if not available
+///
+/// @return True if the bias estimate was updated
+///
+///-----------------------------------------------------------------------------
+bool gyroBiasUpdate( GyroBias_t *gb, const int32_t gyr[3], const int32_t acc[3] )
+{
+    bool stationary = true;
+    uint16_t n;
+
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        gb->gyrSum[i] += gyr[i];
+        gb->gyrSumSq[i] += (int64_t)gyr[i] * gyr[i];
+        if( acc != NULL )
+        {
+            gb->accSum[i] += acc[i];
+            gb->accSumSq[i] += (int64_t)acc[i] * acc[i];
+        }
+    }
+    gb->accValid &= ( acc != NULL );
+
+    if( ++gb->count < gb->window )
+    {
+        return false;
+    }
+
+    n = gb->count;
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        stationary &= varianceWithin( gb->gyrSum[i], gb->gyrSumSq[i], n, GYRO_BIAS_MAX_GYR_STDDEV );
+        stationary &= ( abs( gb->gyrSum[i] / n ) <= GYRO_BIAS_MAX_BIAS );
+        // Without the accelerometer a slow steady rotation can't be told
+        // apart from a bias, so don't trust the window
+        stationary &= gb->accValid
+                      && varianceWithin( gb->accSum[i], gb->accSumSq[i], n, GYRO_BIAS_MAX_ACC_STDDEV );
+    }
+
+    if( stationary )
+    {
+        for( uint8_t i = 0; i < 3; i++ )
+        {
+            int32_t meanQ8 = (int32_t)( ( (int64_t)gb->gyrSum[i] * 256 ) / n );
+
+            if( gb->biasValid )
+            {
+                gb->biasQ8[i] += ( meanQ8 - gb->biasQ8[i] ) / ( 1 << GYRO_BIAS_SMOOTH_SHIFT );
+            }
+            else
+            {
+                gb->biasQ8[i] = meanQ8;
+            }
+        }
+        gb->biasValid = true;
+    }
+
+    windowClear( gb );
+
+    return stationary;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Get the bias estimate of an axis
+///
+/// @return The bias in 0.01 deg/s, 0 until the first stationary window
+///
+///-----------------------------------------------------------------------------
+int32_t gyroBiasGet( const GyroBias_t *gb, uint8_t axis )
+{
+    return ( gb->biasQ8[axis] + 128 ) >> 8;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Set the bias estimate, e.g. to restore a saved one
+///
+/// @param[in]  bias - The bias of each axis in 0.01 deg/s
+///
+///-----------------------------------------------------------------------------
+void gyroBiasSet( GyroBias_t *gb, const int32_t bias[3] )
+{
+    for( uint8_t i = 0; i < 3; i++ )
+    {
+        gb->biasQ8[i] = bias[i] * 256;
+    }
+    gb->biasValid = true;
+}
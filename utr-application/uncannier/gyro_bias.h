@@ -0,0 +1,61 @@
+///-----------------------------------------------------------------------------
+///
+/// @file gyro_bias.h
+///
+/// @brief Online gyro bias estimator
+///
+/// Splits the gyro and accelerometer samples into windows and checks each for
+/// stationarity, i.e. a low variance on every axis of both sensors and a gyro
+/// mean within the plausible bias range. The mean gyro rate of a stationary
+/// window is the bias, which is smoothed into the estimate. No user action
+/// is needed, any time the board is put down still refines the estimate.
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#ifndef UNCANNIER_GYRO_BIAS_H_
+#define UNCANNIER_GYRO_BIAS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Max standard deviation of a stationary window, gyro in 0.01 deg/s and
+/// accelerometer in mg
+#define GYRO_BIAS_MAX_GYR_STDDEV    50
+#define GYRO_BIAS_MAX_ACC_STDDEV    10
+
+/// Max absolute bias in 0.01 deg/s, anything above is a slow rotation
+#define GYRO_BIAS_MAX_BIAS          500
+
+/// Each stationary window moves the estimate 1/2^n of the way to its mean
+#define GYRO_BIAS_SMOOTH_SHIFT      2
+
+typedef struct
+{
+    int32_t gyrSum[3];
+    int64_t gyrSumSq[3];
+    int32_t accSum[3];
+    int64_t accSumSq[3];
+    uint16_t count;
+    uint16_t window;
+    bool accValid;
+    int32_t biasQ8[3];
+    bool biasValid;
+} GyroBias_t;
+
+void gyroBiasReset( GyroBias_t *gb, uint16_t window );
+void gyroBiasSetWindow( GyroBias_t *gb, uint16_t window );
+bool gyroBiasUpdate( GyroBias_t *gb, const int32_t gyr[3], const int32_t acc[3] );
+int32_t gyroBiasGet( const GyroBias_t *gb, uint8_t axis );
+void gyroBiasSet( GyroBias_t *gb, const int32_t bias[3] );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UNCANNIER_GYRO_BIAS_H_
@@ -0,0 +1,390 @@
+///-----------------------------------------------------------------------------
+///
+/// @file imu_codec.c
+///
+/// @brief Lossless compression of IMU sample blocks
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include "imu_codec.h"
+
+typedef struct
+{
+    uint8_t *p;
+    uint32_t acc;
+    uint8_t bits;
+} BitWriter_t;
+
+typedef struct
+{
+    const uint8_t *p;
+    const uint8_t *end;
+    uint32_t acc;
+    uint8_t bits;
+} BitReader_t;
+
+// Map the difference so small magnitudes of either sign give small codes:
+// 0, -1, 1, -2, 2 ... becomes 0, 1, 2, 3, 4 ...
+static inline uint16_t zigzag( int16_t cur, int16_t prev )
+{
+    int16_t d = (int16_t)(uint16_t)( (uint16_t)cur - (uint16_t)prev );
+
+    return ( d >= 0 ) ? (uint16_t)( 2 * (int32_t)d ) : (uint16_t)( -2 * (int32_t)d - 1 );
+}
+
+static inline int16_t unzigzag( uint16_t z, int16_t prev )
+{
+    int32_t d = ( z & 1 ) ? -(int32_t)( z >> 1 ) - 1 : (int32_t)( z >> 1 );
+
+    return (int16_t)(uint16_t)( (uint16_t)prev + (uint16_t)d );
+}
+
+static inline uint8_t varintSize( uint16_t z )
+{
+    return ( z < 0x80 ) ? 1 : ( z < 0x4000 ) ? 2 : 3;
+}
+
+static inline uint8_t bitWidth( uint16_t z )
+{
+    uint8_t width = 0;
+
+    while( z )
+    {
+        width++;
+        z >>= 1;
+    }
+    return width;
+}
+
+static void bitWrite( BitWriter_t *bw, uint16_t value, uint8_t width )
+{
+    bw->acc |= (uint32_t)value << bw->bits;
+    bw->bits += width;
+    while( bw->bits >= 8 )
+    {
+        *bw->p++ = (uint8_t)bw->acc;
+        bw->acc >>= 8;
+        bw->bits -= 8;
+    }
+}
+
+static void bitFlush( BitWriter_t *bw )
+{
+    if( bw->bits )
+    {
+        *bw->p++ = (uint8_t)bw->acc;
+    }
+}
+
+static bool bitRead( BitReader_t *br, uint8_t width, uint16_t *value )
+{
+    while( br->bits < width )
+    {
+        if( br->p >= br->end )
+        {
+            return false;
+        }
+        br->acc |= (uint32_t)*br->p++ << br->bits;
+        br->bits += 8;
+    }
+    *value = (uint16_t)( br->acc & ( ( 1UL << width ) - 1 ) );
+    br->acc >>= width;
+    br->bits -= width;
+    return true;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Start a new stream. The next block encoded, or the next block
+///         decoded, is a keyframe.
+///
+/// @param[in]  keyframeInterval - Blocks per keyframe, 0 for the first only.
+///                                Not used by the decoder.
+///
+///-----------------------------------------------------------------------------
+void imuCodecReset( ImuCodec_t *codec, uint16_t keyframeInterval )
+{
+    for( uint8_t i = 0; i < IMU_CODEC_CHANNELS; i++ )
+    {
+        codec->prev[i] = 0;
+    }
+    codec->primed = false;
+    codec->keyframeInterval = keyframeInterval;
+    codec->blockCount = 0;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Encode as many samples as fit in one block. The codec isn't
+///         changed, so the block can be encoded again if it couldn't be sent.
+///         Call imuCodecCommit() once it has been.
+///
+/// @param[in]  samples - IMU_CODEC_CHANNELS values per sample
+/// @param[in]  count - Number of samples
+/// @param[out] out - Block
+/// @param[in]  outMax - Max block length
+/// @param[out] encoded - Number of samples in the block
+///
+/// @return Block length, 0 if not even one sample fits
+///
+///-----------------------------------------------------------------------------
+uint16_t imuCodecEncode( const ImuCodec_t *codec, const int16_t *samples, uint16_t count,
+                         uint8_t *out, uint16_t outMax, uint16_t *encoded )
+{
+    bool keyframe;
+    uint16_t first;
+    uint16_t fixedLength;
+    uint32_t varintBytes = 0;
+    uint8_t width = 0;
+    uint16_t best = 0;
+    bool bestPacked = false;
+    uint8_t bestWidth = 0;
+    uint16_t length;
+    uint8_t *p;
+
+    *encoded = 0;
+    if( count > IMU_CODEC_MAX_SAMPLES )
+    {
+        count = IMU_CODEC_MAX_SAMPLES;
+    }
+    if( count == 0 )
+    {
+        return 0;
+    }
+
+    keyframe = !codec->primed
+               || ( codec->keyframeInterval && ( codec->blockCount % codec->keyframeInterval ) == 0 );
+    first = keyframe ? 1 : 0;
+    fixedLength = IMU_CODEC_HEADER_LENGTH + ( keyframe ? IMU_CODEC_KEYFRAME_LENGTH : 0 );
+
+    // Both lengths only grow with the number of samples, so stop at the first
+    // that fits neither way
+    for( uint16_t k = 0; k < count; k++ )
+    {
+        uint16_t n = k + 1;
+        uint32_t varintLength;
+        uint32_t packedLength;
+
+        if( k >= first )
+        {
+            const int16_t *cur = &samples[k * IMU_CODEC_CHANNELS];
+            const int16_t *prev = ( k > 0 ) ? cur - IMU_CODEC_CHANNELS : codec->prev;
+
+            for( uint8_t i = 0; i < IMU_CODEC_CHANNELS; i++ )
+            {
+                uint16_t z = zigzag( cur[i], prev[i] );
+                uint8_t w = bitWidth( z );
+
+                varintBytes += varintSize( z );
+                width = ( w > width ) ? w : width;
+            }
+        }
+
+        varintLength = fixedLength + varintBytes;
+        packedLength = fixedLength + ( (uint32_t)( n - first ) * IMU_CODEC_CHANNELS * width + 7 ) / 8;
+        if( packedLength <= outMax && packedLength <= varintLength )
+        {
+            best = n;
+            bestPacked = true;
+            bestWidth = width;
+        }
+        else if( varintLength <= outMax )
+        {
+            best = n;
+            bestPacked = false;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if( best == 0 )
+    {
+        return 0;
+    }
+
+    p = out;
+    *p++ = ( keyframe ? IMU_CODEC_KEYFRAME : 0 ) | ( bestPacked ? ( IMU_CODEC_PACKED | bestWidth ) : 0 );
+    *p++ = (uint8_t)best;
+    if( keyframe )
+    {
+        for( uint8_t i = 0; i < IMU_CODEC_CHANNELS; i++ )
+        {
+            *p++ = (uint8_t)samples[i];
+            *p++ = (uint8_t)( (uint16_t)samples[i] >> 8 );
+        }
+    }
+
+    if( bestPacked )
+    {
+        BitWriter_t bw = { p, 0, 0 };
+
+        for( uint16_t n = first; n < best; n++ )
+        {
+            const int16_t *cur = &samples[n * IMU_CODEC_CHANNELS];
+            const int16_t *prev = ( n > 0 ) ? cur - IMU_CODEC_CHANNELS : codec->prev;
+
+            for( uint8_t i = 0; i < IMU_CODEC_CHANNELS; i++ )
+            {
+                bitWrite( &bw, zigzag( cur[i], prev[i] ), bestWidth );
+            }
+        }
+        bitFlush( &bw );
+        p = bw.p;
+    }
+    else
+    {
+        for( uint16_t n = first; n < best; n++ )
+        {
+            const int16_t *cur = &samples[n * IMU_CODEC_CHANNELS];
+            const int16_t *prev = ( n > 0 ) ? cur - IMU_CODEC_CHANNELS : codec->prev;
+
+            for( uint8_t i = 0; i < IMU_CODEC_CHANNELS; i++ )
+            {
+                uint16_t z = zigzag( cur[i], prev[i] );
+
+                while( z >= 0x80 )
+                {
+                    *p++ = (uint8_t)( z | 0x80 );
+                    z >>= 7;
+                }
+                *p++ = (uint8_t)z;
+            }
+        }
+    }
+
+    length = (uint16_t)( p - out );
+    *encoded = best;
+    return length;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Move the encoder on past a block that has been sent
+///
+/// @param[in]  samples - The samples given to imuCodecEncode()
+/// @param[in]  encoded - Number of samples in the block
+///
+///-----------------------------------------------------------------------------
+void imuCodecCommit( ImuCodec_t *codec, const int16_t *samples, uint16_t encoded )
+{
+    if( encoded == 0 )
+    {
+        return;
+    }
+    for( uint8_t i = 0; i < IMU_CODEC_CHANNELS; i++ )
+    {
+        codec->prev[i] = samples[( encoded - 1 ) * IMU_CODEC_CHANNELS + i];
+    }
+    codec->primed = true;
+    codec->blockCount++;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Decode a block. Blocks must be decoded in order. After a missed
+///         block, call imuCodecReset() to skip to the next keyframe.
+///
+/// @param[in]  in - Block
+/// @param[in]  length - Block length
+/// @param[out] samples - IMU_CODEC_CHANNELS values per sample
+/// @param[in]  max - Max number of samples
+///
+/// @return Number of samples, 0 while waiting for a keyframe or if the block
+///         is invalid
+///
+///-----------------------------------------------------------------------------
+uint16_t imuCodecDecode( ImuCodec_t *codec, const uint8_t *in, uint16_t length,
+                         int16_t *samples, uint16_t max )
+{
+    const uint8_t *p = in;
+    const uint8_t *end = in + length;
+    uint8_t flags;
+    uint8_t width;
+    uint16_t count;
+    uint16_t first = 0;
+    BitReader_t br;
+
+    if( length < IMU_CODEC_HEADER_LENGTH )
+    {
+        return 0;
+    }
+    flags = *p++;
+    count = *p++;
+    width = flags & IMU_CODEC_WIDTH_MASK;
+    if( count > max || ( !( flags & IMU_CODEC_KEYFRAME ) && !codec->primed ) )
+    {
+        return 0;
+    }
+
+    if( flags & IMU_CODEC_KEYFRAME )
+    {
+        if( count == 0 || end - p < IMU_CODEC_KEYFRAME_LENGTH )
+        {
+            codec->primed = false;
+            return 0;
+        }
+        for( uint8_t i = 0; i < IMU_CODEC_CHANNELS; i++ )
+        {
+            samples[i] = (int16_t)(uint16_t)( p[0] | ( p[1] << 8 ) );
+            p += 2;
+        }
+        first = 1;
+    }
+
+    br.p = p;
+    br.end = end;
+    br.acc = 0;
+    br.bits = 0;
+
+    for( uint16_t n = first; n < count; n++ )
+    {
+        int16_t *cur = &samples[n * IMU_CODEC_CHANNELS];
+        const int16_t *prev = ( n > 0 ) ? cur - IMU_CODEC_CHANNELS : codec->prev;
+
+        for( uint8_t i = 0; i < IMU_CODEC_CHANNELS; i++ )
+        {
+            uint16_t z = 0;
+
+            if( flags & IMU_CODEC_PACKED )
+            {
+                if( !bitRead( &br, width, &z ) )
+                {
+                    codec->primed = false;
+                    return 0;
+                }
+            }
+            else
+            {
+                uint8_t shift = 0;
+                uint8_t b;
+
+                do
+                {
+                    if( br.p >= end || shift > 14 )
+                    {
+                        codec->primed = false;
+                        return 0;
+                    }
+                    b = *br.p++;
+                    z |= (uint16_t)( ( b & 0x7f ) << shift );
+                    shift += 7;
+                } while( b & 0x80 );
+            }
+            cur[i] = unzigzag( z, prev[i] );
+        }
+    }
+
+    if( count )
+    {
+        for( uint8_t i = 0; i < IMU_CODEC_CHANNELS; i++ )
+        {
+            codec->prev[i] = samples[( count - 1 ) * IMU_CODEC_CHANNELS + i];
+        }
+        codec->primed = true;
+    }
+    return count;
+}
@@ -0,0 +1,73 @@
+///-----------------------------------------------------------------------------
+///
+/// @file imu_codec.h
+///
+/// @brief Lossless compression of IMU sample blocks
+///
+/// Consecutive samples differ only slightly, so each block holds the first
+/// order difference of every channel from the previous sample. The encoder
+/// picks per block whichever is smaller of zigzag varints, one to three bytes
+/// per difference, or fixed width bit packing of all differences.
+///
+/// A block starts either with a keyframe, the first sample in full, or with
+/// the difference from the last sample of the previous block. Every
+/// keyframeInterval blocks is a keyframe, so a decoder that has missed a
+/// block can resync. Differences wrap like the int16 samples, so any
+/// sequence of samples is reproduced exactly.
+///
+/// Block layout:
+///   byte 0    IMU_CODEC_KEYFRAME | IMU_CODEC_PACKED | bit width (packed only)
+///   byte 1    Number of samples
+///   keyframe  IMU_CODEC_CHANNELS little endian int16, if IMU_CODEC_KEYFRAME
+///   deltas    Zigzag varints, or bit packed LSB first, channel by channel
+///             for each sample
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#ifndef UNCANNIER_IMU_CODEC_H_
+#define UNCANNIER_IMU_CODEC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Channels per sample, accelerometer and gyro axes
+#define IMU_CODEC_CHANNELS          6
+
+/// Block header flags
+#define IMU_CODEC_KEYFRAME          0x80
+#define IMU_CODEC_PACKED            0x40
+#define IMU_CODEC_WIDTH_MASK        0x1f
+
+/// Block header and keyframe lengths in bytes
+#define IMU_CODEC_HEADER_LENGTH     2
+#define IMU_CODEC_KEYFRAME_LENGTH   ( IMU_CODEC_CHANNELS * 2 )
+
+/// Max samples per block
+#define IMU_CODEC_MAX_SAMPLES       255
+
+typedef struct
+{
+    int16_t prev[IMU_CODEC_CHANNELS];
+    bool primed;
+    uint16_t keyframeInterval;
+    uint16_t blockCount;
+} ImuCodec_t;
+
+void imuCodecReset( ImuCodec_t *codec, uint16_t keyframeInterval );
+uint16_t imuCodecEncode( const ImuCodec_t *codec, const int16_t *samples, uint16_t count,
+                         uint8_t *out, uint16_t outMax, uint16_t *encoded );
+void imuCodecCommit( ImuCodec_t *codec, const int16_t *samples, uint16_t encoded );
+uint16_t imuCodecDecode( ImuCodec_t *codec, const uint8_t *in, uint16_t length,
+                         int16_t *samples, uint16_t max );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UNCANNIER_IMU_CODEC_H_
@@ -0,0 +1,519 @@
+///-----------------------------------------------------------------------------
+///
+/// @file imu_fixed.c
+///
+/// @brief Fixed-point Inertial Measurement Unit engine
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include "imu_fixed.h"
+
+#define FIXED_MAX                   INT32_MAX
+#define FIXED_MIN                   ( -INT32_MAX )
+
+#define FIXED_PI                    IMU_FIXED( 3.1415926535897932384626433832795 )
+#define FIXED_PI_2                  IMU_FIXED( 1.5707963267948966192313216916398 )
+#define FIXED_HALF                  IMU_FIXED( 0.5 )
+#define FIXED_THREE                 IMU_FIXED( 3.0 )
+
+#define MAX_ACCEL_FOR_ANGLE         IMU_FIXED( 0.9848 )
+
+// Odd minimax polynomial for atan() on [0,1], max error 1e-5 rad
+#define ATAN_C1                     IMU_FIXED( 0.9998660 )
+#define ATAN_C3                     IMU_FIXED( -0.3302995 )
+#define ATAN_C5                     IMU_FIXED( 0.1801410 )
+#define ATAN_C7                     IMU_FIXED( -0.0851330 )
+#define ATAN_C9                     IMU_FIXED( 0.0208351 )
+
+static ImuFixed_t saturate( int64_t value )
+{
+    if( value > FIXED_MAX )
+    {
+        return FIXED_MAX;
+    }
+    if( value < FIXED_MIN )
+    {
+        return FIXED_MIN;
+    }
+    return (ImuFixed_t)value;
+}
+
+static uint32_t sqrt64( uint64_t value )
+{
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    // Fixed number of iterations, one per result bit
+    while( bit != 0 )
+    {
+        if( value >= result + bit )
+        {
+            value -= result + bit;
+            result = ( result >> 1 ) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)result;
+}
+
+static ImuFixed_t atanUnit( ImuFixed_t r )
+{
+    ImuFixed_t r2 = imuFixedMul( r, r );
+    ImuFixed_t p;
+
+    p = imuFixedAdd( ATAN_C7, imuFixedMul( r2, ATAN_C9 ) );
+    p = imuFixedAdd( ATAN_C5, imuFixedMul( r2, p ) );
+    p = imuFixedAdd( ATAN_C3, imuFixedMul( r2, p ) );
+    p = imuFixedAdd( ATAN_C1, imuFixedMul( r2, p ) );
+
+    return imuFixedMul( r, p );
+}
+
+static void matrixMultiply( ImuFixed_t out[3][3], ImuFixed_t in_a[3][3], ImuFixed_t in_b[3][3] )
+{
+    int64_t op;
+
+    for( uint8_t x = 0; x < 3; x++ )
+    {
+        for( uint8_t y = 0; y < 3; y++ )
+        {
+            // Accumulate at full precision and round once
+            op = 0;
+            for( uint8_t w = 0; w < 3; w++ )
+            {
+                op += (int64_t)in_a[x][w] * in_b[w][y];
+            }
+            out[x][y] = saturate( ( op + ( (int64_t)1 << ( IMU_FIXED_Q - 1 ) ) ) >> IMU_FIXED_Q );
+        }
+    }
+}
+
+static ImuFixed_t vectorDotProduct( ImuFixed_t in_a[3], ImuFixed_t in_b[3] )
+{
+    int64_t op = 0;
+
+    for( uint8_t x = 0; x < 3; x++ )
+    {
+        op += (int64_t)in_a[x] * in_b[x];
+    }
+
+    return saturate( ( op + ( (int64_t)1 << ( IMU_FIXED_Q - 1 ) ) ) >> IMU_FIXED_Q );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Saturating addition
+///
+///-----------------------------------------------------------------------------
+ImuFixed_t imuFixedAdd( ImuFixed_t a, ImuFixed_t b )
+{
+    return saturate( (int64_t)a + b );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Saturating subtraction
+///
+///-----------------------------------------------------------------------------
+ImuFixed_t imuFixedSub( ImuFixed_t a, ImuFixed_t b )
+{
+    return saturate( (int64_t)a - b );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Saturating multiplication, rounded to nearest
+///
+///-----------------------------------------------------------------------------
+ImuFixed_t imuFixedMul( ImuFixed_t a, ImuFixed_t b )
+{
+    int64_t product = (int64_t)a * b;
+
+    return saturate( ( product + ( (int64_t)1 << ( IMU_FIXED_Q - 1 ) ) ) >> IMU_FIXED_Q );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Convert the ratio of two integers to fixed-point
+/// @param  num  Numerator
+/// @param  den  Denominator, must not be 0
+///
+///-----------------------------------------------------------------------------
+ImuFixed_t imuFixedFromRatio( int32_t num, int32_t den )
+{
+    int64_t value = (int64_t)num * IMU_FIXED_ONE;
+    int64_t half = ( den < 0 ) ? -( (int64_t)den / 2 ) : den / 2;
+
+    // Round to nearest
+    value += ( ( value < 0 ) != ( den < 0 ) ) ? -half : half;
+
+    return saturate( value / den );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Convert to an integer
+/// @param  a      Value to convert
+/// @param  scale  Integer scale to apply before truncating
+///
+///-----------------------------------------------------------------------------
+int32_t imuFixedToInt( ImuFixed_t a, int32_t scale )
+{
+    int64_t value = (int64_t)a * scale;
+
+    // Truncate towards zero like a float to integer conversion
+    if( value < 0 )
+    {
+        return (int32_t)-( -value >> IMU_FIXED_Q );
+    }
+    return (int32_t)( value >> IMU_FIXED_Q );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Square root, negative values give 0
+///
+///-----------------------------------------------------------------------------
+ImuFixed_t imuFixedSqrt( ImuFixed_t a )
+{
+    if( a <= 0 )
+    {
+        return 0;
+    }
+    return (ImuFixed_t)sqrt64( (uint64_t)a << IMU_FIXED_Q );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Four quadrant arc tangent of y/x
+///
+///-----------------------------------------------------------------------------
+ImuFixed_t imuFixedAtan2( ImuFixed_t y, ImuFixed_t x )
+{
+    int64_t ax = ( x < 0 ) ? -(int64_t)x : x;
+    int64_t ay = ( y < 0 ) ? -(int64_t)y : y;
+    ImuFixed_t a;
+
+    if( ax == 0 && ay == 0 )
+    {
+        return 0;
+    }
+
+    // Reduce to the first octant so the polynomial input is within [0,1]
+    if( ay <= ax )
+    {
+        a = atanUnit( (ImuFixed_t)( ( ay << IMU_FIXED_Q ) / ax ) );
+    }
+    else
+    {
+        a = FIXED_PI_2 - atanUnit( (ImuFixed_t)( ( ax << IMU_FIXED_Q ) / ay ) );
+    }
+
+    if( x < 0 )
+    {
+        a = FIXED_PI - a;
+    }
+    return ( y < 0 ) ? -a : a;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Arc sine, the input is clamped to [-1,1]
+///
+///-----------------------------------------------------------------------------
+ImuFixed_t imuFixedAsin( ImuFixed_t x )
+{
+    if( x > IMU_FIXED_ONE )
+    {
+        x = IMU_FIXED_ONE;
+    }
+    else if( x < -IMU_FIXED_ONE )
+    {
+        x = -IMU_FIXED_ONE;
+    }
+
+    return imuFixedAtan2( x, imuFixedSqrt( IMU_FIXED_ONE - imuFixedMul( x, x ) ) );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Normalize the angle to be within -PI..PI
+///
+///-----------------------------------------------------------------------------
+void imuFixedAngleNormalize( ImuFixed_t *a )
+{
+    while( *a >= FIXED_PI )
+    {
+        *a -= 2 * FIXED_PI;
+    }
+    while( *a < -FIXED_PI )
+    {
+        *a += 2 * FIXED_PI;
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Set all elements of the vector to 0
+///
+///-----------------------------------------------------------------------------
+void imuFixedVectorReset( ImuFixed_t inout[3] )
+{
+    for( uint8_t x = 0; x < 3; x++ )
+    {
+        inout[x] = 0;
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Normalize all angles in the vector to be within -PI..PI
+///
+///-----------------------------------------------------------------------------
+void imuFixedVectorAngleNormalize( ImuFixed_t inout[3] )
+{
+    for( uint8_t x = 0; x < 3; x++ )
+    {
+        imuFixedAngleNormalize( &inout[x] );
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Add two vectors
+///
+///-----------------------------------------------------------------------------
+void imuFixedVectorAdd( ImuFixed_t out[3], ImuFixed_t in_a[3], ImuFixed_t in_b[3] )
+{
+    for( uint8_t x = 0; x < 3; x++ )
+    {
+        out[x] = imuFixedAdd( in_a[x], in_b[x] );
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Subtract two vectors
+///
+///-----------------------------------------------------------------------------
+void imuFixedVectorSubtract( ImuFixed_t out[3], ImuFixed_t in_a[3], ImuFixed_t in_b[3] )
+{
+    for( uint8_t x = 0; x < 3; x++ )
+    {
+        out[x] = imuFixedSub( in_a[x], in_b[x] );
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Copy and multiply the vector by a scalar
+///
+///-----------------------------------------------------------------------------
+void imuFixedVectorCopyAndScale( ImuFixed_t out[3], ImuFixed_t in[3], ImuFixed_t scale )
+{
+    for( uint8_t x = 0; x < 3; x++ )
+    {
+        out[x] = imuFixedMul( in[x], scale );
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Multiply the vector by a scalar
+///
+///-----------------------------------------------------------------------------
+void imuFixedVectorScale( ImuFixed_t inout[3], ImuFixed_t scale )
+{
+    for( uint8_t x = 0; x < 3; x++ )
+    {
+        inout[x] = imuFixedMul( inout[x], scale );
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Cross product of two vectors
+///
+///-----------------------------------------------------------------------------
+void imuFixedVectorCrossProduct( ImuFixed_t out[3], ImuFixed_t in_a[3], ImuFixed_t in_b[3] )
+{
+    out[0] = imuFixedSub( imuFixedMul( in_a[1], in_b[2] ), imuFixedMul( in_a[2], in_b[1] ) );
+    out[1] = imuFixedSub( imuFixedMul( in_a[2], in_b[0] ), imuFixedMul( in_a[0], in_b[2] ) );
+    out[2] = imuFixedSub( imuFixedMul( in_a[0], in_b[1] ), imuFixedMul( in_a[1], in_b[0] ) );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Reset the DCM to an identity matrix
+///
+///-----------------------------------------------------------------------------
+void imuFixedDcmReset( ImuFixed_t dcmMatrix[3][3] )
+{
+    for( uint8_t y = 0; y < 3; y++ )
+    {
+        for( uint8_t x = 0; x < 3; x++ )
+        {
+            dcmMatrix[y][x] = ( x == y ) ? IMU_FIXED_ONE : 0;
+        }
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Reset only the z-axis of the DCM
+///
+///-----------------------------------------------------------------------------
+void imuFixedDcmResetZ( ImuFixed_t dcmMatrix[3][3] )
+{
+    dcmMatrix[0][0] = IMU_FIXED_ONE;
+    dcmMatrix[0][1] = 0;
+    dcmMatrix[0][2] = 0;
+    imuFixedVectorCrossProduct( &dcmMatrix[1][0], &dcmMatrix[0][0], &dcmMatrix[2][0] );
+    imuFixedVectorScale( &dcmMatrix[1][0], -IMU_FIXED_ONE );
+    imuFixedVectorCrossProduct( &dcmMatrix[0][0], &dcmMatrix[1][0], &dcmMatrix[2][0] );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Rotate the DCM by angles relative to the rotating coordinate system
+///
+///-----------------------------------------------------------------------------
+void imuFixedDcmRotate( ImuFixed_t dcmMatrix[3][3], ImuFixed_t ang[3] )
+{
+    ImuFixed_t um[3][3];
+    ImuFixed_t tm[3][3];
+
+    um[0][0] = 0;
+    um[0][1] = -ang[2];
+    um[0][2] = ang[1];
+    um[1][0] = ang[2];
+    um[1][1] = 0;
+    um[1][2] = -ang[0];
+    um[2][0] = -ang[1];
+    um[2][1] = ang[0];
+    um[2][2] = 0;
+
+    matrixMultiply( tm, dcmMatrix, um );
+    for( uint8_t y = 0; y < 3; y++ )
+    {
+        for( uint8_t x = 0; x < 3; x++ )
+        {
+            dcmMatrix[y][x] = imuFixedAdd( dcmMatrix[y][x], tm[y][x] );
+        }
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Adjust the DCM to have 3 perpendicular unit vectors
+///
+///-----------------------------------------------------------------------------
+void imuFixedDcmNormalize( ImuFixed_t dcmMatrix[3][3] )
+{
+    ImuFixed_t error;
+    ImuFixed_t temporary[3][3];
+    ImuFixed_t renorm;
+
+    error = -imuFixedMul( vectorDotProduct( &dcmMatrix[0][0], &dcmMatrix[1][0] ), FIXED_HALF );
+
+    imuFixedVectorCopyAndScale( &temporary[0][0], &dcmMatrix[1][0], error );
+    imuFixedVectorCopyAndScale( &temporary[1][0], &dcmMatrix[0][0], error );
+
+    imuFixedVectorAdd( &temporary[0][0], &temporary[0][0], &dcmMatrix[0][0] );
+    imuFixedVectorAdd( &temporary[1][0], &temporary[1][0], &dcmMatrix[1][0] );
+
+    imuFixedVectorCrossProduct( &temporary[2][0], &temporary[0][0], &temporary[1][0] );
+
+    for( uint8_t y = 0; y < 3; y++ )
+    {
+        renorm = imuFixedMul( FIXED_HALF,
+                              imuFixedSub( FIXED_THREE, vectorDotProduct( &temporary[y][0], &temporary[y][0] ) ) );
+        imuFixedVectorCopyAndScale( &dcmMatrix[y][0], &temporary[y][0], renorm );
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Get the DCM angles relative to the fixed coordinate system
+///
+///-----------------------------------------------------------------------------
+void imuFixedDcmGetAngles( ImuFixed_t dcmMatrix[3][3], ImuFixed_t ang[3] )
+{
+    // Roll
+    ang[0] = imuFixedAtan2( dcmMatrix[2][1], dcmMatrix[2][2] );
+    // Pitch
+    ang[1] = -imuFixedAsin( dcmMatrix[2][0] );
+    // Yaw
+    ang[2] = imuFixedAtan2( dcmMatrix[1][0], dcmMatrix[0][0] );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Clear the sensor fusion data
+///
+///-----------------------------------------------------------------------------
+void imuFixedSensorFusionGyroCorrClr( ImuFixedSensorFusion_t *fus )
+{
+    imuFixedVectorReset( fus->fusionAngleCorrection );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Add the sensor fusion correction to the gyro data
+///
+///-----------------------------------------------------------------------------
+void imuFixedSensorFusionGyroCorrDo( ImuFixedSensorFusion_t *fus, ImuFixed_t gyr[3] )
+{
+    imuFixedVectorAdd( gyr, gyr, fus->fusionAngleCorrection );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Calculate the sensor fusion correction from the accelerometers
+///
+///-----------------------------------------------------------------------------
+void imuFixedSensorFusionGyroCorrCalc( ImuFixedSensorFusion_t *fus, ImuFixed_t ori[3],
+                                       bool accValid, ImuFixed_t accVec[3],
+                                       bool dirValid, ImuFixed_t dirZ,
+                                       int16_t freq )
+{
+    ImuFixed_t accAng[3];
+
+    imuFixedSensorFusionGyroCorrClr( fus );
+
+    if( accValid
+        && ( accVec[0] >= -MAX_ACCEL_FOR_ANGLE ) && ( accVec[0] <= MAX_ACCEL_FOR_ANGLE )
+        && ( accVec[1] >= -MAX_ACCEL_FOR_ANGLE ) && ( accVec[1] <= MAX_ACCEL_FOR_ANGLE ) )
+    {
+        if( accVec[2] >= 0 )
+        {
+            accAng[0] = imuFixedAsin( accVec[1] );
+            accAng[1] = -imuFixedAsin( accVec[0] );
+            accAng[2] = dirZ;
+            imuFixedVectorSubtract( fus->fusionAngleCorrection, accAng, ori );
+            imuFixedVectorAngleNormalize( fus->fusionAngleCorrection );
+        }
+        else
+        {
+            accAng[0] = FIXED_PI - imuFixedAsin( accVec[1] );
+            accAng[1] = -imuFixedAsin( accVec[0] );
+            accAng[2] = imuFixedAdd( FIXED_PI, dirZ );
+            imuFixedVectorAngleNormalize( accAng );
+            imuFixedVectorSubtract( fus->fusionAngleCorrection, accAng, ori );
+            imuFixedVectorAngleNormalize( fus->fusionAngleCorrection );
+            fus->fusionAngleCorrection[1] = -fus->fusionAngleCorrection[1];
+        }
+        if( !dirValid )
+        {
+            fus->fusionAngleCorrection[2] = 0;
+        }
+        imuFixedVectorScale( fus->fusionAngleCorrection, imuFixedFromRatio( 1, 2 * freq ) );
+    }
+}
@@ -0,0 +1,81 @@
+///-----------------------------------------------------------------------------
+///
+/// @file imu_fixed.h
+///
+/// @brief Fixed-point Inertial Measurement Unit engine
+///
+/// A fixed-point implementation of the DCM sensor fusion in imu.c. Values are
+/// signed 32-bit with IMU_FIXED_Q fraction bits, giving a range of +-16 and a
+/// resolution of 7.5e-9. All arithmetic saturates instead of wrapping, and the
+/// trig functions are integer polynomial approximations, so no FPU or libm is
+/// needed and the cycle count per sample does not depend on the data.
+///
+/// The engine is selected for the application with IMU_FIXED_POINT in imu.h,
+/// which maps the imu.h API onto the functions declared here.
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#ifndef UNCANNIER_IMU_FIXED_H_
+#define UNCANNIER_IMU_FIXED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int32_t ImuFixed_t;
+
+typedef struct
+{
+    ImuFixed_t fusionAngleCorrection[3];
+} ImuFixedSensorFusion_t;
+
+/// Number of fraction bits
+#define IMU_FIXED_Q                 27
+#define IMU_FIXED_ONE               ((ImuFixed_t)1 << IMU_FIXED_Q)
+
+/// Convert a constant to fixed-point. Only use with constant expressions, so
+/// the floating point math is done by the compiler.
+#define IMU_FIXED( x )              ((ImuFixed_t)( (x) * IMU_FIXED_ONE + ( (x) >= 0 ? 0.5 : -0.5 ) ))
+
+/// Max absolute error of imuFixedAtan2() and imuFixedAsin() in radians
+#define IMU_FIXED_TRIG_MAX_ERROR    1.2e-5
+
+ImuFixed_t imuFixedAdd( ImuFixed_t a, ImuFixed_t b );
+ImuFixed_t imuFixedSub( ImuFixed_t a, ImuFixed_t b );
+ImuFixed_t imuFixedMul( ImuFixed_t a, ImuFixed_t b );
+ImuFixed_t imuFixedFromRatio( int32_t num, int32_t den );
+int32_t imuFixedToInt( ImuFixed_t a, int32_t scale );
+ImuFixed_t imuFixedSqrt( ImuFixed_t a );
+ImuFixed_t imuFixedAtan2( ImuFixed_t y, ImuFixed_t x );
+ImuFixed_t imuFixedAsin( ImuFixed_t x );
+
+void imuFixedAngleNormalize( ImuFixed_t *a );
+void imuFixedVectorReset( ImuFixed_t inout[3] );
+void imuFixedVectorAngleNormalize( ImuFixed_t inout[3] );
+void imuFixedVectorAdd( ImuFixed_t out[3], ImuFixed_t in_a[3], ImuFixed_t in_b[3] );
+void imuFixedVectorSubtract( ImuFixed_t out[3], ImuFixed_t in_a[3], ImuFixed_t in_b[3] );
+void imuFixedVectorCopyAndScale( ImuFixed_t out[3], ImuFixed_t in[3], ImuFixed_t scale );
+void imuFixedVectorScale( ImuFixed_t inout[3], ImuFixed_t scale );
+void imuFixedVectorCrossProduct( ImuFixed_t out[3], ImuFixed_t in_a[3], ImuFixed_t in_b[3] );
+void imuFixedDcmReset( ImuFixed_t dcmMatrix[3][3] );
+void imuFixedDcmResetZ( ImuFixed_t dcmMatrix[3][3] );
+void imuFixedDcmRotate( ImuFixed_t dcmMatrix[3][3], ImuFixed_t ang[3] );
+void imuFixedDcmNormalize( ImuFixed_t dcmMatrix[3][3] );
+void imuFixedDcmGetAngles( ImuFixed_t dcmMatrix[3][3], ImuFixed_t ang[3] );
+void imuFixedSensorFusionGyroCorrClr( ImuFixedSensorFusion_t *fus );
+void imuFixedSensorFusionGyroCorrDo( ImuFixedSensorFusion_t *fus, ImuFixed_t gyr[3] );
+void imuFixedSensorFusionGyroCorrCalc( ImuFixedSensorFusion_t *fus, ImuFixed_t ori[3],
+                                       bool accValid, ImuFixed_t accVec[3],
+                                       bool dirValid, ImuFixed_t dirZ,
+                                       int16_t freq );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UNCANNIER_IMU_FIXED_H_
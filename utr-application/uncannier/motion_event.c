@@ -0,0 +1,271 @@
+///-----------------------------------------------------------------------------
+///
+/// @file motion_event.c
+///
+/// @brief Tap, double tap, shock and free-fall detector
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include "motion_event.h"
+
+static uint16_t msToSamples( uint16_t ms, uint16_t freq )
+{
+    uint32_t samples = (uint32_t)ms * freq / 1000;
+
+    return samples ? (uint16_t)samples : 1;
+}
+
+static uint16_t magnitude( int32_t x, int32_t y, int32_t z )
+{
+    uint32_t square = (uint32_t)( x * x ) + (uint32_t)( y * y ) + (uint32_t)( z * z );
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while( bit > square )
+    {
+        bit >>= 2;
+    }
+    while( bit )
+    {
+        if( square >= root + bit )
+        {
+            square -= root + bit;
+            root = ( root >> 1 ) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return ( root > UINT16_MAX ) ? UINT16_MAX : (uint16_t)root;
+}
+
+static void eventAdd( MotionEvent_t *events, uint8_t *count, uint8_t type, uint16_t magnitude, uint32_t time )
+{
+    events[*count].type = type;
+    events[*count].magnitude = magnitude;
+    events[*count].time = time;
+    ( *count )++;
+}
+
+static void pulseStart( MotionEventDetector_t *med, uint16_t dyn, uint16_t mag, uint32_t time )
+{
+    med->tapState = motionEventTapPulse;
+    med->tapCnt = 1;
+    med->pulsePeak = dyn;
+    med->pulseTime = time;
+    med->pulseShock = ( mag > med->shockThreshold );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Reset the detector to the default thresholds
+///
+/// @param[in]  freq - Sample rate in Hz
+///
+///-----------------------------------------------------------------------------
+void motionEventReset( MotionEventDetector_t *med, uint16_t freq )
+{
+    med->gravityValid = false;
+    med->tapState = motionEventTapIdle;
+    med->tapCount = 0;
+    med->shock = false;
+    med->freefallCnt = 0;
+    med->freefallThreshold = MOTION_EVENT_FREEFALL_MG;
+    motionEventSetThresholds( med, MOTION_EVENT_TAP_MG, MOTION_EVENT_SHOCK_MG );
+    motionEventSetFreq( med, freq );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Change the sample rate. Anything in progress is dropped.
+///
+/// @param[in]  freq - Sample rate in Hz
+///
+///-----------------------------------------------------------------------------
+void motionEventSetFreq( MotionEventDetector_t *med, uint16_t freq )
+{
+    med->tapMaxSamples = msToSamples( MOTION_EVENT_TAP_MAX_MS, freq );
+    med->tapQuietSamples = msToSamples( MOTION_EVENT_TAP_QUIET_MS, freq );
+    med->tapWindowSamples = msToSamples( MOTION_EVENT_TAP_WINDOW_MS, freq );
+    med->freefallSamples = msToSamples( MOTION_EVENT_FREEFALL_MS, freq );
+    med->tapState = motionEventTapIdle;
+    med->tapCount = 0;
+    med->shock = false;
+    med->freefallCnt = 0;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Set the tap and shock thresholds
+///
+/// @param[in]  tapMg - Tap threshold in mg, gravity removed
+/// @param[in]  shockMg - Shock threshold in mg
+///
+///-----------------------------------------------------------------------------
+void motionEventSetThresholds( MotionEventDetector_t *med, uint16_t tapMg, uint16_t shockMg )
+{
+    med->tapThreshold = tapMg;
+    med->shockThreshold = shockMg;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Add a sample
+///
+/// @param[in]  acc - Accelerations in mg
+/// @param[in]  time - Time of the sample
+/// @param[out] events - Events detected
+///
+/// @return Number of events detected
+///
+///-----------------------------------------------------------------------------
+uint8_t motionEventUpdate( MotionEventDetector_t *med, const int32_t acc[3], uint32_t time,
+                           MotionEvent_t events[MOTION_EVENT_MAX] )
+{
+    uint8_t count = 0;
+    uint16_t mag = magnitude( acc[0], acc[1], acc[2] );
+    uint16_t dyn;
+
+    if( !med->gravityValid )
+    {
+        for( uint8_t i = 0; i < 3; i++ )
+        {
+            med->gravity[i] = acc[i] << MOTION_EVENT_GRAVITY_SHIFT;
+        }
+        med->gravityValid = true;
+    }
+    dyn = magnitude( acc[0] - ( med->gravity[0] >> MOTION_EVENT_GRAVITY_SHIFT ),
+                     acc[1] - ( med->gravity[1] >> MOTION_EVENT_GRAVITY_SHIFT ),
+                     acc[2] - ( med->gravity[2] >> MOTION_EVENT_GRAVITY_SHIFT ) );
+
+    switch( med->tapState )
+    {
+        case motionEventTapIdle:
+            if( dyn > med->tapThreshold )
+            {
+                pulseStart( med, dyn, mag, time );
+            }
+            break;
+
+        case motionEventTapPulse:
+            med->tapCnt++;
+            if( dyn > med->pulsePeak )
+            {
+                med->pulsePeak = dyn;
+            }
+            med->pulseShock = med->pulseShock || ( mag > med->shockThreshold );
+
+            if( ( dyn < med->tapThreshold / 2 ) && !med->pulseShock )
+            {
+                if( ++med->tapCount == 1 )
+                {
+                    med->tapPeak = med->pulsePeak;
+                    med->tapTime = med->pulseTime;
+                    med->tapState = motionEventTapQuiet;
+                }
+                else
+                {
+                    eventAdd( events, &count, MOTION_EVENT_DOUBLE_TAP,
+                              ( med->pulsePeak > med->tapPeak ) ? med->pulsePeak : med->tapPeak, med->tapTime );
+                    med->tapCount = 0;
+                    med->tapState = motionEventTapReject;
+                }
+                med->tapCnt = 0;
+            }
+            else if( ( dyn < med->tapThreshold / 2 ) || ( med->tapCnt > med->tapMaxSamples ) )
+            {
+                // A shock or movement, but a tap before it still counts
+                if( med->tapCount == 1 )
+                {
+                    eventAdd( events, &count, MOTION_EVENT_TAP, med->tapPeak, med->tapTime );
+                }
+                med->tapCount = 0;
+                med->tapCnt = 0;
+                med->tapState = motionEventTapReject;
+            }
+            break;
+
+        case motionEventTapQuiet:
+            if( ++med->tapCnt >= med->tapQuietSamples )
+            {
+                med->tapCnt = 0;
+                med->tapState = motionEventTapWindow;
+            }
+            break;
+
+        case motionEventTapWindow:
+            if( dyn > med->tapThreshold )
+            {
+                pulseStart( med, dyn, mag, time );
+            }
+            else if( ++med->tapCnt >= med->tapWindowSamples )
+            {
+                eventAdd( events, &count, MOTION_EVENT_TAP, med->tapPeak, med->tapTime );
+                med->tapCount = 0;
+                med->tapState = motionEventTapIdle;
+            }
+            break;
+
+        case motionEventTapReject:
+            // Wait for things to settle
+            if( dyn > med->tapThreshold / 2 )
+            {
+                med->tapCnt = 0;
+            }
+            else if( ++med->tapCnt >= med->tapQuietSamples )
+            {
+                med->tapState = motionEventTapIdle;
+            }
+            break;
+    }
+
+    // Keep gravity out of the pulses
+    if( med->tapState != motionEventTapPulse )
+    {
+        for( uint8_t i = 0; i < 3; i++ )
+        {
+            med->gravity[i] += acc[i] - ( med->gravity[i] >> MOTION_EVENT_GRAVITY_SHIFT );
+        }
+    }
+
+    if( mag > med->shockThreshold )
+    {
+        if( !med->shock || ( mag > med->shockPeak ) )
+        {
+            med->shockPeak = mag;
+            med->shockTime = time;
+        }
+        med->shock = true;
+    }
+    else if( med->shock && ( mag < med->shockThreshold - med->shockThreshold / 8 ) )
+    {
+        eventAdd( events, &count, MOTION_EVENT_SHOCK, med->shockPeak, med->shockTime );
+        med->shock = false;
+    }
+
+    if( mag < med->freefallThreshold )
+    {
+        if( med->freefallCnt == 0 || mag < med->freefallMin )
+        {
+            med->freefallMin = mag;
+        }
+        if( med->freefallCnt == 0 )
+        {
+            med->freefallTime = time;
+        }
+        if( med->freefallCnt < UINT16_MAX && ++med->freefallCnt == med->freefallSamples )
+        {
+            eventAdd( events, &count, MOTION_EVENT_FREEFALL, med->freefallMin, med->freefallTime );
+        }
+    }
+    else
+    {
+        med->freefallCnt = 0;
+    }
+
+    return count;
+}
@@ -0,0 +1,117 @@
+///-----------------------------------------------------------------------------
+///
+/// @file motion_event.h
+///
+/// @brief Tap, double tap, shock and free-fall detector
+///
+/// Works on the accelerometer samples in mg, one at a time:
+///
+///   tap         A short pulse of the acceleration without gravity, which is
+///               tracked by a low pass filter. Followed by a second pulse
+///               within the double tap window, it is a double tap instead.
+///               Pulses that last too long are movement, not taps.
+///   shock       The magnitude of the acceleration above the shock threshold.
+///               Reported once it drops below again, with the peak.
+///   free-fall   The magnitude below the free-fall threshold for a while.
+///               Reported once, with the lowest magnitude so far.
+///
+/// Events carry the time of the sample they are timed from, the first tap,
+/// the shock peak and the start of the free-fall, in the caller's units.
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#ifndef UNCANNIER_MOTION_EVENT_H_
+#define UNCANNIER_MOTION_EVENT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Event types, also used as masks
+#define MOTION_EVENT_TAP            0x01
+#define MOTION_EVENT_DOUBLE_TAP     0x02
+#define MOTION_EVENT_SHOCK          0x04
+#define MOTION_EVENT_FREEFALL       0x08
+
+/// Max events from one sample
+#define MOTION_EVENT_MAX            3
+
+/// Default thresholds in mg
+#define MOTION_EVENT_TAP_MG         1500
+#define MOTION_EVENT_SHOCK_MG       6000
+#define MOTION_EVENT_FREEFALL_MG    350
+
+/// Timing in ms
+#define MOTION_EVENT_TAP_MAX_MS     50  ///< Max tap pulse duration
+#define MOTION_EVENT_TAP_QUIET_MS   80  ///< Ringing ignored after a tap
+#define MOTION_EVENT_TAP_WINDOW_MS  300 ///< Time for a second tap after that
+#define MOTION_EVENT_FREEFALL_MS    100 ///< Min free-fall duration
+
+/// Gravity filter moves 1/2^n of the way to each sample
+#define MOTION_EVENT_GRAVITY_SHIFT  4
+
+typedef struct
+{
+    uint8_t type;
+    uint16_t magnitude;     ///< Peak in mg, lowest for free-fall
+    uint32_t time;
+} MotionEvent_t;
+
+typedef enum
+{
+    motionEventTapIdle,
+    motionEventTapPulse,
+    motionEventTapQuiet,
+    motionEventTapWindow,
+    motionEventTapReject,
+} MotionEventTapState_t;
+
+typedef struct
+{
+    // Config
+    uint16_t tapThreshold;
+    uint16_t shockThreshold;
+    uint16_t freefallThreshold;
+    uint16_t tapMaxSamples;
+    uint16_t tapQuietSamples;
+    uint16_t tapWindowSamples;
+    uint16_t freefallSamples;
+
+    // Gravity in mg << MOTION_EVENT_GRAVITY_SHIFT
+    int32_t gravity[3];
+    bool gravityValid;
+
+    MotionEventTapState_t tapState;
+    uint8_t tapCount;
+    uint16_t tapCnt;
+    uint16_t tapPeak;
+    uint32_t tapTime;
+    uint16_t pulsePeak;
+    uint32_t pulseTime;
+    bool pulseShock;
+
+    bool shock;
+    uint16_t shockPeak;
+    uint32_t shockTime;
+
+    uint16_t freefallCnt;
+    uint16_t freefallMin;
+    uint32_t freefallTime;
+} MotionEventDetector_t;
+
+void motionEventReset( MotionEventDetector_t *med, uint16_t freq );
+void motionEventSetFreq( MotionEventDetector_t *med, uint16_t freq );
+void motionEventSetThresholds( MotionEventDetector_t *med, uint16_t tapMg, uint16_t shockMg );
+uint8_t motionEventUpdate( MotionEventDetector_t *med, const int32_t acc[3], uint32_t time,
+                           MotionEvent_t events[MOTION_EVENT_MAX] );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UNCANNIER_MOTION_EVENT_H_
@@ -0,0 +1,264 @@
+///-----------------------------------------------------------------------------
+///
+/// @file notify_filter.c
+///
+/// @brief Notification filter
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include "notify_filter.h"
+#include <stddef.h>
+#include <string.h>
+#include "gatt_db.h"
+#include "native_gecko.h"
+#include "em_rtcc.h"
+
+// Times are RTCC ticks, which wrap after 36 hours. That only matters if
+// nothing has been sent for that long, and then only delays the next value.
+#define RTCC_FREQ               32768
+
+// Token bucket units per notification
+#define TOKEN                   1000
+
+typedef enum
+{
+    notifyFilterInt16,
+    notifyFilterUint8,
+    // Counters, bitfields or events, where the difference between values means nothing
+    notifyFilterOpaque,
+} NotifyFilterType_t;
+
+typedef struct
+{
+    uint16_t characteristic;
+    NotifyFilterType_t type;
+    uint8_t header;             // Leading bytes left out of the deadband, e.g. a timestamp
+    NotifyFilterConfig_t config;
+    bool sent;
+    uint8_t length;
+    uint8_t value[NOTIFY_FILTER_VALUE_MAX];
+    uint32_t sentTime;
+    uint32_t tokens;
+    uint32_t refillTime;
+} NotifyFilter_t;
+
+static NotifyFilter_t filters[] =
+{
+    { .characteristic = gattdb_accor_acceleration, .type = notifyFilterInt16 },
+    { .characteristic = gattdb_accor_orientation, .type = notifyFilterInt16 },
+    { .characteristic = gattdb_accor_motion, .type = notifyFilterInt16, .header = 4 },
+    { .characteristic = gattdb_accor_linear, .type = notifyFilterInt16, .header = 4 },
+    { .characteristic = gattdb_accor_event, .type = notifyFilterOpaque },
+    { .characteristic = gattdb_cycling_speed_measurement, .type = notifyFilterOpaque },
+    { .characteristic = gattdb_battery_measurement, .type = notifyFilterUint8 },
+    { .characteristic = gattdb_aio_digital_in, .type = notifyFilterOpaque },
+};
+
+#define FILTERS_SIZE            ( sizeof( filters ) / sizeof( filters[0] ) )
+
+static NotifyFilter_t *filterFind( uint16_t characteristic )
+{
+    for( uint8_t i = 0; i < FILTERS_SIZE; i++ )
+    {
+        if( filters[i].characteristic == characteristic )
+        {
+            return &filters[i];
+        }
+    }
+    return NULL;
+}
+
+static uint32_t ticksToMs( uint32_t ticks )
+{
+    return (uint32_t)( (uint64_t)ticks * 1000 / RTCC_FREQ );
+}
+
+static int32_t element( const NotifyFilter_t *filter, const uint8_t *value, uint8_t n )
+{
+    if( filter->type == notifyFilterInt16 )
+    {
+        return (int16_t)(uint16_t)( value[2 * n] | ( value[2 * n + 1] << 8 ) );
+    }
+    return value[n];
+}
+
+static bool deadbandExceeded( const NotifyFilter_t *filter, uint8_t length, const uint8_t *value )
+{
+    uint8_t count;
+
+    if( length != filter->length || length > NOTIFY_FILTER_VALUE_MAX || length < filter->header )
+    {
+        return true;
+    }
+    length -= filter->header;
+    count = ( filter->type == notifyFilterInt16 ) ? length / 2 : length;
+
+    for( uint8_t n = 0; n < count; n++ )
+    {
+        int32_t last = element( filter, &filter->value[filter->header], n );
+        int32_t diff = element( filter, &value[filter->header], n ) - last;
+        uint32_t magnitude = (uint32_t)( ( diff < 0 ) ? -diff : diff );
+        uint32_t relative = (uint32_t)( ( last < 0 ) ? -last : last ) * filter->config.deadbandRel / 1000;
+
+        // Exceeding either deadband is enough, with no deadband any change is
+        if( ( filter->config.deadbandAbs && ( magnitude > filter->config.deadbandAbs ) )
+            || ( filter->config.deadbandRel && ( magnitude > relative ) )
+            || ( !filter->config.deadbandAbs && !filter->config.deadbandRel && magnitude ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Refill the bucket, up to a second of notifications
+static void tokensRefill( NotifyFilter_t *filter, uint32_t now )
+{
+    uint32_t max = (uint32_t)filter->config.maxRate * TOKEN;
+    uint64_t tokens = filter->tokens
+                      + (uint64_t)( now - filter->refillTime ) * filter->config.maxRate * TOKEN / RTCC_FREQ;
+
+    filter->tokens = ( tokens > max ) ? max : (uint32_t)tokens;
+    filter->refillTime = now;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Send a notification, unless the characteristic's filter holds it
+///         back. The filter only counts values the stack accepted as sent.
+///
+/// @param[in]  connection - Connection handle
+/// @param[in]  characteristic - Characteristic handle
+/// @param[in]  length - Value length
+/// @param[in]  value - Value
+///
+/// @return True if the notification was sent
+///
+///-----------------------------------------------------------------------------
+bool notifyFilterSend( uint8_t connection, uint16_t characteristic, uint8_t length, const uint8_t *value )
+{
+    return notifyFilterSendAt( connection, characteristic, length, value, RTCC_CounterGet() );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  As notifyFilterSend(), at a given time
+///
+/// @param[in]  now - RTCC ticks
+///
+/// @return True if the notification was sent
+///
+///-----------------------------------------------------------------------------
+bool notifyFilterSendAt( uint8_t connection, uint16_t characteristic, uint8_t length, const uint8_t *value,
+                         uint32_t now )
+{
+    NotifyFilter_t *filter = filterFind( characteristic );
+
+    if( filter && filter->sent )
+    {
+        if( ( filter->config.flags & NOTIFY_FILTER_DEADBAND ) && !deadbandExceeded( filter, length, value ) )
+        {
+            return false;
+        }
+        if( filter->config.minIntervalMs && ( ticksToMs( now - filter->sentTime ) < filter->config.minIntervalMs ) )
+        {
+            return false;
+        }
+        if( filter->config.maxRate )
+        {
+            tokensRefill( filter, now );
+            if( filter->tokens < TOKEN )
+            {
+                return false;
+            }
+        }
+    }
+
+    if( gecko_cmd_gatt_server_send_characteristic_notification( connection, characteristic, length, value )->result )
+    {
+        return false;
+    }
+
+    if( filter )
+    {
+        if( !filter->sent )
+        {
+            filter->tokens = (uint32_t)filter->config.maxRate * TOKEN;
+            filter->refillTime = now;
+        }
+        if( filter->config.maxRate )
+        {
+            filter->tokens -= TOKEN;
+        }
+        filter->sent = true;
+        filter->sentTime = now;
+        filter->length = length;
+        if( length <= NOTIFY_FILTER_VALUE_MAX )
+        {
+            memcpy( filter->value, value, length );
+        }
+    }
+    return true;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Configure the filter of a characteristic. The next value is sent
+///         regardless, as the reference for the deadband.
+///
+/// @param[in]  characteristic - Characteristic handle
+/// @param[in]  config - Filter config
+///
+/// @return False if the characteristic has no filter, or takes no deadband
+///
+///-----------------------------------------------------------------------------
+bool notifyFilterConfigure( uint16_t characteristic, const NotifyFilterConfig_t *config )
+{
+    NotifyFilter_t *filter = filterFind( characteristic );
+
+    if( filter == NULL )
+    {
+        return false;
+    }
+    if( ( filter->type == notifyFilterOpaque ) && ( config->flags & NOTIFY_FILTER_DEADBAND ) )
+    {
+        return false;
+    }
+    filter->config = *config;
+    filter->sent = false;
+    return true;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Restart the filter of a characteristic, e.g. when a client enables
+///         notifications, so that the next value is sent regardless
+///
+/// @param[in]  characteristic - Characteristic handle
+///
+///-----------------------------------------------------------------------------
+void notifyFilterRestart( uint16_t characteristic )
+{
+    NotifyFilter_t *filter = filterFind( characteristic );
+
+    if( filter )
+    {
+        filter->sent = false;
+    }
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Put all filters back to passing everything, for a new connection
+///
+///-----------------------------------------------------------------------------
+void notifyFilterReset( void )
+{
+    for( uint8_t i = 0; i < FILTERS_SIZE; i++ )
+    {
+        memset( &filters[i].config, 0, sizeof( filters[i].config ) );
+        filters[i].sent = false;
+    }
+}
@@ -0,0 +1,65 @@
+///-----------------------------------------------------------------------------
+///
+/// @file notify_filter.h
+///
+/// @brief Notification filter
+///
+/// Sits between the services and the stack, and decides per characteristic
+/// whether a new value is worth the radio time. A value is sent if it is the
+/// first since the connection opened or the filter was configured, and it
+/// passes all of the enabled checks:
+///
+///   deadband      Any element differs from the last value sent by more than
+///                 the absolute deadband, or by more than the relative
+///                 deadband in permille of the last value sent. A deadband
+///                 of 0 is off, with both off any change is sent
+///   min interval  At least this long since the last value sent
+///   max rate      A token bucket holding up to a second of notifications
+///
+/// Values are compared element by element, as int16 or uint8 depending on the
+/// characteristic, after any timestamp at the start. Characteristics holding
+/// counters, bitfields or events, i.e. cycling speed, digital inputs and
+/// motion events, take no deadband, only the min interval and max rate. All
+/// characteristics pass everything until configured.
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#ifndef UNCANNIER_NOTIFY_FILTER_H_
+#define UNCANNIER_NOTIFY_FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Config flags
+#define NOTIFY_FILTER_DEADBAND      0x01
+
+/// Max length of a value to be compared, longer values skip the deadband
+#define NOTIFY_FILTER_VALUE_MAX     20
+
+typedef struct
+{
+    uint8_t flags;
+    uint16_t deadbandAbs;   ///< In units of the characteristic value
+    uint16_t deadbandRel;   ///< In permille of the last value sent
+    uint16_t minIntervalMs; ///< 0 for no min interval
+    uint8_t maxRate;        ///< Notifications per second, 0 for no max rate
+} NotifyFilterConfig_t;
+
+bool notifyFilterSend( uint8_t connection, uint16_t characteristic, uint8_t length, const uint8_t *value );
+bool notifyFilterSendAt( uint8_t connection, uint16_t characteristic, uint8_t length, const uint8_t *value,
+                         uint32_t now );
+bool notifyFilterConfigure( uint16_t characteristic, const NotifyFilterConfig_t *config );
+void notifyFilterRestart( uint16_t characteristic );
+void notifyFilterReset( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UNCANNIER_NOTIFY_FILTER_H_
@@ -0,0 +1,243 @@
+///-----------------------------------------------------------------------------
+///
+/// @file spectrum.c
+///
+/// @brief Vibration spectrum summary
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <math.h>
+#include "spectrum.h"
+
+#define PI                      3.14159265358979f
+
+// Hann window gains: the mean, which scales the amplitude of a sinusoid, and
+// the mean square, which scales the power
+#define HANN_AMPLITUDE_GAIN     0.5f
+#define HANN_POWER_GAIN         0.375f
+
+static uint16_t saturate( float value )
+{
+    if( value >= UINT16_MAX )
+    {
+        return UINT16_MAX;
+    }
+    return ( value > 0 ) ? (uint16_t)( value + 0.5f ) : 0;
+}
+
+// In place, iterative decimation in time, over n complex values stored as
+// real and imaginary pairs
+static void fft( float *z, uint16_t n )
+{
+    uint16_t j = 0;
+
+    for( uint16_t i = 0; i < n - 1; i++ )
+    {
+        uint16_t bit = n >> 1;
+
+        if( i < j )
+        {
+            float t = z[2 * i];
+
+            z[2 * i] = z[2 * j];
+            z[2 * j] = t;
+            t = z[2 * i + 1];
+            z[2 * i + 1] = z[2 * j + 1];
+            z[2 * j + 1] = t;
+        }
+        while( j & bit )
+        {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+    }
+
+    for( uint16_t size = 2; size <= n; size <<= 1 )
+    {
+        uint16_t half = size >> 1;
+        float step = -2 * PI / size;
+
+        for( uint16_t k = 0; k < half; k++ )
+        {
+            float wr = cosf( step * k );
+            float wi = sinf( step * k );
+
+            for( uint16_t i = k; i < n; i += size )
+            {
+                uint16_t m = i + half;
+                float tr = wr * z[2 * m] - wi * z[2 * m + 1];
+                float ti = wr * z[2 * m + 1] + wi * z[2 * m];
+
+                z[2 * m] = z[2 * i] - tr;
+                z[2 * m + 1] = z[2 * i + 1] - ti;
+                z[2 * i] += tr;
+                z[2 * i + 1] += ti;
+            }
+        }
+    }
+}
+
+// Bin magnitudes 0 to n / 2 of n real values, into the first n / 2 + 1
+// values. The FFT runs over the even and odd samples as n / 2 complex values,
+// which are then untangled. Bins k and n / 2 - k come from the same pair of
+// complex values, so their magnitudes are stored in place of the pair.
+static void realMagnitudes( float *z, uint16_t n )
+{
+    uint16_t half = n / 2;
+    float nyquist;
+
+    fft( z, half );
+
+    nyquist = fabsf( z[0] - z[1] );
+    z[0] = fabsf( z[0] + z[1] );
+    for( uint16_t k = 1; k <= half / 2; k++ )
+    {
+        uint16_t m = half - k;
+        // The spectra of the even and the odd samples
+        float er = 0.5f * ( z[2 * k] + z[2 * m] );
+        float ei = 0.5f * ( z[2 * k + 1] - z[2 * m + 1] );
+        float odr = 0.5f * ( z[2 * k + 1] + z[2 * m + 1] );
+        float odi = -0.5f * ( z[2 * k] - z[2 * m] );
+        float wr = cosf( -PI * k / half );
+        float wi = sinf( -PI * k / half );
+        float tr = wr * odr - wi * odi;
+        float ti = wr * odi + wi * odr;
+
+        z[2 * k] = sqrtf( ( er + tr ) * ( er + tr ) + ( ei + ti ) * ( ei + ti ) );
+        z[2 * m] = sqrtf( ( er - tr ) * ( er - tr ) + ( ei - ti ) * ( ei - ti ) );
+    }
+
+    for( uint16_t k = 1; k < half; k++ )
+    {
+        z[k] = z[2 * k];
+    }
+    z[half] = nyquist;
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Check a window length
+///
+/// @param[in]  n - Number of samples
+///
+/// @return True if a power of two within the limits
+///
+///-----------------------------------------------------------------------------
+bool spectrumValidLength( uint16_t n )
+{
+    return ( n >= SPECTRUM_MIN_SAMPLES ) && ( n <= SPECTRUM_MAX_SAMPLES ) && ( ( n & ( n - 1 ) ) == 0 );
+}
+
+///-----------------------------------------------------------------------------
+///
+/// @brief  Sum up the spectrum of a window of samples
+///
+/// @param[in]  work - The window, e.g. in mg, in work->x[0] to work->x[n - 1].
+///                    Overwritten.
+/// @param[in]  n - Number of samples
+/// @param[in]  freq - Sample rate in Hz
+/// @param[out] spectrum - Summary, in the units of the samples
+///
+/// @return False if the window length is not valid
+///
+///-----------------------------------------------------------------------------
+bool spectrumCompute( SpectrumWork_t *work, uint16_t n, uint16_t freq, Spectrum_t *spectrum )
+{
+    float *x = work->x;
+    uint16_t half = n / 2;
+    uint16_t bandBins = half / SPECTRUM_BANDS;
+    float mean = 0;
+    float sumSq = 0;
+    // The window, bin count and one sided spectrum scale the bin power
+    float powerScale = 2 / ( (float)n * n * HANN_POWER_GAIN );
+    float amplitudeScale = 2 / ( n * HANN_AMPLITUDE_GAIN );
+    uint8_t peaks = 0;
+
+    if( !spectrumValidLength( n ) )
+    {
+        return false;
+    }
+
+    for( uint16_t i = 0; i < n; i++ )
+    {
+        mean += x[i];
+    }
+    mean /= n;
+
+    for( uint16_t i = 0; i < n; i++ )
+    {
+        float v = x[i] - mean;
+
+        sumSq += v * v;
+        x[i] = v * 0.5f * ( 1 - cosf( 2 * PI * i / n ) );
+    }
+    spectrum->rms = saturate( sqrtf( sumSq / n ) );
+
+    // Bin magnitudes from here on, over the first half
+    realMagnitudes( x, n );
+
+    for( uint8_t b = 0; b < SPECTRUM_BANDS; b++ )
+    {
+        float power = 0;
+
+        for( uint16_t k = b * bandBins; k < ( b + 1 ) * bandBins; k++ )
+        {
+            // DC is gone with the mean, and its window leakage is no vibration
+            if( k > 1 )
+            {
+                power += x[k] * x[k];
+            }
+        }
+        spectrum->band[b] = saturate( sqrtf( power * powerScale ) );
+    }
+
+    for( uint8_t p = 0; p < SPECTRUM_PEAKS; p++ )
+    {
+        spectrum->peakFreq[p] = 0;
+        spectrum->peakAmplitude[p] = 0;
+    }
+
+    // Insert each local maximum into the peaks, largest first
+    for( uint16_t k = 2; k < half; k++ )
+    {
+        float a = x[k - 1];
+        float b = x[k];
+        float c = x[k + 1];
+        float delta;
+        uint16_t amplitude;
+        uint8_t p;
+
+        if( ( b <= a ) || ( b < c ) )
+        {
+            continue;
+        }
+        amplitude = saturate( b * amplitudeScale );
+        if( amplitude == 0 )
+        {
+            continue;
+        }
+        for( p = peaks; ( p > 0 ) && ( spectrum->peakAmplitude[p - 1] < amplitude ); p-- )
+        {
+            if( p < SPECTRUM_PEAKS )
+            {
+                spectrum->peakFreq[p] = spectrum->peakFreq[p - 1];
+                spectrum->peakAmplitude[p] = spectrum->peakAmplitude[p - 1];
+            }
+        }
+        if( p < SPECTRUM_PEAKS )
+        {
+            delta = 0.5f * ( a - c ) / ( a - 2 * b + c );
+            spectrum->peakFreq[p] = saturate( ( k + delta ) * freq * 10 / n );
+            spectrum->peakAmplitude[p] = amplitude;
+            if( peaks < SPECTRUM_PEAKS )
+            {
+                peaks++;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,56 @@
+///-----------------------------------------------------------------------------
+///
+/// @file spectrum.h
+///
+/// @brief Vibration spectrum summary
+///
+/// Takes a window of acceleration samples, removes the mean, applies a Hann
+/// window and runs a radix-2 FFT, as a half length complex FFT of the real
+/// samples. The spectrum is summed up as the RMS in SPECTRUM_BANDS equal bands
+/// from 0 Hz to half the sample rate, and as the SPECTRUM_PEAKS largest peaks,
+/// with the frequency interpolated between bins.
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#ifndef UNCANNIER_SPECTRUM_H_
+#define UNCANNIER_SPECTRUM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Window length limits, powers of two only
+#define SPECTRUM_MIN_SAMPLES        32
+#define SPECTRUM_MAX_SAMPLES        256
+
+#define SPECTRUM_BANDS              8
+#define SPECTRUM_PEAKS              4
+
+/// The window is collected straight into the working memory, and the FFT runs
+/// in place over it as SPECTRUM_MAX_SAMPLES / 2 complex values
+typedef struct
+{
+    float x[SPECTRUM_MAX_SAMPLES];
+} SpectrumWork_t;
+
+typedef struct
+{
+    uint16_t rms;                           ///< Whole window, mean removed
+    uint16_t band[SPECTRUM_BANDS];          ///< RMS per band
+    uint16_t peakFreq[SPECTRUM_PEAKS];      ///< In 0.1 Hz, largest first
+    uint16_t peakAmplitude[SPECTRUM_PEAKS]; ///< 0 if fewer peaks
+} Spectrum_t;
+
+bool spectrumValidLength( uint16_t n );
+bool spectrumCompute( SpectrumWork_t *work, uint16_t n, uint16_t freq, Spectrum_t *spectrum );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UNCANNIER_SPECTRUM_H_
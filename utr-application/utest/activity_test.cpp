@@ -0,0 +1,117 @@
+///-----------------------------------------------------------------------------
+///
+/// @file activity_test.cpp
+///
+/// @brief Tests for the activity classifier
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <CppUTest/TestHarness.h>
+#include <activity.h>
+
+static ActivityClassifier_t ac;
+static double simTime;
+static std::vector<uint8_t> simChanges;
+
+// Gravity on Z plus a vibration along the given axis, in mg
+static void simVibration( int axis, double freq, double amplitude, int noise, int ms )
+{
+    int samples = ms * ACTIVITY_FREQ / 1000;
+
+    for( int n = 0; n < samples; n++ )
+    {
+        int32_t acc[3] = { 0, 0, 1000 };
+
+        acc[axis] += (int32_t)lround( amplitude * sin( 2 * M_PI * freq * simTime ) );
+        for( int i = 0; i < 3; i++ )
+        {
+            acc[i] += ( rand() % ( 2 * noise + 1 ) ) - noise;
+        }
+        if( activityUpdate( &ac, acc ) )
+        {
+            simChanges.push_back( ac.activity );
+        }
+        simTime += 1.0 / ACTIVITY_FREQ;
+    }
+}
+
+TEST_GROUP( activity )
+{
+    void setup()
+    {
+        srand( 1 );
+        activityReset( &ac );
+        simTime = 0;
+        simChanges.clear();
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST( activity, Idle )
+{
+    LONGS_EQUAL( ACTIVITY_UNKNOWN, ac.activity );
+    simVibration( 2, 0, 0, 5, 60000 );
+
+    // Reported once, straight after the first window
+    LONGS_EQUAL( 1, simChanges.size() );
+    LONGS_EQUAL( ACTIVITY_IDLE, simChanges[0] );
+    CHECK( abs( ac.features.mean - 1000 ) <= 5 );
+}
+
+TEST( activity, Walk )
+{
+    simVibration( 2, 1.8, 300, 10, 20000 );
+
+    LONGS_EQUAL( ACTIVITY_WALK, ac.activity );
+    CHECK( abs( ac.features.crossings - 36 ) <= 4 );
+    CHECK( abs( ac.features.deviation - 212 ) <= 30 );
+}
+
+TEST( activity, Vehicle )
+{
+    simVibration( 2, 9, 50, 5, 20000 );
+    LONGS_EQUAL( ACTIVITY_VEHICLE, ac.activity );
+
+    // A rough road
+    simVibration( 0, 8, 120, 5, 20000 );
+    LONGS_EQUAL( ACTIVITY_VEHICLE, ac.activity );
+    LONGS_EQUAL( 1, simChanges.size() );
+}
+
+TEST( activity, Shake )
+{
+    simVibration( 0, 5, 400, 10, 20000 );
+    LONGS_EQUAL( ACTIVITY_SHAKE, ac.activity );
+
+    simVibration( 1, 4, 1500, 10, 20000 );
+    LONGS_EQUAL( ACTIVITY_SHAKE, ac.activity );
+    LONGS_EQUAL( 1, simChanges.size() );
+}
+
+TEST( activity, NeedsConfirming )
+{
+    simVibration( 2, 0, 0, 5, 10000 );
+    LONGS_EQUAL( ACTIVITY_IDLE, ac.activity );
+
+    // A single window of shaking is not enough
+    simVibration( 0, 5, 1500, 10, ACTIVITY_WINDOW_SAMPLES * 1000 / ACTIVITY_FREQ );
+    simVibration( 2, 0, 0, 5, 10000 );
+    LONGS_EQUAL( 1, simChanges.size() );
+
+    simVibration( 0, 5, 1500, 10, 10000 );
+    LONGS_EQUAL( 2, simChanges.size() );
+    LONGS_EQUAL( ACTIVITY_SHAKE, simChanges[1] );
+
+    simVibration( 2, 0, 0, 5, 10000 );
+    LONGS_EQUAL( 3, simChanges.size() );
+    LONGS_EQUAL( ACTIVITY_IDLE, simChanges[2] );
+}
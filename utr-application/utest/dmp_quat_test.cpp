@@ -0,0 +1,193 @@
+///-----------------------------------------------------------------------------
+///
+/// @file dmp_quat_test.cpp
+///
+/// @brief Tests for the DMP quaternion packet parsing and conversions
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <CppUTest/TestHarness.h>
+#include <dmp_quat.h>
+
+#define TOLERANCE           1e-5
+
+// A packet as the DMP writes it, big endian Q30
+static void packetMake( const double q[4], uint8_t packet[DMP_QUAT_PACKET_SIZE] )
+{
+    for( int i = 0; i < 4; i++ )
+    {
+        uint32_t value = (uint32_t)(int32_t)lround( q[i] * DMP_QUAT_ONE );
+
+        packet[4 * i] = (uint8_t)( value >> 24 );
+        packet[4 * i + 1] = (uint8_t)( value >> 16 );
+        packet[4 * i + 2] = (uint8_t)( value >> 8 );
+        packet[4 * i + 3] = (uint8_t)value;
+    }
+}
+
+// Rotation of angle radians about a unit axis
+static void quatAxisAngle( double x, double y, double z, double angle, double q[4] )
+{
+    q[0] = cos( angle / 2 );
+    q[1] = x * sin( angle / 2 );
+    q[2] = y * sin( angle / 2 );
+    q[3] = z * sin( angle / 2 );
+}
+
+// q and -q are the same rotation
+static void checkSameRotation( const double expected[4], const float q[4] )
+{
+    double sign = ( expected[0] * q[0] + expected[1] * q[1] + expected[2] * q[2] + expected[3] * q[3] ) < 0 ? -1 : 1;
+
+    for( int i = 0; i < 4; i++ )
+    {
+        DOUBLES_EQUAL( expected[i], sign * q[i], TOLERANCE );
+    }
+}
+
+TEST_GROUP( dmp_quat )
+{
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST( dmp_quat, Parse )
+{
+    const uint8_t packet[DMP_QUAT_PACKET_SIZE] =
+    {
+        0x40, 0x00, 0x00, 0x00,
+        0xE0, 0x00, 0x00, 0x00,
+        0x12, 0x34, 0x56, 0x78,
+        0xFF, 0xFF, 0xFF, 0xFF
+    };
+    int32_t q[4];
+
+    dmpQuatParse( packet, q );
+    LONGS_EQUAL( DMP_QUAT_ONE, q[0] );
+    LONGS_EQUAL( -DMP_QUAT_ONE / 2, q[1] );
+    LONGS_EQUAL( 0x12345678, q[2] );
+    LONGS_EQUAL( -1, q[3] );
+}
+
+TEST( dmp_quat, ParseInPlace )
+{
+    const double expected[4] = { 0.5, -0.5, 0.5, -0.5 };
+    int32_t q[4];
+
+    packetMake( expected, (uint8_t *)q );
+    dmpQuatParse( (const uint8_t *)q, q );
+    for( int i = 0; i < 4; i++ )
+    {
+        LONGS_EQUAL( lround( expected[i] * DMP_QUAT_ONE ), q[i] );
+    }
+}
+
+TEST( dmp_quat, Valid )
+{
+    double q[4];
+    uint8_t packet[DMP_QUAT_PACKET_SIZE];
+    int32_t parsed[4];
+
+    quatAxisAngle( 0.6, 0, 0.8, 1.0, q );
+    packetMake( q, packet );
+    dmpQuatParse( packet, parsed );
+    CHECK( dmpQuatValid( parsed ) );
+
+    // A few percent off is still the DMP's
+    parsed[0] = parsed[0] / 100 * 102;
+    CHECK( dmpQuatValid( parsed ) );
+
+    // Nothing at all
+    memset( parsed, 0, sizeof( parsed ) );
+    CHECK( !dmpQuatValid( parsed ) );
+}
+
+TEST( dmp_quat, OutOfStep )
+{
+    uint8_t packets[2 * DMP_QUAT_PACKET_SIZE];
+    double q[4];
+    int32_t parsed[4];
+    int invalid = 0;
+
+    quatAxisAngle( 0, 0.6, 0.8, 2.0, q );
+    packetMake( q, packets );
+    quatAxisAngle( 1, 0, 0, -0.7, q );
+    packetMake( q, &packets[DMP_QUAT_PACKET_SIZE] );
+
+    // Read from any offset but a packet boundary, the result isn't a rotation
+    for( int offset = 1; offset < DMP_QUAT_PACKET_SIZE; offset++ )
+    {
+        dmpQuatParse( &packets[offset], parsed );
+        if( !dmpQuatValid( parsed ) )
+        {
+            invalid++;
+        }
+    }
+    LONGS_EQUAL( DMP_QUAT_PACKET_SIZE - 1, invalid );
+}
+
+TEST( dmp_quat, ToMatrix )
+{
+    double q[4];
+    uint8_t packet[DMP_QUAT_PACKET_SIZE];
+    int32_t parsed[4];
+    float r[3][3];
+
+    // 90 deg about z takes x to y and y to -x
+    quatAxisAngle( 0, 0, 1, M_PI / 2, q );
+    packetMake( q, packet );
+    dmpQuatParse( packet, parsed );
+    dmpQuatToMatrix( parsed, r );
+
+    const double expected[3][3] = { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } };
+
+    for( int i = 0; i < 3; i++ )
+    {
+        for( int j = 0; j < 3; j++ )
+        {
+            DOUBLES_EQUAL( expected[i][j], r[i][j], TOLERANCE );
+        }
+    }
+}
+
+TEST( dmp_quat, RoundTrip )
+{
+    // Including half turns about each axis, for each branch of the conversion
+    const double rotations[][4] =
+    {
+        { 0, 0, 1, 0.3 },
+        { 0.48, 0.6, 0.64, -1.9 },
+        { 1, 0, 0, M_PI },
+        { 0, 1, 0, M_PI },
+        { 0, 0, 1, M_PI },
+        { 0.8, 0, -0.6, 3.0 },
+        { 0, -0.6, 0.8, 2.9 },
+    };
+
+    for( unsigned n = 0; n < sizeof( rotations ) / sizeof( rotations[0] ); n++ )
+    {
+        double q[4];
+        uint8_t packet[DMP_QUAT_PACKET_SIZE];
+        int32_t parsed[4];
+        float r[3][3];
+        float back[4];
+
+        quatAxisAngle( rotations[n][0], rotations[n][1], rotations[n][2], rotations[n][3], q );
+        packetMake( q, packet );
+        dmpQuatParse( packet, parsed );
+        CHECK( dmpQuatValid( parsed ) );
+        dmpQuatToMatrix( parsed, r );
+        dmpQuatFromMatrix( r, back );
+        checkSameRotation( q, back );
+    }
+}
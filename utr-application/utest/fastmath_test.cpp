@@ -0,0 +1,116 @@
+///-----------------------------------------------------------------------------
+///
+/// @file fastmath_test.cpp
+///
+/// @brief Tests for the fast trig approximations, checking the error bound
+///        over the input domain and reporting the speed against libm
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <chrono>
+#include <cmath>
+#include <CppUTest/TestHarness.h>
+#include <fastmath.h>
+
+// Number of calls timed for the throughput report
+#define TIMED_CALLS         1000000
+
+static double angleDiff( double a, double b )
+{
+    double diff = fmod( a - b + 3 * M_PI, 2 * M_PI ) - M_PI;
+
+    return fabs( diff );
+}
+
+// Nanoseconds per call of func over a spread of inputs
+template<typename Func> static double timeCalls( Func func )
+{
+    volatile float sink = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for( int i = 0; i < TIMED_CALLS; i++ )
+    {
+        sink = sink + func( ( i % 2001 - 1000 ) / 1000.0f );
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>( end - start ).count() / TIMED_CALLS;
+}
+
+TEST_GROUP( fastmath )
+{
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST( fastmath, AsinErrorBound )
+{
+    double maxError = 0;
+
+    for( int i = -100000; i <= 100000; i++ )
+    {
+        float x = i / 100000.0f;
+
+        maxError = fmax( maxError, fabs( (double)fastAsinf( x ) - asin( (double)x ) ) );
+    }
+
+    UT_PRINT( StringFromFormat( "fastAsinf max error %.2e rad", maxError ).asCharString() );
+    CHECK( maxError <= FASTMATH_TRIG_MAX_ERROR );
+}
+
+TEST( fastmath, AsinClampsInput )
+{
+    DOUBLES_EQUAL( M_PI / 2, fastAsinf( 1.5f ), FASTMATH_TRIG_MAX_ERROR );
+    DOUBLES_EQUAL( -M_PI / 2, fastAsinf( -1.5f ), FASTMATH_TRIG_MAX_ERROR );
+}
+
+TEST( fastmath, Atan2ErrorBound )
+{
+    double maxError = 0;
+
+    for( int i = 0; i < 36000; i++ )
+    {
+        double angle = ( i - 18000 ) * M_PI / 18000;
+
+        for( double radius = 1e-3; radius < 1e3; radius *= 10 )
+        {
+            float y = (float)( radius * sin( angle ) );
+            float x = (float)( radius * cos( angle ) );
+            double error = angleDiff( fastAtan2f( y, x ), atan2( (double)y, (double)x ) );
+
+            maxError = fmax( maxError, error );
+        }
+    }
+
+    UT_PRINT( StringFromFormat( "fastAtan2f max error %.2e rad", maxError ).asCharString() );
+    CHECK( maxError <= FASTMATH_TRIG_MAX_ERROR );
+}
+
+TEST( fastmath, Atan2Axes )
+{
+    DOUBLES_EQUAL( 0, fastAtan2f( 0.0f, 0.0f ), 0 );
+    DOUBLES_EQUAL( 0, fastAtan2f( 0.0f, 1.0f ), FASTMATH_TRIG_MAX_ERROR );
+    DOUBLES_EQUAL( M_PI / 2, fastAtan2f( 1.0f, 0.0f ), FASTMATH_TRIG_MAX_ERROR );
+    DOUBLES_EQUAL( M_PI, fastAtan2f( 0.0f, -1.0f ), FASTMATH_TRIG_MAX_ERROR );
+    DOUBLES_EQUAL( -M_PI / 2, fastAtan2f( -1.0f, 0.0f ), FASTMATH_TRIG_MAX_ERROR );
+}
+
+TEST( fastmath, Throughput )
+{
+    double fastAsin = timeCalls( []( float x ) { return fastAsinf( x ); } );
+    double libmAsin = timeCalls( []( float x ) { return asinf( x ); } );
+    double fastAtan2 = timeCalls( []( float x ) { return fastAtan2f( x, 0.5f ); } );
+    double libmAtan2 = timeCalls( []( float x ) { return atan2f( x, 0.5f ); } );
+
+    // Host timings only show the relative cost, so nothing to check here
+    UT_PRINT( StringFromFormat( "asin  %.1f ns fast, %.1f ns libm", fastAsin, libmAsin ).asCharString() );
+    UT_PRINT( StringFromFormat( "atan2 %.1f ns fast, %.1f ns libm", fastAtan2, libmAtan2 ).asCharString() );
+}
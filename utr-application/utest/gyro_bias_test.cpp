@@ -0,0 +1,172 @@
+///-----------------------------------------------------------------------------
+///
+/// @file gyro_bias_test.cpp
+///
+/// @brief Tests for the online gyro bias estimator
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <CppUTest/TestHarness.h>
+#include <gyro_bias.h>
+
+#define WINDOW              100
+
+static GyroBias_t gb;
+static int updates;
+
+static int32_t noise( int amplitude )
+{
+    return ( rand() % ( 2 * amplitude + 1 ) ) - amplitude;
+}
+
+// Gyro rates in 0.01 deg/s on top of the bias, the board flat unless the
+// accelerometer is missing
+static void simWindow( const int32_t bias[3], const int32_t rate[3], int gyrNoise, int accNoise, bool accValid )
+{
+    for( int n = 0; n < WINDOW; n++ )
+    {
+        int32_t gyr[3];
+        int32_t acc[3] = { noise( accNoise ), noise( accNoise ), 1000 + noise( accNoise ) };
+
+        for( int i = 0; i < 3; i++ )
+        {
+            gyr[i] = bias[i] + rate[i] + noise( gyrNoise );
+        }
+        if( gyroBiasUpdate( &gb, gyr, accValid ? acc : NULL ) )
+        {
+            updates++;
+        }
+    }
+}
+
+TEST_GROUP( gyro_bias )
+{
+    void setup()
+    {
+        srand( 1 );
+        gyroBiasReset( &gb, WINDOW );
+        updates = 0;
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST( gyro_bias, Stationary )
+{
+    const int32_t bias[3] = { 120, -80, 30 };
+    const int32_t still[3] = { 0, 0, 0 };
+
+    LONGS_EQUAL( 0, gyroBiasGet( &gb, 0 ) );
+    CHECK( !gb.biasValid );
+
+    simWindow( bias, still, 20, 5, true );
+    LONGS_EQUAL( 1, updates );
+    CHECK( gb.biasValid );
+    for( int i = 0; i < 3; i++ )
+    {
+        CHECK( abs( gyroBiasGet( &gb, i ) - bias[i] ) <= 3 );
+    }
+}
+
+TEST( gyro_bias, Smoothing )
+{
+    const int32_t bias[3] = { 100, -100, 0 };
+    const int32_t still[3] = { 0, 0, 0 };
+    const int32_t drifted[3] = { 200, -200, 0 };
+
+    // The first window is taken as it is, later ones a quarter of the way
+    simWindow( bias, still, 0, 0, true );
+    LONGS_EQUAL( 100, gyroBiasGet( &gb, 0 ) );
+    simWindow( drifted, still, 0, 0, true );
+    LONGS_EQUAL( 125, gyroBiasGet( &gb, 0 ) );
+    LONGS_EQUAL( -125, gyroBiasGet( &gb, 1 ) );
+    LONGS_EQUAL( 0, gyroBiasGet( &gb, 2 ) );
+    LONGS_EQUAL( 2, updates );
+}
+
+TEST( gyro_bias, Rotating )
+{
+    const int32_t bias[3] = { 50, 50, 50 };
+    const int32_t slow[3] = { 0, 0, 1000 };
+
+    // A slow steady rotation is no bias
+    simWindow( bias, slow, 10, 5, true );
+    LONGS_EQUAL( 0, updates );
+    CHECK( !gb.biasValid );
+
+    // Nor is a rotation back and forth that averages out
+    for( int n = 0; n < WINDOW; n++ )
+    {
+        int32_t gyr[3] = { 50, 50, 50 + (int32_t)lround( 300 * sin( 2 * M_PI * n / 25 ) ) };
+        int32_t acc[3] = { 0, 0, 1000 };
+
+        CHECK( !gyroBiasUpdate( &gb, gyr, acc ) );
+    }
+    CHECK( !gb.biasValid );
+    LONGS_EQUAL( 0, gyroBiasGet( &gb, 2 ) );
+}
+
+TEST( gyro_bias, Moving )
+{
+    const int32_t bias[3] = { 50, 50, 50 };
+    const int32_t still[3] = { 0, 0, 0 };
+
+    // The gyro is still but the board is being shaken
+    simWindow( bias, still, 10, 100, true );
+    LONGS_EQUAL( 0, updates );
+    CHECK( !gb.biasValid );
+}
+
+TEST( gyro_bias, AccelerometerMissing )
+{
+    const int32_t bias[3] = { 50, 50, 50 };
+    const int32_t still[3] = { 0, 0, 0 };
+
+    simWindow( bias, still, 10, 5, false );
+    LONGS_EQUAL( 0, updates );
+    CHECK( !gb.biasValid );
+
+    // Missing for one sample of the window is enough to distrust it
+    for( int n = 0; n < WINDOW; n++ )
+    {
+        int32_t gyr[3] = { 50, 50, 50 };
+        int32_t acc[3] = { 0, 0, 1000 };
+
+        CHECK( !gyroBiasUpdate( &gb, gyr, ( n == WINDOW / 2 ) ? NULL : acc ) );
+    }
+
+    // And the next window starts afresh
+    simWindow( bias, still, 10, 5, true );
+    LONGS_EQUAL( 1, updates );
+}
+
+TEST( gyro_bias, SetGet )
+{
+    const int32_t saved[3] = { 123, -45, 0 };
+    const int32_t bias[3] = { 223, -45, 0 };
+    const int32_t still[3] = { 0, 0, 0 };
+
+    gyroBiasSet( &gb, saved );
+    CHECK( gb.biasValid );
+    for( int i = 0; i < 3; i++ )
+    {
+        LONGS_EQUAL( saved[i], gyroBiasGet( &gb, i ) );
+    }
+
+    // A restored estimate is refined, not replaced
+    simWindow( bias, still, 0, 0, true );
+    LONGS_EQUAL( 148, gyroBiasGet( &gb, 0 ) );
+    LONGS_EQUAL( -45, gyroBiasGet( &gb, 1 ) );
+
+    // Until reset
+    gyroBiasReset( &gb, WINDOW );
+    CHECK( !gb.biasValid );
+    LONGS_EQUAL( 0, gyroBiasGet( &gb, 0 ) );
+}
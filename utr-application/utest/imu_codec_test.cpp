@@ -0,0 +1,188 @@
+///-----------------------------------------------------------------------------
+///
+/// @file imu_codec_test.cpp
+///
+/// @brief Round trip tests for the IMU sample codec
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <CppUTest/TestHarness.h>
+#include <imu_codec.h>
+
+// Raw stream payload after its header, with a 247 byte ATT MTU
+#define BLOCK_MAX           236
+#define RAW_SAMPLE_LENGTH   ( IMU_CODEC_CHANNELS * 2 )
+
+#define SIM_SAMPLES         4000
+#define KEYFRAME_INTERVAL   8
+
+// Sensor samples of a board being moved around, with sensor noise
+static std::vector<int16_t> simSamples( int count, int noise )
+{
+    std::vector<int16_t> samples;
+
+    srand( 1 );
+    for( int n = 0; n < count; n++ )
+    {
+        double t = n / 200.0;
+
+        for( int i = 0; i < IMU_CODEC_CHANNELS; i++ )
+        {
+            double value = 2000 * sin( 2 * M_PI * ( 0.2 + 0.1 * i ) * t + i );
+
+            samples.push_back( (int16_t)lround( value ) + ( rand() % ( 2 * noise + 1 ) ) - noise );
+        }
+    }
+    return samples;
+}
+
+// Encode the samples into blocks of at most BLOCK_MAX bytes
+static std::vector<std::vector<uint8_t>> encodeAll( const std::vector<int16_t> &samples )
+{
+    std::vector<std::vector<uint8_t>> blocks;
+    ImuCodec_t codec;
+    size_t count = samples.size() / IMU_CODEC_CHANNELS;
+    size_t done = 0;
+
+    imuCodecReset( &codec, KEYFRAME_INTERVAL );
+    while( done < count )
+    {
+        uint8_t block[BLOCK_MAX];
+        const int16_t *next = &samples[done * IMU_CODEC_CHANNELS];
+        uint16_t encoded;
+        uint16_t length;
+
+        length = imuCodecEncode( &codec, next, (uint16_t)( count - done ), block, BLOCK_MAX, &encoded );
+        if( length == 0 || length > BLOCK_MAX )
+        {
+            break;
+        }
+        imuCodecCommit( &codec, next, encoded );
+        blocks.push_back( std::vector<uint8_t>( block, block + length ) );
+        done += encoded;
+    }
+    return blocks;
+}
+
+TEST_GROUP( imu_codec )
+{
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST( imu_codec, RoundTrip )
+{
+    std::vector<int16_t> samples = simSamples( SIM_SAMPLES, 8 );
+    std::vector<std::vector<uint8_t>> blocks = encodeAll( samples );
+    std::vector<int16_t> decoded;
+    ImuCodec_t codec;
+
+    imuCodecReset( &codec, 0 );
+    for( size_t b = 0; b < blocks.size(); b++ )
+    {
+        int16_t out[IMU_CODEC_MAX_SAMPLES * IMU_CODEC_CHANNELS];
+        uint16_t count = imuCodecDecode( &codec, blocks[b].data(), (uint16_t)blocks[b].size(),
+                                         out, IMU_CODEC_MAX_SAMPLES );
+
+        CHECK( count > 0 );
+        decoded.insert( decoded.end(), out, out + count * IMU_CODEC_CHANNELS );
+    }
+
+    CHECK( decoded == samples );
+}
+
+TEST( imu_codec, Extremes )
+{
+    std::vector<int16_t> samples;
+
+    // Full scale steps in both directions, the worst case for both modes
+    for( int n = 0; n < 100; n++ )
+    {
+        for( int i = 0; i < IMU_CODEC_CHANNELS; i++ )
+        {
+            samples.push_back( ( ( n + i ) & 1 ) ? INT16_MAX : INT16_MIN );
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> blocks = encodeAll( samples );
+    std::vector<int16_t> decoded;
+    ImuCodec_t codec;
+
+    imuCodecReset( &codec, 0 );
+    for( size_t b = 0; b < blocks.size(); b++ )
+    {
+        int16_t out[IMU_CODEC_MAX_SAMPLES * IMU_CODEC_CHANNELS];
+        uint16_t count = imuCodecDecode( &codec, blocks[b].data(), (uint16_t)blocks[b].size(),
+                                         out, IMU_CODEC_MAX_SAMPLES );
+
+        decoded.insert( decoded.end(), out, out + count * IMU_CODEC_CHANNELS );
+    }
+
+    CHECK( decoded == samples );
+}
+
+TEST( imu_codec, ResyncAfterMissedBlock )
+{
+    std::vector<int16_t> samples = simSamples( SIM_SAMPLES, 8 );
+    std::vector<std::vector<uint8_t>> blocks = encodeAll( samples );
+    ImuCodec_t codec;
+    size_t offset = 0;
+    size_t b;
+
+    CHECK( blocks.size() > 2 * KEYFRAME_INTERVAL );
+
+    // Decode the first block, miss the second and start over
+    imuCodecReset( &codec, 0 );
+    {
+        int16_t out[IMU_CODEC_MAX_SAMPLES * IMU_CODEC_CHANNELS];
+
+        CHECK( imuCodecDecode( &codec, blocks[0].data(), (uint16_t)blocks[0].size(),
+                               out, IMU_CODEC_MAX_SAMPLES ) > 0 );
+    }
+    offset = blocks[0][1] + blocks[1][1];
+    b = 2;
+    imuCodecReset( &codec, 0 );
+
+    // Nothing until the next keyframe, then exact again
+    for( ; b < blocks.size(); b++ )
+    {
+        int16_t out[IMU_CODEC_MAX_SAMPLES * IMU_CODEC_CHANNELS];
+        uint16_t count = imuCodecDecode( &codec, blocks[b].data(), (uint16_t)blocks[b].size(),
+                                         out, IMU_CODEC_MAX_SAMPLES );
+
+        if( b < KEYFRAME_INTERVAL )
+        {
+            LONGS_EQUAL( 0, count );
+        }
+        else
+        {
+            CHECK( count > 0 );
+            CHECK( std::equal( out, out + count * IMU_CODEC_CHANNELS,
+                               samples.begin() + offset * IMU_CODEC_CHANNELS ) );
+        }
+        offset += blocks[b][1];
+    }
+}
+
+TEST( imu_codec, CompressionRatio )
+{
+    std::vector<int16_t> samples = simSamples( SIM_SAMPLES, 8 );
+    std::vector<std::vector<uint8_t>> blocks = encodeAll( samples );
+    double perBlock = (double)SIM_SAMPLES / blocks.size();
+    double ratio = perBlock / ( BLOCK_MAX / RAW_SAMPLE_LENGTH );
+
+    UT_PRINT( StringFromFormat( "%.1f samples per block, %.2f times raw", perBlock, ratio ).asCharString() );
+    CHECK( ratio >= 2.0 );
+}
@@ -0,0 +1,159 @@
+///-----------------------------------------------------------------------------
+///
+/// @file imu_fixed_test.cpp
+///
+/// @brief Tests for the fixed-point IMU engine, including an accuracy
+///        comparison against the floating point engine
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdint>
+#include <CppUTest/TestHarness.h>
+#include <imu.h>
+#include <imu_fixed.h>
+
+// Sample rate and duration of the simulated sensor data
+#define SIM_FREQ            200
+#define SIM_SAMPLES         ( SIM_FREQ * 60 )
+
+// Max orientation difference between the engines, in degrees
+#define MAX_ANGLE_DIFF      0.05
+
+static ImuFixed_t toFixed( double value )
+{
+    return (ImuFixed_t)lround( value * IMU_FIXED_ONE );
+}
+
+static double toDouble( ImuFixed_t value )
+{
+    return (double)value / IMU_FIXED_ONE;
+}
+
+static double angleDiff( double a, double b )
+{
+    double diff = fmod( a - b + 3 * M_PI, 2 * M_PI ) - M_PI;
+
+    return fabs( diff );
+}
+
+TEST_GROUP( imu_fixed )
+{
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST( imu_fixed, SaturatingArithmetic )
+{
+    LONGS_EQUAL( INT32_MAX, imuFixedAdd( INT32_MAX, IMU_FIXED_ONE ) );
+    LONGS_EQUAL( -INT32_MAX, imuFixedSub( -INT32_MAX, IMU_FIXED_ONE ) );
+    LONGS_EQUAL( INT32_MAX, imuFixedMul( IMU_FIXED( 10.0 ), IMU_FIXED( 10.0 ) ) );
+    LONGS_EQUAL( -INT32_MAX, imuFixedMul( IMU_FIXED( -10.0 ), IMU_FIXED( 10.0 ) ) );
+    LONGS_EQUAL( IMU_FIXED( 0.25 ), imuFixedMul( IMU_FIXED( 0.5 ), IMU_FIXED( 0.5 ) ) );
+    LONGS_EQUAL( IMU_FIXED( 0.001 ), imuFixedFromRatio( 1, 1000 ) );
+    LONGS_EQUAL( -1799, imuFixedToInt( IMU_FIXED( -0.09999 ), 18000 ) );
+    LONGS_EQUAL( IMU_FIXED( 1.5 ), imuFixedSqrt( IMU_FIXED( 2.25 ) ) );
+}
+
+TEST( imu_fixed, TrigAccuracy )
+{
+    double maxError = 0;
+
+    for( int i = -1000; i <= 1000; i++ )
+    {
+        double x = i / 1000.0;
+
+        maxError = fmax( maxError, fabs( toDouble( imuFixedAsin( toFixed( x ) ) ) - asin( x ) ) );
+    }
+
+    for( int i = 0; i < 3600; i++ )
+    {
+        double angle = ( i - 1800 ) * M_PI / 1800;
+
+        for( double radius = 0.01; radius < 16; radius *= 4 )
+        {
+            double y = radius * sin( angle );
+            double x = radius * cos( angle );
+            double error = angleDiff( toDouble( imuFixedAtan2( toFixed( y ), toFixed( x ) ) ), atan2( y, x ) );
+
+            maxError = fmax( maxError, error );
+        }
+    }
+
+    UT_PRINT( StringFromFormat( "Fixed-point trig max error %.2e rad", maxError ).asCharString() );
+    CHECK( maxError <= IMU_FIXED_TRIG_MAX_ERROR );
+}
+
+TEST( imu_fixed, FusionMatchesFloatEngine )
+{
+    ImuFloat_t floatDcm[3][3];
+    ImuFloat_t floatGyr[3];
+    ImuFloat_t floatAcc[3];
+    ImuFloat_t floatOri[3];
+    ImuSensorFusion_t floatFusion;
+    ImuFixed_t fixedDcm[3][3];
+    ImuFixed_t fixedGyr[3];
+    ImuFixed_t fixedAcc[3];
+    ImuFixed_t fixedOri[3];
+    ImuFixedSensorFusion_t fixedFusion;
+    double maxDiff = 0;
+
+    imuDcmReset( floatDcm );
+    imuSensorFusionGyroCorrClr( &floatFusion );
+    imuFixedDcmReset( fixedDcm );
+    imuFixedSensorFusionGyroCorrClr( &fixedFusion );
+
+    for( int n = 0; n < SIM_SAMPLES; n++ )
+    {
+        double t = (double)n / SIM_FREQ;
+        double rate[3];
+
+        // Smooth motion in all axes, in rad/s
+        rate[0] = 0.7 * sin( 2 * M_PI * 0.3 * t );
+        rate[1] = 0.4 * sin( 2 * M_PI * 0.2 * t + 1 );
+        rate[2] = 1.0 * cos( 2 * M_PI * 0.1 * t );
+
+        for( int i = 0; i < 3; i++ )
+        {
+            floatGyr[i] = (ImuFloat_t)( rate[i] / SIM_FREQ );
+            fixedGyr[i] = toFixed( rate[i] / SIM_FREQ );
+        }
+
+        // Gravity as seen by the sensor at the current orientation
+        floatAcc[0] = -floatDcm[2][0];
+        floatAcc[1] = floatDcm[2][1];
+        floatAcc[2] = floatDcm[2][2];
+        for( int i = 0; i < 3; i++ )
+        {
+            fixedAcc[i] = toFixed( floatAcc[i] );
+        }
+
+        imuSensorFusionGyroCorrDo( &floatFusion, floatGyr );
+        imuDcmRotate( floatDcm, floatGyr );
+        imuDcmNormalize( floatDcm );
+        imuDcmGetAngles( floatDcm, floatOri );
+        imuSensorFusionGyroCorrCalc( &floatFusion, floatOri, true, floatAcc, false, 0, SIM_FREQ );
+
+        imuFixedSensorFusionGyroCorrDo( &fixedFusion, fixedGyr );
+        imuFixedDcmRotate( fixedDcm, fixedGyr );
+        imuFixedDcmNormalize( fixedDcm );
+        imuFixedDcmGetAngles( fixedDcm, fixedOri );
+        imuFixedSensorFusionGyroCorrCalc( &fixedFusion, fixedOri, true, fixedAcc, false, 0, SIM_FREQ );
+
+        for( int i = 0; i < 3; i++ )
+        {
+            maxDiff = fmax( maxDiff, angleDiff( floatOri[i], toDouble( fixedOri[i] ) ) );
+        }
+    }
+
+    maxDiff *= 180 / M_PI;
+    UT_PRINT( StringFromFormat( "Fixed-point vs float engine max difference %.4f deg", maxDiff ).asCharString() );
+    CHECK( maxDiff <= MAX_ANGLE_DIFF );
+}
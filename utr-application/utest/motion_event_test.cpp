@@ -0,0 +1,147 @@
+///-----------------------------------------------------------------------------
+///
+/// @file motion_event_test.cpp
+///
+/// @brief Tests for the tap, shock and free-fall detector
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <cstdint>
+#include <vector>
+#include <CppUTest/TestHarness.h>
+#include <motion_event.h>
+
+#define SIM_FREQ            200
+
+static MotionEventDetector_t med;
+static uint32_t simTime;
+static std::vector<MotionEvent_t> simEvents;
+
+// Feed samples of the given acceleration, board flat on a table
+static void simAcc( int32_t x, int32_t y, int32_t z, int samples )
+{
+    for( int n = 0; n < samples; n++ )
+    {
+        int32_t acc[3] = { x, y, z };
+        MotionEvent_t events[MOTION_EVENT_MAX];
+        uint8_t count = motionEventUpdate( &med, acc, simTime++, events );
+
+        simEvents.insert( simEvents.end(), events, events + count );
+    }
+}
+
+static void simRest( int ms )
+{
+    simAcc( 0, 0, 1000, ms * SIM_FREQ / 1000 );
+}
+
+// A tap on top of the board, a few samples down and a smaller rebound
+static void simTap( int32_t mg )
+{
+    simAcc( 0, 0, 1000 - mg, 3 );
+    simAcc( 0, 0, 1000 + mg / 3, 2 );
+}
+
+TEST_GROUP( motion_event )
+{
+    void setup()
+    {
+        motionEventReset( &med, SIM_FREQ );
+        simTime = 0;
+        simEvents.clear();
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST( motion_event, NothingAtRest )
+{
+    simRest( 5000 );
+    simAcc( 10, -20, 990, SIM_FREQ );
+    simRest( 1000 );
+
+    LONGS_EQUAL( 0, simEvents.size() );
+}
+
+TEST( motion_event, SingleTap )
+{
+    simRest( 1000 );
+    uint32_t tapTime = simTime;
+    simTap( 2500 );
+    simRest( 1000 );
+
+    LONGS_EQUAL( 1, simEvents.size() );
+    LONGS_EQUAL( MOTION_EVENT_TAP, simEvents[0].type );
+    LONGS_EQUAL( tapTime, simEvents[0].time );
+    CHECK( simEvents[0].magnitude >= 2000 );
+}
+
+TEST( motion_event, DoubleTap )
+{
+    simRest( 1000 );
+    uint32_t tapTime = simTime;
+    simTap( 2500 );
+    simRest( 150 );
+    simTap( 3000 );
+    simRest( 1000 );
+
+    LONGS_EQUAL( 1, simEvents.size() );
+    LONGS_EQUAL( MOTION_EVENT_DOUBLE_TAP, simEvents[0].type );
+    LONGS_EQUAL( tapTime, simEvents[0].time );
+}
+
+TEST( motion_event, MovementIsNoTap )
+{
+    simRest( 1000 );
+    simAcc( 2000, 0, 1000, SIM_FREQ / 2 );
+    simRest( 1000 );
+
+    LONGS_EQUAL( 0, simEvents.size() );
+}
+
+TEST( motion_event, Shock )
+{
+    simRest( 1000 );
+    simAcc( 0, 5000, 1000, 2 );
+    uint32_t peakTime = simTime;
+    simAcc( 0, 9000, 1000, 1 );
+    simAcc( 0, 4000, 1000, 2 );
+    simRest( 1000 );
+
+    LONGS_EQUAL( 1, simEvents.size() );
+    LONGS_EQUAL( MOTION_EVENT_SHOCK, simEvents[0].type );
+    LONGS_EQUAL( peakTime, simEvents[0].time );
+    CHECK( simEvents[0].magnitude >= 9000 );
+
+    motionEventSetThresholds( &med, MOTION_EVENT_TAP_MG, 12000 );
+    simEvents.clear();
+    simAcc( 0, 9000, 1000, 3 );
+    simRest( 1000 );
+    for( size_t i = 0; i < simEvents.size(); i++ )
+    {
+        CHECK( simEvents[i].type != MOTION_EVENT_SHOCK );
+    }
+}
+
+TEST( motion_event, FreeFall )
+{
+    simRest( 1000 );
+    uint32_t fallTime = simTime;
+    simAcc( 0, 0, 50, 2 * SIM_FREQ / 5 );
+    simRest( 1000 );
+
+    LONGS_EQUAL( 1, simEvents.size() );
+    LONGS_EQUAL( MOTION_EVENT_FREEFALL, simEvents[0].type );
+    LONGS_EQUAL( fallTime, simEvents[0].time );
+    LONGS_EQUAL( 50, simEvents[0].magnitude );
+
+    // Too short to be a fall
+    simEvents.clear();
+    simAcc( 0, 0, 50, 5 );
+    simRest( 1000 );
+    LONGS_EQUAL( 0, simEvents.size() );
+}
@@ -0,0 +1,246 @@
+///-----------------------------------------------------------------------------
+///
+/// @file notify_filter_test.cpp
+///
+/// @brief Tests for the notification filter
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <cstdint>
+#include <CppUTest/TestHarness.h>
+#include <notify_filter.h>
+#include <native_gecko.h>
+#include <bg_errorcodes.h>
+#include <gatt_db.h>
+
+#define CONNECTION          1
+
+// RTCC ticks
+#define MS( ms )            ( (uint32_t)( ms ) * 32768 / 1000 )
+
+// What the stack stub answers a notification with
+static void notificationResultSet( uint16_t result )
+{
+    ( (struct gecko_cmd_packet *)gecko_rsp_msg_buf )->data.rsp_gatt_server_send_characteristic_notification.result = result;
+}
+
+// An acceleration value, as three int16
+static bool sendAcc( int16_t x, int16_t y, int16_t z, uint32_t now )
+{
+    uint8_t value[6];
+    int16_t xyz[3] = { x, y, z };
+
+    for( int i = 0; i < 3; i++ )
+    {
+        value[2 * i] = (uint8_t)xyz[i];
+        value[2 * i + 1] = (uint8_t)( (uint16_t)xyz[i] >> 8 );
+    }
+    return notifyFilterSendAt( CONNECTION, gattdb_accor_acceleration, sizeof( value ), value, now );
+}
+
+// A motion value, a timestamp then six int16
+static bool sendMotion( uint32_t timestamp, int16_t first, uint32_t now )
+{
+    uint8_t value[16] = { 0 };
+
+    for( int i = 0; i < 4; i++ )
+    {
+        value[i] = (uint8_t)( timestamp >> ( 8 * i ) );
+    }
+    value[4] = (uint8_t)first;
+    value[5] = (uint8_t)( (uint16_t)first >> 8 );
+    return notifyFilterSendAt( CONNECTION, gattdb_accor_motion, sizeof( value ), value, now );
+}
+
+static bool sendBattery( uint8_t level, uint32_t now )
+{
+    return notifyFilterSendAt( CONNECTION, gattdb_battery_measurement, 1, &level, now );
+}
+
+static void configure( uint16_t characteristic, uint8_t flags, uint16_t deadbandAbs, uint16_t deadbandRel,
+                       uint16_t minIntervalMs, uint8_t maxRate )
+{
+    NotifyFilterConfig_t config = { flags, deadbandAbs, deadbandRel, minIntervalMs, maxRate };
+
+    CHECK( notifyFilterConfigure( characteristic, &config ) );
+}
+
+TEST_GROUP( notify_filter )
+{
+    void setup()
+    {
+        notificationResultSet( bg_err_success );
+        notifyFilterReset();
+    }
+
+    void teardown()
+    {
+        notificationResultSet( bg_err_success );
+    }
+};
+
+TEST( notify_filter, PassesUntilConfigured )
+{
+    uint8_t value = 0;
+
+    CHECK( sendAcc( 1, 2, 3, 0 ) );
+    CHECK( sendAcc( 1, 2, 3, 0 ) );
+    CHECK( sendBattery( 50, 0 ) );
+    CHECK( sendBattery( 50, 0 ) );
+
+    // No filter at all
+    CHECK( notifyFilterSendAt( CONNECTION, gattdb_accor_raw, 1, &value, 0 ) );
+    CHECK( !notifyFilterConfigure( gattdb_accor_raw, NULL ) );
+}
+
+TEST( notify_filter, DeadbandAbsolute )
+{
+    configure( gattdb_accor_acceleration, NOTIFY_FILTER_DEADBAND, 10, 0, 0, 0 );
+
+    // The first value is the reference
+    CHECK( sendAcc( 0, 0, 1000, 0 ) );
+    CHECK( !sendAcc( 0, 0, 1000, 0 ) );
+    CHECK( !sendAcc( 10, -10, 990, 0 ) );
+    CHECK( sendAcc( 0, -11, 1000, 0 ) );
+
+    // Against the last value sent, not the last value offered
+    CHECK( !sendAcc( 0, -2, 1000, 0 ) );
+    CHECK( sendAcc( 0, 0, 1000, 0 ) );
+}
+
+TEST( notify_filter, DeadbandRelative )
+{
+    configure( gattdb_accor_acceleration, NOTIFY_FILTER_DEADBAND, 0, 100, 0, 0 );
+
+    CHECK( sendAcc( -1000, 0, 1000, 0 ) );
+    CHECK( !sendAcc( -1100, 0, 900, 0 ) );
+    CHECK( sendAcc( -1101, 0, 1000, 0 ) );
+    CHECK( !sendAcc( -1101, 0, 1100, 0 ) );
+    CHECK( sendAcc( -1101, 0, 899, 0 ) );
+}
+
+TEST( notify_filter, DeadbandEither )
+{
+    configure( gattdb_accor_acceleration, NOTIFY_FILTER_DEADBAND, 20, 100, 0, 0 );
+
+    // The relative deadband is the smaller for small values
+    CHECK( sendAcc( 100, 0, 1000, 0 ) );
+    CHECK( !sendAcc( 110, 0, 1000, 0 ) );
+    CHECK( sendAcc( 111, 0, 1000, 0 ) );
+
+    // And the absolute deadband for large values
+    CHECK( !sendAcc( 111, 0, 1020, 0 ) );
+    CHECK( sendAcc( 111, 0, 1021, 0 ) );
+}
+
+TEST( notify_filter, DeadbandSkipsTimestamp )
+{
+    configure( gattdb_accor_motion, NOTIFY_FILTER_DEADBAND, 10, 0, 0, 0 );
+
+    // A new timestamp alone is no change
+    CHECK( sendMotion( 1000, 500, 0 ) );
+    CHECK( !sendMotion( 2000, 505, 0 ) );
+    CHECK( !sendMotion( 70000, 490, 0 ) );
+    CHECK( sendMotion( 80000, 511, 0 ) );
+}
+
+TEST( notify_filter, DeadbandOff )
+{
+    configure( gattdb_battery_measurement, NOTIFY_FILTER_DEADBAND, 0, 0, 0, 0 );
+
+    CHECK( sendBattery( 50, 0 ) );
+    CHECK( !sendBattery( 50, 0 ) );
+    CHECK( sendBattery( 49, 0 ) );
+}
+
+TEST( notify_filter, NoDeadbandOnCountersBitfieldsOrEvents )
+{
+    NotifyFilterConfig_t deadband = { NOTIFY_FILTER_DEADBAND, 1, 0, 0, 0 };
+    NotifyFilterConfig_t interval = { 0, 0, 0, 100, 0 };
+
+    CHECK( !notifyFilterConfigure( gattdb_cycling_speed_measurement, &deadband ) );
+    CHECK( !notifyFilterConfigure( gattdb_aio_digital_in, &deadband ) );
+    CHECK( !notifyFilterConfigure( gattdb_accor_event, &deadband ) );
+    CHECK( notifyFilterConfigure( gattdb_cycling_speed_measurement, &interval ) );
+    CHECK( notifyFilterConfigure( gattdb_aio_digital_in, &interval ) );
+    CHECK( notifyFilterConfigure( gattdb_accor_event, &interval ) );
+}
+
+TEST( notify_filter, MinInterval )
+{
+    configure( gattdb_battery_measurement, 0, 0, 0, 100, 0 );
+
+    CHECK( sendBattery( 50, MS( 1000 ) ) );
+    CHECK( !sendBattery( 49, MS( 1050 ) ) );
+    CHECK( !sendBattery( 48, MS( 1099 ) ) );
+    CHECK( sendBattery( 47, MS( 1101 ) ) );
+    CHECK( !sendBattery( 46, MS( 1151 ) ) );
+}
+
+TEST( notify_filter, MaxRate )
+{
+    configure( gattdb_battery_measurement, 0, 0, 0, 0, 4 );
+
+    // A burst of up to a second's worth
+    for( int i = 0; i < 4; i++ )
+    {
+        CHECK( sendBattery( 50, MS( 1000 ) ) );
+    }
+    CHECK( !sendBattery( 50, MS( 1000 ) ) );
+
+    // Then refilled at the rate
+    CHECK( !sendBattery( 50, MS( 1200 ) ) );
+    CHECK( sendBattery( 50, MS( 1260 ) ) );
+    CHECK( !sendBattery( 50, MS( 1300 ) ) );
+
+    // But never beyond a second's worth
+    for( int i = 0; i < 4; i++ )
+    {
+        CHECK( sendBattery( 50, MS( 10000 ) ) );
+    }
+    CHECK( !sendBattery( 50, MS( 10000 ) ) );
+}
+
+TEST( notify_filter, OnlyAcceptedValuesCount )
+{
+    configure( gattdb_battery_measurement, NOTIFY_FILTER_DEADBAND, 5, 0, 100, 0 );
+
+    notificationResultSet( bg_err_out_of_memory );
+    CHECK( !sendBattery( 50, 0 ) );
+
+    // Still no reference, and no interval running
+    notificationResultSet( bg_err_success );
+    CHECK( sendBattery( 50, MS( 10 ) ) );
+    CHECK( !sendBattery( 60, MS( 20 ) ) );
+}
+
+TEST( notify_filter, Restart )
+{
+    configure( gattdb_accor_acceleration, NOTIFY_FILTER_DEADBAND, 10, 0, 1000, 1 );
+
+    CHECK( sendAcc( 0, 0, 1000, 0 ) );
+    CHECK( !sendAcc( 0, 0, 1000, MS( 10 ) ) );
+
+    // Sent regardless, and the filter keeps its config
+    notifyFilterRestart( gattdb_accor_acceleration );
+    CHECK( sendAcc( 0, 0, 1000, MS( 20 ) ) );
+    CHECK( !sendAcc( 0, 0, 1100, MS( 30 ) ) );
+}
+
+TEST( notify_filter, Reset )
+{
+    configure( gattdb_accor_acceleration, NOTIFY_FILTER_DEADBAND, 10, 0, 1000, 1 );
+    configure( gattdb_battery_measurement, 0, 0, 0, 1000, 0 );
+
+    CHECK( sendAcc( 0, 0, 1000, 0 ) );
+    CHECK( sendBattery( 50, 0 ) );
+
+    // Everything passes again
+    notifyFilterReset();
+    CHECK( sendAcc( 0, 0, 1000, MS( 10 ) ) );
+    CHECK( sendAcc( 0, 0, 1000, MS( 10 ) ) );
+    CHECK( sendBattery( 50, MS( 10 ) ) );
+    CHECK( sendBattery( 50, MS( 10 ) ) );
+}
@@ -0,0 +1,120 @@
+///-----------------------------------------------------------------------------
+///
+/// @file spectrum_test.cpp
+///
+/// @brief Tests for the vibration spectrum summary
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <CppUTest/TestHarness.h>
+#include <spectrum.h>
+
+#define SIM_FREQ            200
+#define SIM_SAMPLES         256
+
+static SpectrumWork_t work;
+static int16_t samples[SIM_SAMPLES];
+
+// Gravity plus vibrations at two frequencies, in mg
+static void simVibration( double freq1, double amplitude1, double freq2, double amplitude2, int noise )
+{
+    srand( 1 );
+    for( int n = 0; n < SIM_SAMPLES; n++ )
+    {
+        double t = (double)n / SIM_FREQ;
+        double value = 1000 + amplitude1 * sin( 2 * M_PI * freq1 * t ) + amplitude2 * sin( 2 * M_PI * freq2 * t + 1 );
+
+        samples[n] = (int16_t)lround( value ) + ( rand() % ( 2 * noise + 1 ) ) - noise;
+    }
+}
+
+// As the samples are collected
+static bool compute( uint16_t n, Spectrum_t *spectrum )
+{
+    for( int i = 0; i < n; i++ )
+    {
+        work.x[i] = samples[i];
+    }
+    return spectrumCompute( &work, n, SIM_FREQ, spectrum );
+}
+
+TEST_GROUP( spectrum )
+{
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST( spectrum, WindowLength )
+{
+    Spectrum_t spectrum;
+
+    CHECK( spectrumValidLength( 64 ) );
+    CHECK( spectrumValidLength( SPECTRUM_MAX_SAMPLES ) );
+    CHECK( !spectrumValidLength( 100 ) );
+    CHECK( !spectrumValidLength( 2 * SPECTRUM_MAX_SAMPLES ) );
+    CHECK( !compute( 48, &spectrum ) );
+}
+
+TEST( spectrum, Peaks )
+{
+    Spectrum_t spectrum;
+
+    simVibration( 31.3, 500, 72.9, 200, 5 );
+    CHECK( compute( SIM_SAMPLES, &spectrum ) );
+
+    UT_PRINT( StringFromFormat( "Peaks %u.%u Hz %u mg, %u.%u Hz %u mg",
+                                spectrum.peakFreq[0] / 10, spectrum.peakFreq[0] % 10, spectrum.peakAmplitude[0],
+                                spectrum.peakFreq[1] / 10, spectrum.peakFreq[1] % 10, spectrum.peakAmplitude[1] ).asCharString() );
+    CHECK( abs( spectrum.peakFreq[0] - 313 ) <= 3 );
+    CHECK( abs( spectrum.peakAmplitude[0] - 500 ) <= 80 );
+    CHECK( abs( spectrum.peakFreq[1] - 729 ) <= 3 );
+    CHECK( abs( spectrum.peakAmplitude[1] - 200 ) <= 35 );
+    CHECK( spectrum.peakAmplitude[2] < 20 );
+}
+
+TEST( spectrum, BandEnergy )
+{
+    Spectrum_t spectrum;
+
+    // Each band is 12.5 Hz wide at this rate
+    simVibration( 31.3, 500, 72.9, 200, 0 );
+    CHECK( compute( SIM_SAMPLES, &spectrum ) );
+
+    for( int b = 0; b < SPECTRUM_BANDS; b++ )
+    {
+        UT_PRINT( StringFromFormat( "Band %d %u mg", b, spectrum.band[b] ).asCharString() );
+    }
+    CHECK( abs( spectrum.band[2] - 354 ) <= 20 );
+    CHECK( abs( spectrum.band[5] - 141 ) <= 10 );
+    CHECK( spectrum.band[0] < 10 );
+    CHECK( spectrum.band[7] < 10 );
+    CHECK( abs( spectrum.rms - 381 ) <= 10 );
+}
+
+TEST( spectrum, PairedBins )
+{
+    Spectrum_t spectrum;
+
+    // Bins 64 and 120 of 256, the middle bin that pairs with itself and one
+    // near the Nyquist frequency
+    const double freqs[] = { 50.0, 93.75 };
+
+    for( unsigned f = 0; f < sizeof( freqs ) / sizeof( freqs[0] ); f++ )
+    {
+        simVibration( freqs[f], 300, 0, 0, 0 );
+        CHECK( compute( SIM_SAMPLES, &spectrum ) );
+        CHECK( abs( spectrum.peakFreq[0] - (int)lround( freqs[f] * 10 ) ) <= 1 );
+        CHECK( abs( spectrum.peakAmplitude[0] - 300 ) <= 5 );
+        CHECK( spectrum.peakAmplitude[1] < 10 );
+    }
+}
@@ -0,0 +1,22 @@
+///-----------------------------------------------------------------------------
+///
+/// @file em_core.cpp
+///
+/// @brief Stubs for platform/emlib/src/em_core.c
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#include <cstdint>
+#include <em_core.h>
+
+
+CORE_irqState_t CORE_EnterAtomic( void )
+{
+    return 0;
+}
+
+void CORE_ExitAtomic( CORE_irqState_t irqState )
+{
+}
@@ -0,0 +1,25 @@
+///-----------------------------------------------------------------------------
+///
+/// @file mpu6500_dmp_firmware.h
+///
+/// @brief Placeholder for the InvenSense DMP image, so the DMP path builds in
+///        the unit test build. See MPU6500_DMP_FIRMWARE_AVAILABLE in mpu6500.h.
+///
+/// @copyright Copyright (c) Uncannier Software 2019
+///
+///-----------------------------------------------------------------------------
+
+#ifndef MPU6500_DMP_FIRMWARE_H_
+#define MPU6500_DMP_FIRMWARE_H_
+
+#define MPU6500_DMP_START_ADDR      0x0400
+#define MPU6500_DMP_FIFO_RATE_ADDR  0x0216
+
+static const uint8_t MPU6500_DMP_IMAGE[32] = { 0 };
+
+static const Mpu6500DmpWrite_t MPU6500_DMP_QUAT_CONFIG[] =
+{
+    { 0x0aa0, 4, { 0x20, 0x28, 0x30, 0x38 } },
+};
+
+#endif // MPU6500_DMP_FIRMWARE_H_